@@ -0,0 +1,51 @@
+cbuffer Constants : register(b0)
+{
+    row_major float4x4 transform;
+}
+
+// One instance per segment, expanded to a quad of 6 vertices without an index buffer.
+struct SegmentData
+{
+    float4 segment   : SEGMENT;
+    float  thickness : THICKNESS;
+    float4 color     : COLOR;
+};
+
+struct PixelData
+{
+    float4 position : SV_POSITION;
+    float2 texcoord : TEXCOORD0;
+    float4 color    : COLOR0;
+};
+
+Texture2D InputTexture : register(t0);
+SamplerState InputSampler : register(s0);
+
+// Quad corners are p1 + n, p2 + n, p2 - n, p1 - n, triangles are (0, 1, 2) (2, 3, 0).
+static const uint Corners[6] = { 0, 1, 2, 2, 3, 0 };
+
+PixelData Vertex(SegmentData segment, uint vertexId : SV_VertexID)
+{
+    float2 p1 = segment.segment.xy;
+    float2 p2 = segment.segment.zw;
+    float2 d = p2 - p1;
+    float lengthSq = dot(d, d);
+    d = lengthSq > 0.0f ? d * rsqrt(lengthSq) : float2(0.0f, 0.0f);
+    float2 offset = float2(d.y, -d.x) * (segment.thickness * 0.5f);
+
+    uint corner = Corners[vertexId];
+    float2 position = (corner == 0 || corner == 3) ? p1 : p2;
+    position += corner < 2 ? offset : -offset;
+
+    PixelData output;
+    output.position = mul(float4(position, 0.5f, 1.0f), transform);
+    output.texcoord = float2(0.0f, 0.0f);
+    output.color = segment.color;
+    return output;
+}
+
+float4 Pixel(PixelData pixel) : SV_Target
+{
+    float4 sample = InputTexture.Sample(InputSampler, pixel.texcoord);
+    return float4(sample.xyz * pixel.color.xyz, 1.0f);
+}
\ No newline at end of file
@@ -11,6 +11,19 @@ struct VertexData
     float4 color    : COLOR;
 };
 
+struct Vertex2DData
+{
+    float2 position : POSITION;
+    float4 color    : COLOR;
+};
+
+struct Vertex2DUv16Data
+{
+    float2 position : POSITION;
+    float2 texcoord : TEXCOORD; // R16G16_UNORM
+    float4 color    : COLOR;
+};
+
 struct PixelData
 {
     float4 position : SV_POSITION;
@@ -30,6 +43,24 @@ PixelData Vertex(VertexData vertex)
     return output;
 }
 
+PixelData Vertex2D(Vertex2DData vertex)
+{
+    PixelData output;
+    output.position = mul(float4(vertex.position, 0.5f, 1.0f), transform);
+    output.texcoord = float2(0.0f, 0.0f);
+    output.color = vertex.color;
+    return output;
+}
+
+PixelData Vertex2DUv16(Vertex2DUv16Data vertex)
+{
+    PixelData output;
+    output.position = mul(float4(vertex.position, 0.5f, 1.0f), transform);
+    output.texcoord = vertex.texcoord;
+    output.color = vertex.color;
+    return output;
+}
+
 #define stb_unlerp(t,a,b) (((t) - (a)) / ((b) - (a)))
 
 float stb_linear_remap(float x, float x_min, float x_max, float out_min, float out_max)
@@ -0,0 +1,28 @@
+#!/bin/sh
+# Headless Linux build: game library + core with null and software renderers.
+# Usage: ./build.sh [Debug|Release]
+set -e
+
+BuildMode=${1:-Release}
+OutputDirectory=build/SummerGame_Linux
+
+if [ "$BuildMode" = "Debug" ]; then
+    OptimizationFlags="-O0 -g"
+else
+    OptimizationFlags="-O2 -g -DNDEBUG"
+fi
+
+CC=${CC:-gcc}
+CXX=${CXX:-g++}
+
+CommonFlags="$OptimizationFlags -mavx -fno-strict-aliasing -DPLATFORM_LINUX -Iext/cimgui -Iext -Ireflect/src/runtime"
+
+mkdir -p $OutputDirectory
+
+echo "Building Summer Game (Linux, $BuildMode)"
+
+$CC $CommonFlags -std=c11 -fgnu89-inline -fPIC -shared -fvisibility=hidden src/GameEntry.c -o $OutputDirectory/Game.so -lm
+$CXX $CommonFlags -std=c++17 -fno-rtti -fno-exceptions src/core/LinuxCore.cpp src/renderer/Null_RendererEntry.cpp src/renderer/Software_RendererEntry.cpp -o $OutputDirectory/SummerGame -pthread -ldl -lm
+
+echo "Done. Run from $OutputDirectory: ./SummerGame --frames 100"
+echo "Benchmark: ./SummerGame --benchmark --frames 200 [--renderer software] [--benchmark-csv out.csv]"
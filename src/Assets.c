@@ -1,5 +1,5 @@
 #include "Assets.h"
-#include "Memory.h"
+#include "core/Memory.h"
 
 // TODO: Do this really thread local?
 static _ThreadLocal MemoryStack* __stbiMemoryStackPtr = NULL;
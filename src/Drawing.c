@@ -2,13 +2,36 @@
 
 #include "StringUtils.h"
 
+// NOTE: kerning is the pen offset before this glyph.
 typedef struct
 {
     FontGlyphInfo* glyph;
     u32 color;
     f32 scale;
+    f32 kerning;
 } LineCacheEntry;
 
+// NOTE: A line of a text box, its glyphs are [firstGlyph, firstGlyph + glyphsCount) of the line cache.
+typedef struct
+{
+    u32 firstGlyph;
+    u32 glyphsCount;
+    f32 width;
+    f32 ascent;
+    f32 descent;
+    f32 lineGap;
+} TextLineInfo;
+
+// NOTE: Result of breaking a text box into lines. boundingBox has vertical alignment applied,
+// lines and glyphs are only filled in when they were asked for.
+typedef struct
+{
+    Rectangle2D boundingBox;
+    u32 linesCount;
+    TextLineInfo* lines;
+    LineCacheEntry* glyphs;
+} TextBoxLinesInternal;
+
 typedef struct
 {
     u32 charsCount;
@@ -19,249 +42,1574 @@ typedef struct
     // indices to glyphs
     LineCacheEntry* lineCache;
 
-    u32 lineCacheSize;
-    f32 maxWidth;
-    TextDrawBatch* batches;
-    u32 batchesCount;
-    u32 batchIndex;
-    u32 charIndex;
+    u32 lineCacheSize;
+    f32 maxWidth;
+    b32 kerning;
+    TextDrawBatch* batches;
+    u32 batchesCount;
+    u32 batchIndex;
+    // NOTE: Byte offset into the current batch, bytes before asciiEnd are known to be ASCII.
+    u32 charIndex;
+    u32 asciiEnd;
+
+} DrawTextState;
+
+void gfxPrepareNextTextLineInternal(DrawTextState* state, bool writeLineCache);
+static void gfxBreakTextBoxLinesInternal(MemoryStack* scratch, Rectangle2D rect, TextDrawBatch* batches, u32 count, TextDrawParams params, bool recordLines, TextBoxLinesInternal* result);
+
+u32 gfxPackColor(Vector4 color)
+{
+    byte r = (byte)(fClamp(0.0f, color.x, 1.0f) * 255.0f);
+    byte g = (byte)(fClamp(0.0f, color.y, 1.0f) * 255.0f);
+    byte b = (byte)(fClamp(0.0f, color.z, 1.0f) * 255.0f);
+    byte a = (byte)(fClamp(0.0f, color.w, 1.0f) * 255.0f);
+
+    u32 result = r | (g << 8) | (b << 16) | (a << 24);
+    return result;
+}
+
+Vector4 gfxUnpackColor(u32 color)
+{
+    byte r = color & 0xff000000;
+    byte g = color & 0x00ff0000;
+    byte b = color & 0x0000ff00;
+    byte a = color & 0x000000ff;
+
+    const f32 d = 1.0f / 255.0f;
+    Vector4 result = MakeVector4(r * d, g * d, b * d, a * d);
+    return result;
+}
+
+// TODO: These are _EXTREMELY_ inefficient. Only for development.
+f32 _gfxColorToLinear(f32 a)
+{
+    bool cutoff = a <  0.04045f;
+    f32 higher = fPow((a + 0.055f) / 1.055f, 2.4f);
+    f32 lower = a / 12.92f;
+    return fLerp(higher, cutoff, lower);
+}
+
+f32 _gfxColorFromLinear(f32 a)
+{
+    bool cutoff = a < 0.0031308f;
+    f32 higher = 1.055f * fPow(a, (f32)(1.0f / 2.4)) - 0.055f;
+    f32 lower = a * 12.92f;
+    return fLerp(higher, cutoff, lower);
+}
+
+Vector4 gfxColorToLinear(Vector4 color)
+{
+    // TODO: SIMDize
+    Vector4 result;
+    result.x = _gfxColorToLinear(color.x);
+    result.y = _gfxColorToLinear(color.y);
+    result.z = _gfxColorToLinear(color.z);
+    result.w = color.w;
+
+    return result;
+}
+
+Vector4 gfxColorFromLinear(Vector4 color)
+{
+    // TODO: SIMDize
+    Vector4 result;
+    result.x = _gfxColorFromLinear(color.x);
+    result.y = _gfxColorFromLinear(color.y);
+    result.z = _gfxColorFromLinear(color.z);
+    result.w = color.w;
+
+    return result;
+}
+
+void gfxResetGeometryBuffer(GeometryBuffer* buffer)
+{
+    buffer->vertexCount = 0;
+    buffer->indexCount = 0;
+    buffer->vertexOffset = 0;
+    buffer->indexOffset = 0;
+    buffer->vertexFormat = RenderVertexFormat_PositionUvColor;
+    buffer->vertexByteOffset = 0;
+    buffer->rangeCount = 0;
+    buffer->rangeOffset = 0;
+    buffer->segmentCount = 0;
+    buffer->segmentOffset = 0;
+}
+
+void gfxStartGeometryBatch(GeometryBuffer* buffer, RenderVertexFormat vertexFormat)
+{
+    buffer->vertexByteOffset = gfxGetVertexBytesCount(buffer);
+    buffer->vertexFormat = vertexFormat;
+    buffer->vertexOffset = buffer->vertexCount;
+    buffer->indexOffset = buffer->indexCount;
+    buffer->rangeOffset = buffer->rangeCount;
+    buffer->segmentOffset = buffer->segmentCount;
+}
+
+uptr gfxGetVertexBytesCount(GeometryBuffer* buffer)
+{
+    return buffer->vertexByteOffset + (uptr)(buffer->vertexCount - buffer->vertexOffset) * GetVertexFormatStride(buffer->vertexFormat);
+}
+
+void gfxSetGeometryBufferPages(GeometryBuffer* buffer, GeometryBufferPages* pages)
+{
+    buffer->pages = pages;
+    buffer->vertexBuffer = pages->vertices.memory;
+    buffer->indexBuffer = (u16*)pages->indices.memory;
+    buffer->rangeBuffer = (GeometryBatchRange*)pages->ranges.memory;
+    buffer->segmentBuffer = (RenderLineSegment*)pages->segments.memory;
+}
+
+// NOTE: Called by the emitters with the most they can write, so the common case is four compares.
+// Split ranges may copy a few carried vertices, maxVertices has to include them. When a range can not
+// grow that far the emitter writes nothing, the ranges handle the failure according to their failStrategy.
+static inline b32 gfxCommitGeometryPagesInternal(GeometryBuffer* buffer, u32 maxVertices, u32 maxIndices, u32 maxSegments)
+{
+    GeometryBufferPages* pages = buffer->pages;
+    if (pages == NULL)
+    {
+        return true;
+    }
+
+    u32 maxRanges = maxVertices / (GeometryBatchMaxVertices / 2) + 2;
+    return mmCommitVirtualRange(&pages->vertices, gfxGetVertexBytesCount(buffer) + (uptr)maxVertices * GetVertexFormatStride(buffer->vertexFormat)) &&
+        mmCommitVirtualRange(&pages->indices, ((uptr)buffer->indexCount + maxIndices) * sizeof(u16)) &&
+        mmCommitVirtualRange(&pages->ranges, ((uptr)buffer->rangeCount + maxRanges) * sizeof(GeometryBatchRange)) &&
+        mmCommitVirtualRange(&pages->segments, ((uptr)buffer->segmentCount + maxSegments) * sizeof(RenderLineSegment));
+}
+
+// NOTE: Gives pages past the current contents back to the system, call it before a reset to shrink
+// the buffer to what the last frame used.
+void gfxDecommitGeometryBuffer(GeometryBuffer* buffer)
+{
+    GeometryBufferPages* pages = buffer->pages;
+    if (pages == NULL)
+    {
+        return;
+    }
+
+    mmDecommitVirtualRange(&pages->vertices, gfxGetVertexBytesCount(buffer));
+    mmDecommitVirtualRange(&pages->indices, (uptr)buffer->indexCount * sizeof(u16));
+    mmDecommitVirtualRange(&pages->ranges, (uptr)buffer->rangeCount * sizeof(GeometryBatchRange));
+    mmDecommitVirtualRange(&pages->segments, (uptr)buffer->segmentCount * sizeof(RenderLineSegment));
+}
+
+uptr gfxGetGeometryCommittedBytes(GeometryBuffer* buffer)
+{
+    GeometryBufferPages* pages = buffer->pages;
+    if (pages == NULL)
+    {
+        return 0;
+    }
+
+    return pages->vertices.committedSize + pages->indices.committedSize + pages->ranges.committedSize + pages->segments.committedSize;
+}
+
+// Address of a vertex of the current batch, index is relative to the batch.
+static inline byte* gfxGetBatchVertexInternal(GeometryBuffer* buffer, u32 index)
+{
+    return (byte*)buffer->vertexBuffer + buffer->vertexByteOffset + (uptr)index * GetVertexFormatStride(buffer->vertexFormat);
+}
+
+// Closes the current range of the batch and starts a new one with the same vertex format.
+static void gfxSplitGeometryBatchInternal(GeometryBuffer* buffer)
+{
+    GeometryBatchRange* range = buffer->rangeBuffer + buffer->rangeCount++;
+    range->vertexByteOffset = buffer->vertexByteOffset;
+    range->vertexCount = buffer->vertexCount - buffer->vertexOffset;
+    range->indexOffset = buffer->indexOffset;
+    range->indexCount = buffer->indexCount - buffer->indexOffset;
+
+    buffer->vertexByteOffset = gfxGetVertexBytesCount(buffer);
+    buffer->vertexOffset = buffer->vertexCount;
+    buffer->indexOffset = buffer->indexCount;
+}
+
+// Makes sure count more vertices fit into the current range. If the range has to be split, vertices
+// listed in carried are copied to the new range and carried is updated with their new indices,
+// so geometry which is still being built can keep referencing them.
+static void gfxReserveBatchVerticesInternal(GeometryBuffer* buffer, u32 count, u32* carried, u32 carriedCount)
+{
+    Assert(count + carriedCount <= GeometryBatchMaxVertices);
+    if (buffer->vertexCount - buffer->vertexOffset + count <= GeometryBatchMaxVertices)
+    {
+        return;
+    }
+
+    u32 stride = GetVertexFormatStride(buffer->vertexFormat);
+    byte* oldBase = (byte*)buffer->vertexBuffer + buffer->vertexByteOffset;
+    gfxSplitGeometryBatchInternal(buffer);
+
+    u32 original[4];
+    Assert(carriedCount <= ArrayCount(original));
+    for (u32 i = 0; i < carriedCount; i++)
+    {
+        original[i] = carried[i];
+
+        u32 duplicate = i;
+        for (u32 j = 0; j < i; j++)
+        {
+            if (original[j] == original[i])
+            {
+                duplicate = j;
+                break;
+            }
+        }
+
+        if (duplicate != i)
+        {
+            carried[i] = carried[duplicate];
+            continue;
+        }
+
+        u32 index = buffer->vertexCount - buffer->vertexOffset;
+        mmCopy((byte*)buffer->vertexBuffer + buffer->vertexByteOffset + (uptr)index * stride, oldBase + (uptr)original[i] * stride, stride);
+        buffer->vertexCount++;
+        carried[i] = index;
+    }
+}
+
+static inline u16 gfxPackUnorm16Internal(f32 value)
+{
+    return (u16)(fClamp(0.0f, value, 1.0f) * 65535.0f + 0.5f);
+}
+
+// Writes one vertex in the format of the current batch and returns its batch relative index.
+static inline u32 gfxPushVertexInternal(GeometryBuffer* buffer, Vector2 p, Vector2 uv, u32 color)
+{
+    u32 index = buffer->vertexCount - buffer->vertexOffset;
+    byte* dst = gfxGetBatchVertexInternal(buffer, index);
+
+    switch (buffer->vertexFormat)
+    {
+    case RenderVertexFormat_PositionUvColor:
+    {
+        RenderVertex* vertex = (RenderVertex*)dst;
+        vertex->position = MakeVector3(p.x, p.y, 0.5f);
+        vertex->uv = uv;
+        vertex->vertexColor = color;
+    } break;
+    case RenderVertexFormat_Position2DColor:
+    {
+        RenderVertex2D* vertex = (RenderVertex2D*)dst;
+        vertex->position = p;
+        vertex->vertexColor = color;
+    } break;
+    case RenderVertexFormat_Position2DUv16Color:
+    {
+        RenderVertex2DUv16* vertex = (RenderVertex2DUv16*)dst;
+        vertex->position = p;
+        vertex->uv[0] = gfxPackUnorm16Internal(uv.x);
+        vertex->uv[1] = gfxPackUnorm16Internal(uv.y);
+        vertex->vertexColor = color;
+    } break;
+    InvalidDefault();
+    }
+
+    buffer->vertexCount++;
+    return index;
+}
+
+// NOTE: Writes a segment quad with 16 byte stores for the vertices and 12 bytes of indices.
+// points holds p1 and p2 back to back, offset is the half thickness normal {dy, -dx}.
+// tail is {0.5, 0, 0, color} and colorHead is {0, color, 0, color} as floats.
+static inline void gfxWritePathSegment(byte* vertices, RenderVertexFormat format, u16* indices, u32 baseIndex, const Vector2* points, __m128 offset, __m128 tail, __m128 colorHead)
+{
+    __m128 p = _mm_loadu_ps(&points[0].x);
+    // {v0.x, v0.y, v1.x, v1.y}
+    __m128 a = _mm_add_ps(p, offset);
+    // {v2.x, v2.y, v3.x, v3.y}
+    __m128 b = _mm_sub_ps(p, offset);
+    b = _mm_shuffle_ps(b, b, _MM_SHUFFLE(1, 0, 3, 2));
+
+    f32* dst = (f32*)vertices;
+    switch (format)
+    {
+    case RenderVertexFormat_PositionUvColor:
+    {
+        // Two vertices are three registers: {x0, y0, z, u0} {v0, c, x1, y1} {z, u1, v1, c}
+        _mm_storeu_ps(dst + 0, _mm_movelh_ps(a, tail));
+        _mm_storeu_ps(dst + 4, _mm_shuffle_ps(colorHead, a, _MM_SHUFFLE(3, 2, 1, 0)));
+        _mm_storeu_ps(dst + 8, _mm_movelh_ps(tail, colorHead));
+        _mm_storeu_ps(dst + 12, _mm_movelh_ps(b, tail));
+        _mm_storeu_ps(dst + 16, _mm_shuffle_ps(colorHead, b, _MM_SHUFFLE(3, 2, 1, 0)));
+        _mm_storeu_ps(dst + 20, _mm_movelh_ps(tail, colorHead));
+    } break;
+    case RenderVertexFormat_Position2DColor:
+    {
+        // Four vertices are three registers: {x0, y0, c, x1} {y1, c, x2, y2} {c, x3, y3, c}
+        __m128 ca = _mm_shuffle_ps(colorHead, a, _MM_SHUFFLE(2, 2, 1, 1));
+        __m128 ac = _mm_shuffle_ps(a, colorHead, _MM_SHUFFLE(1, 1, 3, 3));
+        __m128 cb = _mm_shuffle_ps(colorHead, b, _MM_SHUFFLE(2, 2, 1, 1));
+        __m128 bc = _mm_shuffle_ps(b, colorHead, _MM_SHUFFLE(1, 1, 3, 3));
+        _mm_storeu_ps(dst + 0, _mm_shuffle_ps(a, ca, _MM_SHUFFLE(2, 0, 1, 0)));
+        _mm_storeu_ps(dst + 4, _mm_shuffle_ps(ac, b, _MM_SHUFFLE(1, 0, 2, 0)));
+        _mm_storeu_ps(dst + 8, _mm_shuffle_ps(cb, bc, _MM_SHUFFLE(2, 0, 2, 0)));
+    } break;
+    case RenderVertexFormat_Position2DUv16Color:
+    {
+        // One register per vertex: {x, y, uv = 0, c}
+        _mm_storeu_ps(dst + 0, _mm_movelh_ps(a, colorHead));
+        _mm_storeu_ps(dst + 4, _mm_shuffle_ps(a, colorHead, _MM_SHUFFLE(1, 0, 3, 2)));
+        _mm_storeu_ps(dst + 8, _mm_movelh_ps(b, colorHead));
+        _mm_storeu_ps(dst + 12, _mm_shuffle_ps(b, colorHead, _MM_SHUFFLE(1, 0, 3, 2)));
+    } break;
+    InvalidDefault();
+    }
+
+    __m128i quadIndices = _mm_add_epi16(_mm_set1_epi16((i16)baseIndex), _mm_setr_epi16(0, 1, 2, 0, 2, 3, 0, 0));
+    _mm_storel_epi64((__m128i*)indices, quadIndices);
+    _mm_storeu_si32(indices + 4, _mm_srli_si128(quadIndices, 8));
+}
+
+// NOTE: Every segment is an independent quad. Normals are computed 8 (AVX) or 4 (SSE) segments
+// at a time on interleaved {dx, dy} pairs, so no transposes are needed, then quads are written with
+// wide stores. rsqrt and the order of operations match v2Normalize, so results are bit exact with
+// the scalar tail.
+static void gfxEmitPathQuadsInternal(GeometryBuffer* buffer, Vector2* points, u32 segmentsCount, f32 thickness, u32 color)
+{
+    u32 baseIndex = buffer->vertexCount - buffer->vertexOffset;
+    RenderVertexFormat format = buffer->vertexFormat;
+    u32 quadStride = GetVertexFormatStride(format) * 4;
+    byte* vertices = gfxGetBatchVertexInternal(buffer, baseIndex);
+    u16* indices = buffer->indexBuffer + buffer->indexCount;
+    f32 halfThickness = thickness * 0.5f;
+
+    // {z, u} and {v, color} halves of the vertex, see gfxWritePathSegment.
+    __m128 tail = _mm_setr_ps(0.5f, 0.0f, 0.0f, 0.0f);
+    __m128 colorHead = _mm_castsi128_ps(_mm_setr_epi32(0, (i32)color, 0, 0));
+    tail = _mm_movelh_ps(tail, colorHead);
+    colorHead = _mm_shuffle_ps(colorHead, colorHead, _MM_SHUFFLE(1, 0, 1, 0));
+
+    _Alignas(32) f32 offsets[16];
+    u32 i = 0;
+
+#if defined(__AVX__)
+    __m256 half8 = _mm256_set1_ps(halfThickness);
+    __m256 flip8 = _mm256_setr_ps(1.0f, -1.0f, 1.0f, -1.0f, 1.0f, -1.0f, 1.0f, -1.0f);
+    for (; i + 8 <= segmentsCount; i += 8)
+    {
+        __m256 p1a = _mm256_loadu_ps(&points[i].x);
+        __m256 p1b = _mm256_loadu_ps(&points[i + 4].x);
+        __m256 p2a = _mm256_loadu_ps(&points[i + 1].x);
+        __m256 p2b = _mm256_loadu_ps(&points[i + 5].x);
+        __m256 da = _mm256_sub_ps(p2a, p1a);
+        __m256 db = _mm256_sub_ps(p2b, p1b);
+
+        // Squared length in both lanes of every pair.
+        __m256 sa = _mm256_mul_ps(da, da);
+        __m256 sb = _mm256_mul_ps(db, db);
+        sa = _mm256_add_ps(sa, _mm256_permute_ps(sa, _MM_SHUFFLE(2, 3, 0, 1)));
+        sb = _mm256_add_ps(sb, _mm256_permute_ps(sb, _MM_SHUFFLE(2, 3, 0, 1)));
+
+        // Degenerate segments keep zero direction like v2Normalize.
+        __m256 ia = _mm256_and_ps(_mm256_rsqrt_ps(sa), _mm256_cmp_ps(sa, _mm256_setzero_ps(), _CMP_GT_OQ));
+        __m256 ib = _mm256_and_ps(_mm256_rsqrt_ps(sb), _mm256_cmp_ps(sb, _mm256_setzero_ps(), _CMP_GT_OQ));
+        __m256 na = _mm256_mul_ps(_mm256_mul_ps(da, ia), half8);
+        __m256 nb = _mm256_mul_ps(_mm256_mul_ps(db, ib), half8);
+
+        // {dx, dy} -> {dy, -dx}
+        _mm256_store_ps(offsets + 0, _mm256_mul_ps(_mm256_permute_ps(na, _MM_SHUFFLE(2, 3, 0, 1)), flip8));
+        _mm256_store_ps(offsets + 8, _mm256_mul_ps(_mm256_permute_ps(nb, _MM_SHUFFLE(2, 3, 0, 1)), flip8));
+
+        for (u32 k = 0; k < 8; k++)
+        {
+            __m128 offset = _mm_castpd_ps(_mm_load1_pd((const f64*)(offsets + k * 2)));
+            gfxWritePathSegment(vertices + (i + k) * quadStride, format, indices + (i + k) * 6, baseIndex + (i + k) * 4, points + i + k, offset, tail, colorHead);
+        }
+    }
+#endif
+
+    __m128 half4 = _mm_set1_ps(halfThickness);
+    __m128 flip4 = _mm_setr_ps(1.0f, -1.0f, 1.0f, -1.0f);
+    for (; i + 4 <= segmentsCount; i += 4)
+    {
+        __m128 p1a = _mm_loadu_ps(&points[i].x);
+        __m128 p1b = _mm_loadu_ps(&points[i + 2].x);
+        __m128 p2a = _mm_loadu_ps(&points[i + 1].x);
+        __m128 p2b = _mm_loadu_ps(&points[i + 3].x);
+        __m128 da = _mm_sub_ps(p2a, p1a);
+        __m128 db = _mm_sub_ps(p2b, p1b);
+
+        __m128 sa = _mm_mul_ps(da, da);
+        __m128 sb = _mm_mul_ps(db, db);
+        sa = _mm_add_ps(sa, _mm_shuffle_ps(sa, sa, _MM_SHUFFLE(2, 3, 0, 1)));
+        sb = _mm_add_ps(sb, _mm_shuffle_ps(sb, sb, _MM_SHUFFLE(2, 3, 0, 1)));
+
+        __m128 ia = _mm_and_ps(_mm_rsqrt_ps(sa), _mm_cmpgt_ps(sa, _mm_setzero_ps()));
+        __m128 ib = _mm_and_ps(_mm_rsqrt_ps(sb), _mm_cmpgt_ps(sb, _mm_setzero_ps()));
+        __m128 na = _mm_mul_ps(_mm_mul_ps(da, ia), half4);
+        __m128 nb = _mm_mul_ps(_mm_mul_ps(db, ib), half4);
+
+        _mm_store_ps(offsets + 0, _mm_mul_ps(_mm_shuffle_ps(na, na, _MM_SHUFFLE(2, 3, 0, 1)), flip4));
+        _mm_store_ps(offsets + 4, _mm_mul_ps(_mm_shuffle_ps(nb, nb, _MM_SHUFFLE(2, 3, 0, 1)), flip4));
+
+        for (u32 k = 0; k < 4; k++)
+        {
+            __m128 offset = _mm_castpd_ps(_mm_load1_pd((const f64*)(offsets + k * 2)));
+            gfxWritePathSegment(vertices + (i + k) * quadStride, format, indices + (i + k) * 6, baseIndex + (i + k) * 4, points + i + k, offset, tail, colorHead);
+        }
+    }
+
+    for (; i < segmentsCount; i++)
+    {
+        Vector2 p1 = points[i];
+        Vector2 p2 = points[i + 1];
+
+        Vector2 d = MakeVector2(p2.x - p1.x, p2.y - p1.y);
+        d = v2Normalize(d);
+        f32 dx = d.x * halfThickness;
+        f32 dy = d.y * halfThickness;
+
+        __m128 offset = _mm_setr_ps(dy, -dx, dy, -dx);
+        gfxWritePathSegment(vertices + i * quadStride, format, indices + i * 6, baseIndex + i * 4, points + i, offset, tail, colorHead);
+    }
+
+    buffer->vertexCount += segmentsCount * 4;
+    buffer->indexCount += segmentsCount * 6;
+}
+
+b32 gfxEmitPathGeometry(GeometryBuffer* buffer, Vector2* points, u32 pointsCount, f32 thickness, u32 color)
+{
+    if (pointsCount < 2)
+    {
+        return true;
+    }
+
+    if (!gfxCommitGeometryPagesInternal(buffer, (pointsCount - 1) * 4, (pointsCount - 1) * 6, 0))
+    {
+        return false;
+    }
+
+    // Quads are independent, so a path which does not fit is continued in a new range.
+    u32 segmentsCount = pointsCount - 1;
+    u32 first = 0;
+    while (first < segmentsCount)
+    {
+        u32 freeQuads = (GeometryBatchMaxVertices - (buffer->vertexCount - buffer->vertexOffset)) / 4;
+        if (freeQuads == 0)
+        {
+            gfxSplitGeometryBatchInternal(buffer);
+            continue;
+        }
+
+        u32 count = segmentsCount - first < freeQuads ? segmentsCount - first : freeQuads;
+        gfxEmitPathQuadsInternal(buffer, points + first, count, thickness, color);
+        first += count;
+    }
+
+    return true;
+}
+
+// NOTE: Writes one 24 byte record per segment, the backend expands it to the same quad
+// gfxEmitPathGeometry would produce. p1 and p2 are copied straight from the point array.
+b32 gfxEmitPathSegments(GeometryBuffer* buffer, Vector2* points, u32 pointsCount, f32 thickness, u32 color)
+{
+    if (pointsCount < 2)
+    {
+        return true;
+    }
+
+    if (!gfxCommitGeometryPagesInternal(buffer, 0, 0, pointsCount - 1))
+    {
+        return false;
+    }
+
+    u32 segmentsCount = pointsCount - 1;
+    RenderLineSegment* segments = buffer->segmentBuffer + buffer->segmentCount;
+
+    __m128i tail = _mm_setr_epi32(0, (i32)color, 0, 0);
+    tail = _mm_castps_si128(_mm_move_ss(_mm_castsi128_ps(tail), _mm_set_ss(thickness)));
+
+    for (u32 i = 0; i < segmentsCount; i++)
+    {
+        _mm_storeu_ps(&segments[i].p1.x, _mm_loadu_ps(&points[i].x));
+        _mm_storel_epi64((__m128i*)&segments[i].thickness, tail);
+    }
+
+    buffer->segmentCount += segmentsCount;
+    return true;
+}
+
+static inline u32 gfxPushPathVertexInternal(GeometryBuffer* buffer, Vector2 p, u32 color)
+{
+    return gfxPushVertexInternal(buffer, p, MakeVector2(0.0f, 0.0f), color);
+}
+
+static inline void gfxPushTriangleInternal(GeometryBuffer* buffer, u32 a, u32 b, u32 c)
+{
+    u16* indices = buffer->indexBuffer + buffer->indexCount;
+    indices[0] = (u16)a;
+    indices[1] = (u16)b;
+    indices[2] = (u16)c;
+    buffer->indexCount += 3;
+}
+
+// NOTE: Pairs are {+normal side, -normal side}, normal is {dy, -dx} like in gfxEmitPathGeometry.
+static inline void gfxPushPathQuadInternal(GeometryBuffer* buffer, const u32* from, const u32* to)
+{
+    gfxPushTriangleInternal(buffer, from[0], to[0], to[1]);
+    gfxPushTriangleInternal(buffer, to[1], from[1], from[0]);
+}
+
+// Returns the first point after index which is not equal to points[index]. Repeated points have no direction.
+static inline u32 gfxNextPathPointInternal(const Vector2* points, u32 pointsCount, u32 index)
+{
+    u32 next = index + 1;
+    while (next < pointsCount && points[next].x == points[index].x && points[next].y == points[index].y)
+    {
+        next++;
+    }
+
+    return next;
+}
+
+// Outer and inner pairs, the hub and up to 15 arc vertices of a round join.
+#define PathJointMaxVertices (20)
+
+// Emits the vertices around an interior point with incoming direction d0 and outgoing direction d1.
+// Writes the pair which ends the incoming segment to inPair and the pair which starts the outgoing
+// one to outPair. A miter shares both vertices. Bevel and round joins share the inner vertex and fill
+// the outer corner with a fan around it. When the inner miter point would be further away than the
+// shorter segment, the inner side is not shared and the fan goes around the path point instead.
+static void gfxEmitPathJointInternal(GeometryBuffer* buffer, Vector2 p, Vector2 d0, f32 length0, Vector2 d1, f32 length1, f32 halfThickness, u32 color, PathDrawParams params, u32* inPair, u32* outPair)
+{
+    Vector2 n0 = MakeVector2(d0.y, -d0.x);
+    Vector2 n1 = MakeVector2(d1.y, -d1.x);
+    f32 cosAngle = v2Dot(d0, d1);
+    f32 onePlusCos = 1.0f + cosAngle;
+
+    // Offset to the miter point is (n0 + n1) * h / (1 + cos), its length is h / cos(angle / 2).
+    bool hasMiter = onePlusCos > 1.0e-4f;
+    Vector2 miter = {0};
+    f32 miterRatioSq = f32_Infinity;
+    if (hasMiter)
+    {
+        miter = v2Scale(v2Add(n0, n1), halfThickness / onePlusCos);
+        miterRatioSq = 2.0f / onePlusCos;
+    }
+
+    bool nearlyStraight = cosAngle > 0.9999f;
+    bool miterFits = params.joinType == PathJoinType_Miter && miterRatioSq <= params.miterLimit * params.miterLimit;
+    if (nearlyStraight || miterFits)
+    {
+        inPair[0] = gfxPushPathVertexInternal(buffer, v2Add(p, miter), color);
+        inPair[1] = gfxPushPathVertexInternal(buffer, v2Sub(p, miter), color);
+        outPair[0] = inPair[0];
+        outPair[1] = inPair[1];
+        return;
+    }
+
+    // Outer side is the one the path turns away from.
+    f32 side = v2Dot(d1, n0) > 0.0f ? -1.0f : 1.0f;
+    u32 outerSlot = side > 0.0f ? 0 : 1;
+    u32 innerSlot = outerSlot ^ 1;
+
+    Vector2 outer0 = v2Scale(n0, side * halfThickness);
+    Vector2 outer1 = v2Scale(n1, side * halfThickness);
+    inPair[outerSlot] = gfxPushPathVertexInternal(buffer, v2Add(p, outer0), color);
+    outPair[outerSlot] = gfxPushPathVertexInternal(buffer, v2Add(p, outer1), color);
+
+    // Distance from p to the inner miter point along the segments is h * tan(angle / 2).
+    f32 shortestSq = fMin(length0 * length0, length1 * length1);
+    u32 hub;
+    if (hasMiter && halfThickness * halfThickness * (miterRatioSq - 1.0f) <= shortestSq)
+    {
+        hub = gfxPushPathVertexInternal(buffer, v2Sub(p, v2Scale(miter, side)), color);
+        inPair[innerSlot] = hub;
+        outPair[innerSlot] = hub;
+    }
+    else
+    {
+        inPair[innerSlot] = gfxPushPathVertexInternal(buffer, v2Sub(p, outer0), color);
+        outPair[innerSlot] = gfxPushPathVertexInternal(buffer, v2Sub(p, outer1), color);
+        hub = gfxPushPathVertexInternal(buffer, p, color);
+    }
+
+    if (params.joinType != PathJoinType_Round)
+    {
+        gfxPushTriangleInternal(buffer, hub, inPair[outerSlot], outPair[outerSlot]);
+        return;
+    }
+
+    // NOTE: Arc step keeps the chord within a quarter of a pixel from the circle.
+    f32 angle = fAcos(fClamp(-1.0f, cosAngle, 1.0f));
+    f32 maxStep = halfThickness > 0.25f ? 2.0f * fAcos(1.0f - 0.25f / halfThickness) : f32_Pi;
+    u32 stepsCount = (u32)iClamp(1, (i32)fCeil(angle / maxStep), 16);
+    f32 step = angle / stepsCount;
+    if (v2Cross(d0, d1) < 0.0f)
+    {
+        step = -step;
+    }
+
+    f32 stepCos = fCos(step);
+    f32 stepSin = fSin(step);
+    Vector2 arc = outer0;
+    u32 prev = inPair[outerSlot];
+    for (u32 i = 1; i < stepsCount; i++)
+    {
+        arc = MakeVector2(arc.x * stepCos - arc.y * stepSin, arc.x * stepSin + arc.y * stepCos);
+        u32 current = gfxPushPathVertexInternal(buffer, v2Add(p, arc), color);
+        gfxPushTriangleInternal(buffer, hub, prev, current);
+        prev = current;
+    }
+
+    gfxPushTriangleInternal(buffer, hub, prev, outPair[outerSlot]);
+}
+
+// NOTE: Consecutive segments share vertices at joins, so a polyline with miter joins costs two vertices
+// per point instead of four per segment and corners are covered exactly once. Ends use butt caps.
+// A path whose last point equals the first one is closed and gets a join at the seam too.
+b32 gfxEmitJoinedPathGeometry(GeometryBuffer* buffer, Vector2* points, u32 pointsCount, f32 thickness, u32 color, PathDrawParams params)
+{
+    if (pointsCount < 2)
+    {
+        return true;
+    }
+
+    if (!gfxCommitGeometryPagesInternal(buffer, (pointsCount + 1) * (PathJointMaxVertices + 4), (pointsCount + 1) * (PathJointMaxVertices * 3 + 6), 0))
+    {
+        return false;
+    }
+
+    u32 i1 = gfxNextPathPointInternal(points, pointsCount, 0);
+    if (i1 >= pointsCount)
+    {
+        return true;
+    }
+
+    f32 halfThickness = thickness * 0.5f;
+    Vector2 p0 = points[0];
+    Vector2 delta0 = v2Sub(points[i1], p0);
+    f32 length0 = fSqrt(v2Dot(delta0, delta0));
+    Vector2 d0 = v2Scale(delta0, 1.0f / length0);
+
+    // NOTE: prevPair and startPair stay referenced while the path is built, so they are carried over
+    // when the batch range is split.
+    u32 pairs[4];
+    u32* prevPair = pairs;
+    u32* startPair = pairs + 2;
+    u32 carriedCount = 2;
+
+    bool closed = pointsCount > 2 && points[pointsCount - 1].x == p0.x && points[pointsCount - 1].y == p0.y;
+    u32 closingIndex = pointsCount - 1;
+    if (closed)
+    {
+        // Last point which differs from the seam.
+        while (closingIndex > 0 && points[closingIndex].x == p0.x && points[closingIndex].y == p0.y)
+        {
+            closingIndex--;
+        }
+
+        closed = closingIndex > 0;
+    }
+
+    if (closed)
+    {
+        gfxReserveBatchVerticesInternal(buffer, PathJointMaxVertices, NULL, 0);
+        carriedCount = 4;
+        Vector2 delta = v2Sub(p0, points[closingIndex]);
+        f32 length = fSqrt(v2Dot(delta, delta));
+        Vector2 d = v2Scale(delta, 1.0f / length);
+        gfxEmitPathJointInternal(buffer, p0, d, length, d0, length0, halfThickness, color, params, startPair, prevPair);
+    }
+    else
+    {
+        gfxReserveBatchVerticesInternal(buffer, 2, NULL, 0);
+        Vector2 offset = v2Scale(MakeVector2(d0.y, -d0.x), halfThickness);
+        prevPair[0] = gfxPushPathVertexInternal(buffer, v2Add(p0, offset), color);
+        prevPair[1] = gfxPushPathVertexInternal(buffer, v2Sub(p0, offset), color);
+    }
+
+    while (true)
+    {
+        u32 i2 = gfxNextPathPointInternal(points, pointsCount, i1);
+        Vector2 p1 = points[i1];
+
+        if (i2 >= pointsCount)
+        {
+            if (closed)
+            {
+                gfxPushPathQuadInternal(buffer, prevPair, startPair);
+            }
+            else
+            {
+                gfxReserveBatchVerticesInternal(buffer, 2, pairs, carriedCount);
+                Vector2 offset = v2Scale(MakeVector2(d0.y, -d0.x), halfThickness);
+                u32 endPair[2];
+                endPair[0] = gfxPushPathVertexInternal(buffer, v2Add(p1, offset), color);
+                endPair[1] = gfxPushPathVertexInternal(buffer, v2Sub(p1, offset), color);
+                gfxPushPathQuadInternal(buffer, prevPair, endPair);
+            }
+            break;
+        }
+
+        Vector2 delta1 = v2Sub(points[i2], p1);
+        f32 length1 = fSqrt(v2Dot(delta1, delta1));
+        Vector2 d1 = v2Scale(delta1, 1.0f / length1);
+
+        u32 inPair[2];
+        u32 outPair[2];
+        gfxReserveBatchVerticesInternal(buffer, PathJointMaxVertices, pairs, carriedCount);
+        gfxEmitPathJointInternal(buffer, p1, d0, length0, d1, length1, halfThickness, color, params, inPair, outPair);
+        gfxPushPathQuadInternal(buffer, prevPair, inPair);
+
+        prevPair[0] = outPair[0];
+        prevPair[1] = outPair[1];
+        d0 = d1;
+        length0 = length1;
+        i1 = i2;
+    }
+
+    return true;
+}
+
+b32 gfxEmitQuadGeometry(GeometryBuffer* buffer, Vector2 min, Vector2 max, Vector2 uv0, Vector2 uv1, u32 vertexColor)
+{
+    if (!gfxCommitGeometryPagesInternal(buffer, 4, 6, 0))
+    {
+        return false;
+    }
+
+    gfxReserveBatchVerticesInternal(buffer, 4, NULL, 0);
+    u32 vIndex = gfxPushVertexInternal(buffer, min, uv0, vertexColor);
+    gfxPushVertexInternal(buffer, MakeVector2(max.x, min.y), MakeVector2(uv1.x, uv0.y), vertexColor);
+    gfxPushVertexInternal(buffer, max, uv1, vertexColor);
+    gfxPushVertexInternal(buffer, MakeVector2(min.x, max.y), MakeVector2(uv0.x, uv1.y), vertexColor);
+
+    u32 iIndex = buffer->indexCount;
+    buffer->indexBuffer[iIndex + 0] = (u16)(vIndex + 0);
+    buffer->indexBuffer[iIndex + 1] = (u16)(vIndex + 1);
+    buffer->indexBuffer[iIndex + 2] = (u16)(vIndex + 2);
+    buffer->indexBuffer[iIndex + 3] = (u16)(vIndex + 2);
+    buffer->indexBuffer[iIndex + 4] = (u16)(vIndex + 3);
+    buffer->indexBuffer[iIndex + 5] = (u16)(vIndex + 0);
+    buffer->indexCount += 6;
+    return true;
+}
+
+// NOTE: Emits glyph quads into buffer, or writes them to quads when buffer is NULL. Returns the quads count.
+static u32 gfxLayoutTextBoxInternal(GeometryBuffer* buffer, TextLayoutQuad* quads, Rectangle2D rect, TextDrawBatch* batches, u32 count, TextDrawParams params, MemoryStack* scratch, Rectangle2D* outBoundingBox, u32* outLinesCount)
+{
+    MemoryStackScope scratchScope = mmBeginStackScope(scratch);
+    TextBoxLinesInternal lines;
+    gfxBreakTextBoxLinesInternal(scratch, rect, batches, count, params, true, &lines);
+
+    u32 quadsCount = 0;
+    Vector2 drawPosition = MakeVector2(rect.min.x, lines.boundingBox.max.y);
+    f32 maxWidth = rect.max.x - rect.min.x;
+
+    for (u32 i = 0; i < lines.linesCount; i++)
+    {
+        TextLineInfo* line = lines.lines + i;
+
+        drawPosition.x += fAbs(maxWidth - line->width) * params.horzAlignment;
+        drawPosition.y -= line->ascent;
+
+        for (u32 i = 0; i < line->glyphsCount; i++)
+        {
+            LineCacheEntry e = lines.glyphs[line->firstGlyph + i];
+            FontGlyphInfo* g = e.glyph;
+            f32 scale = e.scale;
+            u32 color = e.color;
+            drawPosition.x += e.kerning;
+            Vector2 min = v2Add(drawPosition, v2Scale(g->min, scale));
+            Vector2 max = v2Add(drawPosition, v2Scale(g->max, scale));
+            if (buffer != NULL)
+            {
+                gfxEmitQuadGeometry(buffer, min, max, g->uv0, g->uv1, color);
+            }
+            else
+            {
+                TextLayoutQuad* quad = quads + quadsCount;
+                quad->min = min;
+                quad->max = max;
+                quad->uv0 = g->uv0;
+                quad->uv1 = g->uv1;
+                quad->color = color;
+            }
+
+            quadsCount++;
+            drawPosition.x += g->advance * scale;
+        }
+
+        drawPosition.x = rect.min.x;
+        drawPosition.y += line->descent + line->lineGap;
+    }
+
+    if (outBoundingBox != NULL)
+    {
+        *outBoundingBox = lines.boundingBox;
+    }
+
+    if (outLinesCount != NULL)
+    {
+        *outLinesCount = lines.linesCount;
+    }
+
+    mmEndStackScope(scratchScope);
+    return quadsCount;
+}
+
+void gfxEmitTextBoxGeometry(GeometryBuffer* buffer, Rectangle2D rect, TextDrawBatch* batches, u32 count, TextDrawParams params, MemoryStack* scratch)
+{
+    gfxLayoutTextBoxInternal(buffer, NULL, rect, batches, count, params, scratch, NULL, NULL);
+}
+
+// NOTE: Hashes the UTF-8 bytes as they are, nothing has to be decoded to find a cached layout.
+u64 gfxHashTextLayoutKey(const char* utf8Text, Font* font, f32 height, u32 color, Rectangle2D rect, TextDrawParams params)
+{
+    u64 key = gfxHashGeometryKey(0, utf8Text, asciiStringLength(utf8Text));
+    key = gfxHashGeometryKey(key, &font, sizeof(font));
+    key = gfxHashGeometryKey(key, &height, sizeof(height));
+    key = gfxHashGeometryKey(key, &color, sizeof(color));
+    key = gfxHashGeometryKey(key, &rect, sizeof(rect));
+    key = gfxHashGeometryKey(key, &params, sizeof(params));
+    return key;
+}
+
+void gfxInitTextLayoutCache(TextLayoutCache* cache, MemoryStack* dataStack)
+{
+    mmSet(cache, 0, sizeof(TextLayoutCache));
+    cache->dataStack = dataStack;
+    cache->dataScope = mmBeginStackScope(dataStack);
+    cache->entryPool = mmCreatePool(dataStack, sizeof(TextLayout), 16, 64, dataStack->failStrategy, "Text Layout Entries");
+}
+
+void gfxResetTextLayoutCache(TextLayoutCache* cache)
+{
+    mmPoolReset(&cache->entryPool);
+    mmEndStackScope(cache->dataScope);
+    mmSet(cache->buckets, 0, sizeof(cache->buckets));
+    cache->entriesCount = 0;
+    cache->liveBytes = 0;
+    cache->staleBytes = 0;
+}
+
+static TextLayout* gfxFindTextLayoutInternal(TextLayoutCache* cache, u64 key)
+{
+    TextLayout* layout = cache->buckets[key % TextLayoutBucketsCount];
+    while (layout != NULL && layout->key != key)
+    {
+        layout = layout->next;
+    }
+
+    return layout;
+}
+
+TextLayout* gfxFindTextLayout(TextLayoutCache* cache, u64 key)
+{
+    TextLayout* layout = gfxFindTextLayoutInternal(cache, key);
+    if (layout != NULL)
+    {
+        layout->lastUsedFrame = cache->frameIndex;
+        cache->frameHitsCount++;
+    }
+    else
+    {
+        cache->frameMissesCount++;
+    }
+
+    return layout;
+}
+
+// NOTE: Lays the batches out and stores the result under key. Returns NULL when the data stack is full,
+// the caller can still emit the text with gfxEmitTextBoxGeometry.
+TextLayout* gfxLayoutTextBox(TextLayoutCache* cache, u64 key, Rectangle2D rect, TextDrawBatch* batches, u32 count, TextDrawParams params, MemoryStack* scratch)
+{
+    Assert(gfxFindTextLayoutInternal(cache, key) == NULL);
+
+    TextLayout* layout = (TextLayout*)mmPoolAlloc(&cache->entryPool);
+    if (layout == NULL)
+    {
+        return NULL;
+    }
+
+    // Every character gets at most one quad and takes at least one byte.
+    u32 maxQuadsCount = 0;
+    for (u32 i = 0; i < count; i++)
+    {
+        maxQuadsCount += batches[i].dataCount;
+    }
+
+    mmSet(layout, 0, sizeof(TextLayout));
+    layout->key = key;
+    layout->lastUsedFrame = cache->frameIndex;
+    layout->quads = (TextLayoutQuad*)mmStackPush(cache->dataStack, sizeof(TextLayoutQuad) * maxQuadsCount);
+    if (layout->quads == NULL && maxQuadsCount != 0)
+    {
+        mmPoolFree(&cache->entryPool, layout);
+        return NULL;
+    }
+
+    layout->quadsCount = gfxLayoutTextBoxInternal(NULL, layout->quads, rect, batches, count, params, scratch, &layout->boundingBox, &layout->linesCount);
+    layout->dataSize = sizeof(TextLayoutQuad) * maxQuadsCount;
+
+    u32 bucket = key % TextLayoutBucketsCount;
+    layout->next = cache->buckets[bucket];
+    cache->buckets[bucket] = layout;
+    cache->entriesCount++;
+    cache->liveBytes += layout->dataSize;
+    return layout;
+}
+
+// NOTE: Call once per frame, layouts it did not look up are dropped.
+void gfxEndTextLayoutFrame(TextLayoutCache* cache)
+{
+    for (u32 i = 0; i < TextLayoutBucketsCount; i++)
+    {
+        TextLayout** link = cache->buckets + i;
+        while (*link != NULL)
+        {
+            TextLayout* layout = *link;
+            if (layout->lastUsedFrame != cache->frameIndex)
+            {
+                *link = layout->next;
+                cache->entriesCount--;
+                cache->liveBytes -= layout->dataSize;
+                cache->staleBytes += layout->dataSize;
+                mmPoolFree(&cache->entryPool, layout);
+            }
+            else
+            {
+                link = &layout->next;
+            }
+        }
+    }
+
+    if (cache->staleBytes > cache->liveBytes)
+    {
+        gfxResetTextLayoutCache(cache);
+    }
+
+    cache->frameIndex++;
+    cache->frameHitsCount = 0;
+    cache->frameMissesCount = 0;
+}
+
+void gfxEmitTextLayoutGeometry(GeometryBuffer* buffer, TextLayout* layout)
+{
+    for (u32 i = 0; i < layout->quadsCount; i++)
+    {
+        TextLayoutQuad* quad = layout->quads + i;
+        gfxEmitQuadGeometry(buffer, quad->min, quad->max, quad->uv0, quad->uv1, quad->color);
+    }
+}
+
+void rcmdResetCommandBuffer(RenderCommandBuffer* commandBuffer)
+{
+    commandBuffer->renderCommandsCount = 0;
+    commandBuffer->activeMaterialIndex = u32_Max;
+    commandBuffer->sortLayer = 0;
+    commandBuffer->sortDepth = 0.0f;
+}
+
+void rcmdSetSortLayer(RenderCommandBuffer* commandBuffer, u32 layer)
+{
+    Assert(layer <= 0xff);
+    commandBuffer->sortLayer = layer;
+}
+
+void rcmdSetSortDepth(RenderCommandBuffer* commandBuffer, f32 depth)
+{
+    commandBuffer->sortDepth = depth;
+}
+
+// NOTE: Sort key layout from the most significant bit: layer (8) | material type (4) | material hash (20) | depth (32).
+// Hash collisions only cost extra material switches, sorted submission compares the actual materials.
+static u64 rcmdMakeSortKeyInternal(RenderCommandBuffer* commandBuffer)
+{
+    u64 materialType = 0;
+    u64 materialHash = 0;
+    if (commandBuffer->activeMaterialIndex < commandBuffer->renderCommandsCount)
+    {
+        RenderCommandEntry* material = commandBuffer->commands + commandBuffer->activeMaterialIndex;
+        materialType = (u64)material->setMaterial.type + 1;
+        u64 hash = material->setMaterial.textureId.data0 ^ (material->setMaterial.textureId.data1 * 0x9e3779b97f4a7c15ull) ^ (material->setMaterial.sampler.data0 << 32);
+        materialHash = (hash * 0xff51afd7ed558ccdull) >> 44;
+    }
+
+    // Flip floats so that their bits compare like the values.
+    u32 depthBits;
+    mmCopy(&depthBits, &commandBuffer->sortDepth, sizeof(u32));
+    depthBits = (depthBits & 0x80000000) ? ~depthBits : (depthBits | 0x80000000);
+
+    return ((u64)commandBuffer->sortLayer << 56) | (materialType << 52) | (materialHash << 32) | depthBits;
+}
+
+// NOTE: Returns NULL when the command pages can not grow, the pages handle the failure according to their failStrategy.
+RenderCommandEntry* rcmdPushCommand(RenderCommandBuffer* commandBuffer)
+{
+    if (commandBuffer->commandPages != NULL &&
+        !mmCommitVirtualRange(commandBuffer->commandPages, sizeof(RenderCommandEntry) * ((uptr)commandBuffer->renderCommandsCount + 1)))
+    {
+        return NULL;
+    }
+
+    return commandBuffer->commands + commandBuffer->renderCommandsCount++;
+}
+
+static inline b32 rcmdPushCommandCopyInternal(RenderCommandBuffer* commandBuffer, RenderCommandEntry* entry)
+{
+    RenderCommandEntry* command = rcmdPushCommand(commandBuffer);
+    if (command == NULL)
+    {
+        return false;
+    }
+
+    *command = *entry;
+    return true;
+}
+
+static void rcmdRebaseIndicesInternal(u16* indices, u32 count, u32 offset)
+{
+    __m128i offset8 = _mm_set1_epi16((i16)offset);
+    u32 i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        __m128i* p = (__m128i*)(indices + i);
+        _mm_storeu_si128(p, _mm_add_epi16(_mm_loadu_si128(p), offset8));
+    }
+
+    for (; i < count; i++)
+    {
+        indices[i] = (u16)(indices[i] + offset);
+    }
+}
+
+// NOTE: Geometry is laid out back to back, so a draw which directly follows the previous one in memory
+// is appended to it. Mesh draws rebase their indices past the vertices of the previous draw.
+static bool rcmdTryMergeDrawInternal(RenderCommandBuffer* commandBuffer, RenderCommandEntry* draw)
+{
+    if (!commandBuffer->mergeCommands || commandBuffer->renderCommandsCount == 0)
+    {
+        return false;
+    }
+
+    // A draw right before this one was issued with the same material.
+    RenderCommandEntry* last = commandBuffer->commands + commandBuffer->renderCommandsCount - 1;
+    if (last->command != draw->command || last->sortKey != draw->sortKey)
+    {
+        return false;
+    }
+
+    if (draw->command == RenderCommand_DrawMeshImmediate)
+    {
+        u32 lastVertexCount = last->drawMeshImmediate.vertexCount;
+        RenderVertexFormat format = draw->drawMeshImmediate.vertexFormat;
+        if (last->drawMeshImmediate.transform != draw->drawMeshImmediate.transform ||
+            last->drawMeshImmediate.vertexFormat != format ||
+            last->drawMeshImmediate.indexFormat != RenderIndexFormat_U16 ||
+            draw->drawMeshImmediate.indexFormat != RenderIndexFormat_U16 ||
+            (byte*)last->drawMeshImmediate.vertices + (uptr)lastVertexCount * GetVertexFormatStride(format) != draw->drawMeshImmediate.vertices ||
+            (u16*)last->drawMeshImmediate.indices + last->drawMeshImmediate.indexCount != draw->drawMeshImmediate.indices ||
+            lastVertexCount + draw->drawMeshImmediate.vertexCount > GeometryBatchMaxVertices)
+        {
+            return false;
+        }
+
+        rcmdRebaseIndicesInternal((u16*)draw->drawMeshImmediate.indices, draw->drawMeshImmediate.indexCount, lastVertexCount);
+        last->drawMeshImmediate.vertexCount += draw->drawMeshImmediate.vertexCount;
+        last->drawMeshImmediate.indexCount += draw->drawMeshImmediate.indexCount;
+        return true;
+    }
+
+    if (draw->command == RenderCommand_DrawLineSegments)
+    {
+        if (last->drawLineSegments.transform != draw->drawLineSegments.transform ||
+            last->drawLineSegments.segments + last->drawLineSegments.segmentCount != draw->drawLineSegments.segments)
+        {
+            return false;
+        }
+
+        last->drawLineSegments.segmentCount += draw->drawLineSegments.segmentCount;
+        return true;
+    }
+
+    return false;
+}
 
-} DrawTextState;
+static void rcmdPushDrawInternal(RenderCommandBuffer* commandBuffer, RenderCommandEntry* draw)
+{
+    if (!rcmdTryMergeDrawInternal(commandBuffer, draw))
+    {
+        rcmdPushCommandCopyInternal(commandBuffer, draw);
+    }
+}
 
-void gfxPrepareNextTextLineInternal(DrawTextState* state, bool writeLineCache);
-void gfxSetupLineCacheInternal(DrawTextState* state);
+static void rcmdPushGeometryRangeInternal(RenderCommandBuffer* commandBuffer, GeometryBuffer* buffer, uptr vertexByteOffset, u32 vertexCount, u32 indexOffset, u32 indexCount, Matrix4x4* transform)
+{
+    RenderCommandEntry command = {0};
+    command.command = RenderCommand_DrawMeshImmediate;
+    command.sortKey = rcmdMakeSortKeyInternal(commandBuffer);
+
+    command.drawMeshImmediate.vertexCount = vertexCount;
+    command.drawMeshImmediate.indexCount = indexCount;
+    command.drawMeshImmediate.vertexFormat = buffer->vertexFormat;
+    command.drawMeshImmediate.indexFormat = RenderIndexFormat_U16;
+    command.drawMeshImmediate.vertices = (byte*)buffer->vertexBuffer + vertexByteOffset;
+    command.drawMeshImmediate.indices = buffer->indexBuffer + indexOffset;
+    // TODO: Store it
+    command.drawMeshImmediate.transform = transform;
 
-u32 gfxPackColor(Vector4 color)
+    rcmdPushDrawInternal(commandBuffer, &command);
+}
+
+void rcmdPushGeometryBatch(RenderCommandBuffer* commandBuffer, GeometryBuffer* buffer, Matrix4x4* transform)
 {
-    byte r = (byte)(fClamp(0.0f, color.x, 1.0f) * 255.0f);
-    byte g = (byte)(fClamp(0.0f, color.y, 1.0f) * 255.0f);
-    byte b = (byte)(fClamp(0.0f, color.z, 1.0f) * 255.0f);
-    byte a = (byte)(fClamp(0.0f, color.w, 1.0f) * 255.0f);
+    for (u32 i = buffer->rangeOffset; i < buffer->rangeCount; i++)
+    {
+        GeometryBatchRange* range = buffer->rangeBuffer + i;
+        rcmdPushGeometryRangeInternal(commandBuffer, buffer, range->vertexByteOffset, range->vertexCount, range->indexOffset, range->indexCount, transform);
+    }
 
-    u32 result = r | (g << 8) | (b << 16) | (a << 24);
-    return result;
+    rcmdPushGeometryRangeInternal(commandBuffer, buffer, buffer->vertexByteOffset, buffer->vertexCount - buffer->vertexOffset, buffer->indexOffset, buffer->indexCount - buffer->indexOffset, transform);
 }
 
-Vector4 gfxUnpackColor(u32 color)
+void rcmdPushLineSegmentsBatch(RenderCommandBuffer* commandBuffer, GeometryBuffer* buffer, Matrix4x4* transform)
 {
-    byte r = color & 0xff000000;
-    byte g = color & 0x00ff0000;
-    byte b = color & 0x0000ff00;
-    byte a = color & 0x000000ff;
+    RenderCommandEntry command = {0};
+    command.command = RenderCommand_DrawLineSegments;
+    command.sortKey = rcmdMakeSortKeyInternal(commandBuffer);
 
-    const f32 d = 1.0f / 255.0f;
-    Vector4 result = MakeVector4(r * d, g * d, b * d, a * d);
-    return result;
+    command.drawLineSegments.segmentCount = buffer->segmentCount - buffer->segmentOffset;
+    command.drawLineSegments.segments = buffer->segmentBuffer + buffer->segmentOffset;
+    // TODO: Store it
+    command.drawLineSegments.transform = transform;
+
+    rcmdPushDrawInternal(commandBuffer, &command);
 }
 
-// TODO: These are _EXTREMELY_ inefficient. Only for development.
-f32 _gfxColorToLinear(f32 a)
+static inline bool rcmdMaterialsEqualInternal(RenderCommandEntry* a, RenderCommandEntry* b)
 {
-    bool cutoff = a <  0.04045f;
-    f32 higher = fPow((a + 0.055f) / 1.055f, 2.4f);
-    f32 lower = a / 12.92f;
-    return fLerp(higher, cutoff, lower);
+    return a->setMaterial.type == b->setMaterial.type &&
+        a->setMaterial.textureId.data0 == b->setMaterial.textureId.data0 &&
+        a->setMaterial.textureId.data1 == b->setMaterial.textureId.data1 &&
+        a->setMaterial.sampler.data0 == b->setMaterial.sampler.data0 &&
+        a->setMaterial.color.x == b->setMaterial.color.x && a->setMaterial.color.y == b->setMaterial.color.y &&
+        a->setMaterial.color.z == b->setMaterial.color.z && a->setMaterial.color.w == b->setMaterial.color.w &&
+        a->setMaterial.sdfParams.x == b->setMaterial.sdfParams.x && a->setMaterial.sdfParams.y == b->setMaterial.sdfParams.y &&
+        a->setMaterial.sdfParams.z == b->setMaterial.sdfParams.z && a->setMaterial.sdfParams.w == b->setMaterial.sdfParams.w;
 }
 
-f32 _gfxColorFromLinear(f32 a)
+static void rcmdPushMaterialInternal(RenderCommandBuffer* commandBuffer, RenderCommandEntry* material)
 {
-    bool cutoff = a < 0.0031308f;
-    f32 higher = 1.055f * fPow(a, (f32)(1.0f / 2.4)) - 0.055f;
-    f32 lower = a * 12.92f;
-    return fLerp(higher, cutoff, lower);
+    if (commandBuffer->mergeCommands && commandBuffer->activeMaterialIndex < commandBuffer->renderCommandsCount)
+    {
+        RenderCommandEntry* active = commandBuffer->commands + commandBuffer->activeMaterialIndex;
+        if (rcmdMaterialsEqualInternal(active, material))
+        {
+            return;
+        }
+    }
+
+    u32 materialIndex = commandBuffer->renderCommandsCount;
+    if (rcmdPushCommandCopyInternal(commandBuffer, material))
+    {
+        commandBuffer->activeMaterialIndex = materialIndex;
+    }
 }
 
-Vector4 gfxColorToLinear(Vector4 color)
+void rcmdSetQuadMaterial(RenderCommandBuffer* commandBuffer, TextureDescriptor textureId, SamplerDescriptor sampler, Vector4 color)
 {
-    // TODO: SIMDize
-    Vector4 result;
-    result.x = _gfxColorToLinear(color.x);
-    result.y = _gfxColorToLinear(color.y);
-    result.z = _gfxColorToLinear(color.z);
-    result.w = color.w;
+    RenderCommandEntry command = {0};
+    command.command = RenderCommand_SetMaterial;
+    command.setMaterial.type = RenderMaterialType_Texture;
+    command.setMaterial.textureId = textureId;
+    command.setMaterial.sampler = sampler;
+    command.setMaterial.color = color;
+    rcmdPushMaterialInternal(commandBuffer, &command);
+}
 
-    return result;
+void rcmdSetTextSdfMaterial(RenderCommandBuffer* commandBuffer, TextureDescriptor textureId, SamplerDescriptor sampler, Vector4 sdfParams, Vector4 color)
+{
+    RenderCommandEntry command = {0};
+    command.command = RenderCommand_SetMaterial;
+    command.setMaterial.type = RenderMaterialType_TextSDF;
+    command.setMaterial.textureId = textureId;
+    command.setMaterial.sampler = sampler;
+    command.setMaterial.sdfParams = sdfParams;
+    command.setMaterial.color = color;
+    rcmdPushMaterialInternal(commandBuffer, &command);
 }
 
-Vector4 gfxColorFromLinear(Vector4 color)
+// NOTE: Appends commands recorded into another buffer, for example by a worker thread. Materials and
+// draws go through the same deduplication and merging as if they were recorded here directly.
+// The source buffer must stay alive until the commands are executed, draws reference its geometry.
+void rcmdAppendCommandBuffer(RenderCommandBuffer* commandBuffer, RenderCommandBuffer* source)
 {
-    // TODO: SIMDize
-    Vector4 result;
-    result.x = _gfxColorFromLinear(color.x);
-    result.y = _gfxColorFromLinear(color.y);
-    result.z = _gfxColorFromLinear(color.z);
-    result.w = color.w;
+    for (u32 i = 0; i < source->renderCommandsCount; i++)
+    {
+        RenderCommandEntry* entry = source->commands + i;
+        switch (entry->command)
+        {
+        case RenderCommand_SetMaterial: { rcmdPushMaterialInternal(commandBuffer, entry); } break;
+        case RenderCommand_DrawMeshImmediate:
+        case RenderCommand_DrawLineSegments: { rcmdPushDrawInternal(commandBuffer, entry); } break;
+        default: { rcmdPushCommandCopyInternal(commandBuffer, entry); } break;
+        }
+    }
+}
 
-    return result;
+// FNV-1a, chain calls to hash several fields. Start with gfxHashGeometryKey(0, ...).
+u64 gfxHashGeometryKey(u64 hash, const void* data, uptr size)
+{
+    hash = hash == 0 ? 0xcbf29ce484222325ull : hash;
+    const byte* bytes = (const byte*)data;
+    for (uptr i = 0; i < size; i++)
+    {
+        hash = (hash ^ bytes[i]) * 0x100000001b3ull;
+    }
+
+    return hash;
 }
 
-void gfxStartGeometryBatch(GeometryBuffer* buffer)
+void gfxInitRetainedGeometryCache(RetainedGeometryCache* cache, MemoryStack* dataStack)
 {
-    buffer->vertexOffset = buffer->vertexCount;
-    buffer->indexOffset = buffer->indexCount;
+    mmSet(cache, 0, sizeof(RetainedGeometryCache));
+    cache->dataStack = dataStack;
+    cache->dataScope = mmBeginStackScope(dataStack);
+    cache->entryPool = mmCreatePool(dataStack, sizeof(RetainedGeometry), 16, 64, dataStack->failStrategy, "Retained Entries");
+}
+
+void gfxResetRetainedGeometryCache(RetainedGeometryCache* cache)
+{
+    mmPoolReset(&cache->entryPool);
+    mmEndStackScope(cache->dataScope);
+    mmSet(cache->buckets, 0, sizeof(cache->buckets));
+    cache->entriesCount = 0;
+    cache->liveBytes = 0;
+    cache->staleBytes = 0;
 }
 
-void gfxEmitPathGeometry(GeometryBuffer* buffer, Vector2* points, u32 pointsCount, f32 thickness, u32 color)
+static RetainedGeometry* gfxFindRetainedGeometryInternal(RetainedGeometryCache* cache, u64 key)
 {
-    for (u32 i1 = 0; i1 < pointsCount - 1; i1++)
+    RetainedGeometry* retained = cache->buckets[key % RetainedGeometryBucketsCount];
+    while (retained != NULL && retained->key != key)
     {
-        u32 i2 = (i1 + 1);
-        Vector2 p1 = points[i1];
-        Vector2 p2 = points[i2];
+        retained = retained->next;
+    }
 
-        Vector2 d = MakeVector2(p2.x - p1.x, p2.y - p1.y);
-        d = v2Normalize(d);
-        f32 dx = d.x * (thickness * 0.5f);
-        f32 dy = d.y * (thickness * 0.5f);
-
-        u32 vIndex = buffer->vertexCount;
-        buffer->vertexBuffer[vIndex + 0].position = MakeVector3(p1.x + dy, p1.y - dx, 0.5f);
-        buffer->vertexBuffer[vIndex + 0].uv = MakeVector2(0.0f, 0.0f);
-        buffer->vertexBuffer[vIndex + 0].vertexColor = color;
-
-        buffer->vertexBuffer[vIndex + 1].position = MakeVector3(p2.x + dy, p2.y - dx, 0.5f);
-        buffer->vertexBuffer[vIndex + 1].uv = MakeVector2(0.0f, 0.0f);
-        buffer->vertexBuffer[vIndex + 1].vertexColor = color;
-
-        buffer->vertexBuffer[vIndex + 2].position = MakeVector3(p2.x - dy, p2.y + dx, 0.5f);
-        buffer->vertexBuffer[vIndex + 2].uv = MakeVector2(0.0f, 0.0f);
-        buffer->vertexBuffer[vIndex + 2].vertexColor = color;
-
-        buffer->vertexBuffer[vIndex + 3].position = MakeVector3(p1.x - dy, p1.y + dx, 0.5f);
-        buffer->vertexBuffer[vIndex + 3].uv = MakeVector2(0.0f, 0.0f);
-        buffer->vertexBuffer[vIndex + 3].vertexColor = color;
-        buffer->vertexCount += 4;
-
-        vIndex -= buffer->vertexOffset;
-        u32 iIndex = buffer->indexCount;
-        buffer->indexBuffer[iIndex + 0] = vIndex + 0;
-        buffer->indexBuffer[iIndex + 1] = vIndex + 1;
-        buffer->indexBuffer[iIndex + 2] = vIndex + 2;
-        buffer->indexBuffer[iIndex + 3] = vIndex + 0;
-        buffer->indexBuffer[iIndex + 4] = vIndex + 2;
-        buffer->indexBuffer[iIndex + 5] = vIndex + 3;
-        buffer->indexCount += 6;
-    }
-}
-
-void gfxEmitQuadGeometry(GeometryBuffer* buffer, Vector2 min, Vector2 max, Vector2 uv0, Vector2 uv1, u32 vertexColor)
-{
-    u32 vIndex = buffer->vertexCount;
-    buffer->vertexBuffer[vIndex + 0].position = MakeVector3(min.x, min.y, 0.5f);
-    buffer->vertexBuffer[vIndex + 0].uv = MakeVector2(uv0.x, uv0.y);
-    buffer->vertexBuffer[vIndex + 0].vertexColor = vertexColor;
-    buffer->vertexBuffer[vIndex + 1].position = MakeVector3(max.x, min.y, 0.5f);
-    buffer->vertexBuffer[vIndex + 1].uv = MakeVector2(uv1.x, uv0.y);
-    buffer->vertexBuffer[vIndex + 1].vertexColor = vertexColor;
-    buffer->vertexBuffer[vIndex + 2].position = MakeVector3(max.x, max.y, 0.5f);
-    buffer->vertexBuffer[vIndex + 2].uv = MakeVector2(uv1.x, uv1.y);
-    buffer->vertexBuffer[vIndex + 2].vertexColor = vertexColor;
-    buffer->vertexBuffer[vIndex + 3].position = MakeVector3(min.x, max.y, 0.5f);
-    buffer->vertexBuffer[vIndex + 3].uv = MakeVector2(uv0.x, uv1.y);
-    buffer->vertexBuffer[vIndex + 3].vertexColor = vertexColor;
-    buffer->vertexCount += 4;
-
-    vIndex -= buffer->vertexOffset;
-    u32 iIndex = buffer->indexCount;
-    buffer->indexBuffer[iIndex + 0] = vIndex + 0;
-    buffer->indexBuffer[iIndex + 1] = vIndex + 1;
-    buffer->indexBuffer[iIndex + 2] = vIndex + 2;
-    buffer->indexBuffer[iIndex + 3] = vIndex + 2;
-    buffer->indexBuffer[iIndex + 4] = vIndex + 3;
-    buffer->indexBuffer[iIndex + 5] = vIndex + 0;
-    buffer->indexCount += 6;
+    return retained;
 }
 
-void gfxEmitTextBoxGeometry(GeometryBuffer* buffer, Rectangle2D rect, TextDrawBatch* batches, u32 count, TextDrawParams params)
+RetainedGeometry* gfxFindRetainedGeometry(RetainedGeometryCache* cache, u64 key)
 {
-    u32 fitLinesCount = 0;
-    Rectangle2D boundingBox = gfxCalcTextBoundingBox(rect, batches, count, params, &fitLinesCount);
-    Vector2 drawPosition = MakeVector2(rect.min.x, boundingBox.max.y);
-    f32 maxWidth = rect.max.x - rect.min.x;
+    RetainedGeometry* retained = gfxFindRetainedGeometryInternal(cache, key);
+    if (retained != NULL)
+    {
+        retained->lastUsedFrame = cache->frameIndex;
+        cache->frameHitsCount++;
+    }
+    else
+    {
+        cache->frameMissesCount++;
+    }
 
-    DrawTextState state = {0};
-    state.maxWidth = maxWidth;
-    state.batches = batches;
-    state.batchesCount = count;
-    gfxSetupLineCacheInternal(&state);
+    return retained;
+}
 
-    for (u32 i = 0; i < fitLinesCount; i++)
+static void* gfxRetainBytesInternal(RetainedGeometryCache* cache, RetainedGeometry* retained, void* data, uptr size)
+{
+    void* copy = mmStackPushAligned(cache->dataStack, size, 16);
+    if (copy != NULL)
     {
-        gfxPrepareNextTextLineInternal(&state, true);
+        mmCopy(copy, data, size);
+        retained->dataSize += size;
+    }
 
-        if (state.charsCount == 0)
+    return copy;
+}
+
+// NOTE: Copies the commands of source and every vertex, index and segment its draws reference. Transforms are
+// kept as pointers and have to outlive the entry. Returns NULL when the data stack is full, the caller can still
+// submit source itself.
+RetainedGeometry* gfxRetainGeometry(RetainedGeometryCache* cache, u64 key, RenderCommandBuffer* source)
+{
+    Assert(gfxFindRetainedGeometryInternal(cache, key) == NULL);
+
+    RetainedGeometry* retained = (RetainedGeometry*)mmPoolAlloc(&cache->entryPool);
+    if (retained == NULL)
+    {
+        return NULL;
+    }
+
+    // NOTE: Taken after the entry, the pool may have pushed a slab for it which has to survive a failed copy.
+    MemoryStackScope scope = mmBeginStackScope(cache->dataStack);
+
+    mmSet(retained, 0, sizeof(RetainedGeometry));
+    retained->key = key;
+    retained->lastUsedFrame = cache->frameIndex;
+    retained->commandBuffer.commands = (RenderCommandEntry*)gfxRetainBytesInternal(cache, retained, source->commands, sizeof(RenderCommandEntry) * source->renderCommandsCount);
+    retained->commandBuffer.renderCommandsCount = source->renderCommandsCount;
+    retained->commandBuffer.activeMaterialIndex = u32_Max;
+    bool retainedAll = source->renderCommandsCount == 0 || retained->commandBuffer.commands != NULL;
+
+    for (u32 i = 0; retainedAll && i < source->renderCommandsCount; i++)
+    {
+        RenderCommandEntry* entry = retained->commandBuffer.commands + i;
+        if (entry->command == RenderCommand_DrawMeshImmediate)
         {
-            // TODO invalid code path?
-            break;
+            uptr vertexBytes = (uptr)entry->drawMeshImmediate.vertexCount * GetVertexFormatStride(entry->drawMeshImmediate.vertexFormat);
+            uptr indexBytes = (uptr)entry->drawMeshImmediate.indexCount * GetIndexFormatSize(entry->drawMeshImmediate.indexFormat);
+            entry->drawMeshImmediate.vertices = gfxRetainBytesInternal(cache, retained, entry->drawMeshImmediate.vertices, vertexBytes);
+            entry->drawMeshImmediate.indices = gfxRetainBytesInternal(cache, retained, entry->drawMeshImmediate.indices, indexBytes);
+            retainedAll = entry->drawMeshImmediate.vertices != NULL && entry->drawMeshImmediate.indices != NULL;
+            retained->vertexCount += entry->drawMeshImmediate.vertexCount;
         }
+        else if (entry->command == RenderCommand_DrawLineSegments)
+        {
+            uptr segmentBytes = (uptr)entry->drawLineSegments.segmentCount * sizeof(RenderLineSegment);
+            entry->drawLineSegments.segments = (RenderLineSegment*)gfxRetainBytesInternal(cache, retained, entry->drawLineSegments.segments, segmentBytes);
+            retainedAll = entry->drawLineSegments.segments != NULL;
+            retained->segmentCount += entry->drawLineSegments.segmentCount;
+        }
+    }
 
-        drawPosition.x += fAbs(maxWidth - state.width) * params.horzAlignment;
-        drawPosition.y -= state.ascent;
+    if (!retainedAll)
+    {
+        mmPoolFree(&cache->entryPool, retained);
+        mmEndStackScope(scope);
+        return NULL;
+    }
+
+    u32 bucket = key % RetainedGeometryBucketsCount;
+    retained->next = cache->buckets[bucket];
+    cache->buckets[bucket] = retained;
+    cache->entriesCount++;
+    cache->liveBytes += retained->dataSize;
+    return retained;
+}
 
-        for (u32 i = 0; i < state.charsCount; i++)
+// NOTE: Call after the frame was submitted, entries it did not look up are dropped.
+void gfxEndRetainedGeometryFrame(RetainedGeometryCache* cache)
+{
+    for (u32 i = 0; i < RetainedGeometryBucketsCount; i++)
+    {
+        RetainedGeometry** link = cache->buckets + i;
+        while (*link != NULL)
         {
-            LineCacheEntry e = state.lineCache[i];
-            FontGlyphInfo* g = e.glyph;
-            f32 scale = e.scale;
-            u32 color = e.color;
-            Vector2 min = v2Add(drawPosition, v2Scale(g->min, scale));
-            Vector2 max = v2Add(drawPosition, v2Scale(g->max, scale));
-            gfxEmitQuadGeometry(buffer, min, max, g->uv0, g->uv1, color);
-            drawPosition.x += g->advance * scale;
+            RetainedGeometry* retained = *link;
+            if (retained->lastUsedFrame != cache->frameIndex)
+            {
+                *link = retained->next;
+                cache->entriesCount--;
+                cache->liveBytes -= retained->dataSize;
+                cache->staleBytes += retained->dataSize;
+                mmPoolFree(&cache->entryPool, retained);
+            }
+            else
+            {
+                link = &retained->next;
+            }
         }
+    }
 
-        drawPosition.x = rect.min.x;
-        drawPosition.y += state.descent + state.lineGap;
+    // NOTE: Data of dropped entries can only be reclaimed by rewinding everything.
+    if (cache->staleBytes > cache->liveBytes)
+    {
+        gfxResetRetainedGeometryCache(cache);
     }
+
+    cache->frameIndex++;
+    cache->frameHitsCount = 0;
+    cache->frameMissesCount = 0;
 }
 
-RenderCommandEntry* rcmdPushCommand(RenderCommandBuffer* commandBuffer)
+// NOTE: Materials are deduplicated like in rcmdAppendCommandBuffer, draws are always pushed as they are.
+void rcmdAppendRetainedGeometry(RenderCommandBuffer* commandBuffer, RetainedGeometry* retained)
 {
-    return commandBuffer->commands + commandBuffer->renderCommandsCount++;
+    RenderCommandBuffer* source = &retained->commandBuffer;
+    for (u32 i = 0; i < source->renderCommandsCount; i++)
+    {
+        RenderCommandEntry* entry = source->commands + i;
+        if (entry->command == RenderCommand_SetMaterial)
+        {
+            rcmdPushMaterialInternal(commandBuffer, entry);
+        }
+        else
+        {
+            rcmdPushCommandCopyInternal(commandBuffer, entry);
+        }
+    }
 }
 
-void rcmdPushGeometryBatch(RenderCommandBuffer* commandBuffer, GeometryBuffer* buffer, Matrix4x4* transform)
+typedef struct
 {
-    RenderCommandEntry* command = rcmdPushCommand(commandBuffer);
-    command->command = RenderCommand_DrawMeshImmediate;
+    u64 key;
+    u32 commandIndex;
+    u32 materialIndex;
+} RenderSortItem;
+
+// LSD radix sort by 8 bit digits. It is stable, so draws with equal keys keep their recording order.
+// Returns whichever of the two arrays holds the result.
+static RenderSortItem* rcmdRadixSortInternal(RenderSortItem* items, RenderSortItem* temp, u32 count)
+{
+    u32 histograms[8][256] = {0};
+    for (u32 i = 0; i < count; i++)
+    {
+        u64 key = items[i].key;
+        for (u32 pass = 0; pass < 8; pass++)
+        {
+            histograms[pass][(key >> (pass * 8)) & 0xff]++;
+        }
+    }
 
-    command->drawMeshImmediate.vertexCount = buffer->vertexCount - buffer->vertexOffset;
-    command->drawMeshImmediate.indexCount = buffer->indexCount - buffer->indexOffset;
-    command->drawMeshImmediate.vertices = buffer->vertexBuffer + buffer->vertexOffset;
-    command->drawMeshImmediate.indices = buffer->indexBuffer + buffer->indexOffset;
-    // TODO: Store it
-    command->drawMeshImmediate.transform = transform;
+    for (u32 pass = 0; pass < 8; pass++)
+    {
+        u32 shift = pass * 8;
+        u32* histogram = histograms[pass];
+
+        // Every key has the same digit, this pass would not move anything.
+        if (count == 0 || histogram[(items[0].key >> shift) & 0xff] == count)
+        {
+            continue;
+        }
+
+        u32 offset = 0;
+        for (u32 digit = 0; digit < 256; digit++)
+        {
+            u32 digitCount = histogram[digit];
+            histogram[digit] = offset;
+            offset += digitCount;
+        }
+
+        for (u32 i = 0; i < count; i++)
+        {
+            temp[histogram[(items[i].key >> shift) & 0xff]++] = items[i];
+        }
+
+        RenderSortItem* swap = items;
+        items = temp;
+        temp = swap;
+    }
+
+    return items;
 }
 
-void rcmdSetQuadMaterial(RenderCommandBuffer* commandBuffer, TextureDescriptor textureId, SamplerDescriptor sampler, Vector4 color)
+static void rcmdEmitSortedDrawsInternal(RenderCommandBuffer* commandBuffer, RenderCommandEntry* source, RenderSortItem* items, RenderSortItem* temp, u32 count, RenderCommandEntry** emittedMaterial)
 {
-    RenderCommandEntry* command = rcmdPushCommand(commandBuffer);
-    command->command = RenderCommand_SetMaterial;
-    command->setMaterial.type = RenderMaterialType_Texture;
-    command->setMaterial.textureId = textureId;
-    command->setMaterial.sampler = sampler;
-    command->setMaterial.color = color;
+    RenderSortItem* sorted = rcmdRadixSortInternal(items, temp, count);
+    for (u32 i = 0; i < count; i++)
+    {
+        if (sorted[i].materialIndex != u32_Max)
+        {
+            RenderCommandEntry* material = source + sorted[i].materialIndex;
+            if (*emittedMaterial == NULL || !rcmdMaterialsEqualInternal(*emittedMaterial, material))
+            {
+                // NOTE: A draw whose material did not make it in would be drawn with the previous one.
+                u32 materialIndex = commandBuffer->renderCommandsCount;
+                if (!rcmdPushCommandCopyInternal(commandBuffer, material))
+                {
+                    continue;
+                }
+
+                commandBuffer->activeMaterialIndex = materialIndex;
+                *emittedMaterial = material;
+            }
+        }
+
+        rcmdPushCommandCopyInternal(commandBuffer, source + sorted[i].commandIndex);
+    }
+}
+
+// NOTE: Reorders draws by their sort keys so that draws sharing pipeline state end up next to each
+// other, then emits a SetMaterial only where the material actually changes. Every draw takes the
+// material which was active when it was recorded. Other commands (clears) act as barriers, draws are
+// never moved across them.
+void rcmdSortCommandBuffer(RenderCommandBuffer* commandBuffer, MemoryStack* scratch)
+{
+    u32 count = commandBuffer->renderCommandsCount;
+    MemoryStackScope scratchScope = mmBeginStackScope(scratch);
+
+    RenderCommandEntry* source = (RenderCommandEntry*)mmStackPush(scratch, sizeof(RenderCommandEntry) * count);
+    RenderSortItem* items = (RenderSortItem*)mmStackPush(scratch, sizeof(RenderSortItem) * count);
+    RenderSortItem* temp = (RenderSortItem*)mmStackPush(scratch, sizeof(RenderSortItem) * count);
+    mmCopy(source, commandBuffer->commands, sizeof(RenderCommandEntry) * count);
+
+    commandBuffer->renderCommandsCount = 0;
+    commandBuffer->activeMaterialIndex = u32_Max;
+
+    RenderCommandEntry* emittedMaterial = NULL;
+    u32 activeMaterial = u32_Max;
+    u32 itemsCount = 0;
+    for (u32 i = 0; i < count; i++)
+    {
+        RenderCommandEntry* entry = source + i;
+        switch (entry->command)
+        {
+        case RenderCommand_SetMaterial:
+        {
+            activeMaterial = i;
+        } break;
+        case RenderCommand_DrawMeshImmediate:
+        case RenderCommand_DrawLineSegments:
+        {
+            RenderSortItem* item = items + itemsCount++;
+            item->key = entry->sortKey;
+            item->commandIndex = i;
+            item->materialIndex = activeMaterial;
+        } break;
+        default:
+        {
+            rcmdEmitSortedDrawsInternal(commandBuffer, source, items, temp, itemsCount, &emittedMaterial);
+            itemsCount = 0;
+            rcmdPushCommandCopyInternal(commandBuffer, entry);
+        } break;
+        }
+    }
+
+    rcmdEmitSortedDrawsInternal(commandBuffer, source, items, temp, itemsCount, &emittedMaterial);
+
+    mmEndStackScope(scratchScope);
 }
 
 void rcmdClear(RenderCommandBuffer* commandBuffer, RenderClearFlags flags, Vector4 color, f32 depth)
 {
     RenderCommandEntry* clearCommand = rcmdPushCommand(commandBuffer);
+    if (clearCommand == NULL)
+    {
+        return;
+    }
+
     clearCommand->command = RenderCommand_Clear;
     clearCommand->clear.color = color;
     clearCommand->clear.depth = depth;
     clearCommand->clear.flags = flags;
 }
 
-Rectangle2D gfxCalcTextBoundingBox(Rectangle2D rect, TextDrawBatch* batches, u32 count, TextDrawParams params, u32* outLinesCount)
+#define TextBoxInitialLinesCount (64)
+#define TextBoxInitialGlyphsCount (1024)
+
+// NOTE: Pushes a copy of items with room for at least minCapacity, doubling the old capacity but never going
+// past maxCapacity. The old copy stays on the stack until the caller's scope ends. Returns NULL when the stack is full.
+static void* gfxGrowScratchArrayInternal(MemoryStack* scratch, void* items, u32 itemsCount, uptr itemSize, u32* capacity, u32 minCapacity, u32 maxCapacity)
 {
-    Assert(count > 0);
-    Assert(batches != NULL);
+    u32 newCapacity = *capacity > 0 ? *capacity : 1;
+    while (newCapacity < minCapacity)
+    {
+        newCapacity *= 2;
+    }
 
-    if (batches[0].dataCount == 0)
+    newCapacity = newCapacity < maxCapacity ? newCapacity : maxCapacity;
+    void* result = mmStackPush(scratch, itemSize * newCapacity);
+    if (result != NULL)
     {
-        Rectangle2D result = {0};
+        mmCopy(result, items, itemSize * itemsCount);
+        *capacity = newCapacity;
     }
 
+    return result;
+}
+
+// NOTE: Measures every line once. When recordLines is set the line table and the line cache keep each
+// line and its glyphs, so the text can be emitted without breaking it again. Both are pushed from scratch
+// and grow as needed, a line whose glyphs did not fit is measured again. Vertical alignment is only
+// known after the last line, emitters apply it as an offset.
+static void gfxBreakTextBoxLinesInternal(MemoryStack* scratch, Rectangle2D rect, TextDrawBatch* batches, u32 count, TextDrawParams params, bool recordLines, TextBoxLinesInternal* result)
+{
+    Assert(count > 0);
+    Assert(batches != NULL);
+
     // TODO: Handle case when there is no text
     Vector2 drawPosition = MakeVector2(rect.min.x, rect.max.y);
     f32 maxWidth = rect.max.x - rect.min.x;
@@ -274,12 +1622,39 @@ Rectangle2D gfxCalcTextBoundingBox(Rectangle2D rect, TextDrawBatch* batches, u32
 
     DrawTextState state = {0};
     state.maxWidth = maxWidth;
+    state.kerning = params.kerning;
     state.batches = batches;
     state.batchesCount = count;
 
+    // Every recorded line has at least one glyph and every glyph takes at least one byte.
+    u32 maxGlyphsCount = 0;
+    for (u32 i = 0; i < count; i++)
+    {
+        maxGlyphsCount += batches[i].dataCount;
+    }
+
+    TextLineInfo* lines = NULL;
+    u32 linesCapacity = 0;
+    LineCacheEntry* glyphs = NULL;
+    u32 glyphsCapacity = 0;
+    u32 glyphsCount = 0;
+    if (recordLines)
+    {
+        // NOTE: Sized for common text boxes up front, so the first line is not measured twice.
+        lines = (TextLineInfo*)gfxGrowScratchArrayInternal(scratch, NULL, 0, sizeof(TextLineInfo), &linesCapacity, TextBoxInitialLinesCount, maxGlyphsCount);
+        glyphs = (LineCacheEntry*)gfxGrowScratchArrayInternal(scratch, NULL, 0, sizeof(LineCacheEntry), &glyphsCapacity, TextBoxInitialGlyphsCount, maxGlyphsCount);
+    }
+
     while (true)
     {
-        gfxPrepareNextTextLineInternal(&state, false);
+        DrawTextState lineStart = state;
+        if (recordLines)
+        {
+            state.lineCache = glyphs + glyphsCount;
+            state.lineCacheSize = glyphsCapacity - glyphsCount;
+        }
+
+        gfxPrepareNextTextLineInternal(&state, recordLines);
 
         if (state.charsCount == 0)
         {
@@ -292,6 +1667,33 @@ Rectangle2D gfxCalcTextBoundingBox(Rectangle2D rect, TextDrawBatch* batches, u32
             break;
         }
 
+        if (recordLines && linesCount == linesCapacity)
+        {
+            TextLineInfo* newLines = (TextLineInfo*)gfxGrowScratchArrayInternal(scratch, lines, linesCount, sizeof(TextLineInfo), &linesCapacity, linesCount + 1, maxGlyphsCount);
+            if (newLines == NULL)
+            {
+                Log_Error("Text", "Out of scratch memory, text box is cut after %u lines\n", linesCount);
+                break;
+            }
+
+            lines = newLines;
+        }
+
+        if (recordLines && state.charsCount > state.lineCacheSize)
+        {
+            LineCacheEntry* newGlyphs = (LineCacheEntry*)gfxGrowScratchArrayInternal(scratch, glyphs, glyphsCount, sizeof(LineCacheEntry), &glyphsCapacity, glyphsCount + state.charsCount, maxGlyphsCount);
+            if (newGlyphs == NULL)
+            {
+                Log_Error("Text", "Out of scratch memory, text box is cut after %u lines\n", linesCount);
+                break;
+            }
+
+            // NOTE: Only part of the glyphs of this line were written, it is measured again with the grown cache.
+            glyphs = newGlyphs;
+            state = lineStart;
+            continue;
+        }
+
         drawPosition.y -= state.ascent;
 
         f32 x = rect.min.x + fAbs(maxWidth - state.width) * params.horzAlignment;
@@ -299,30 +1701,49 @@ Rectangle2D gfxCalcTextBoundingBox(Rectangle2D rect, TextDrawBatch* batches, u32
         xMax = fMax(xMax, x + state.width);
         yMin = drawPosition.y + state.descent;
 
+        if (recordLines)
+        {
+            TextLineInfo* line = lines + linesCount;
+            line->firstGlyph = glyphsCount;
+            line->glyphsCount = state.charsCount;
+            line->width = state.width;
+            line->ascent = state.ascent;
+            line->descent = state.descent;
+            line->lineGap = state.lineGap;
+            glyphsCount += state.charsCount;
+        }
+
         linesCount++;
         drawPosition.y += state.descent + state.lineGap;
     }
 
-    Rectangle2D result =
-    {
-        .min = MakeVector2(xMin, yMin),
-        .max = MakeVector2(xMax, rect.max.y)
-    };
+    result->boundingBox.min = MakeVector2(xMin, yMin);
+    result->boundingBox.max = MakeVector2(xMax, rect.max.y);
 
     // Apply vertical alignment.
-    f32 textHeight = result.max.y - result.min.y;
+    f32 textHeight = result->boundingBox.max.y - result->boundingBox.min.y;
     f32 rectHeight = rect.max.y - rect.min.y;
     f32 vertOffset = fMax(0.0f, rectHeight - textHeight) * params.vertAlignment;
 
-    result.max.y -= vertOffset;
-    result.min.y -= vertOffset;
+    result->boundingBox.max.y -= vertOffset;
+    result->boundingBox.min.y -= vertOffset;
+
+    result->linesCount = linesCount;
+    result->lines = recordLines ? lines : NULL;
+    result->glyphs = recordLines ? glyphs : NULL;
+}
+
+Rectangle2D gfxCalcTextBoundingBox(Rectangle2D rect, TextDrawBatch* batches, u32 count, TextDrawParams params, u32* outLinesCount)
+{
+    TextBoxLinesInternal lines;
+    gfxBreakTextBoxLinesInternal(NULL, rect, batches, count, params, false, &lines);
 
     if (outLinesCount != NULL)
     {
-        *outLinesCount = linesCount;
+        *outLinesCount = lines.linesCount;
     }
 
-    return result;
+    return lines.boundingBox;
 }
 
 void gfxRewindTextIteratorInternal(DrawTextState* state, TextDrawBatch* batch, u32 index)
@@ -330,9 +1751,13 @@ void gfxRewindTextIteratorInternal(DrawTextState* state, TextDrawBatch* batch, u
     state->batchIndex = (u32)(((uptr)batch - (uptr)state->batches) / sizeof(TextDrawBatch));
     Assert(state->batchIndex >=0 && state->batchIndex < state->batchesCount);
     state->charIndex = index;
+    state->asciiEnd = 0;
 }
 
-u32 gfxGetNextCharacterAndBatchInternal(DrawTextState* state, TextDrawBatch** batch)
+// NOTE: Decodes the next character and returns the byte offset it starts at, which can be passed to
+// gfxRewindTextIteratorInternal. ASCII runs are found 16 bytes at a time and their characters are
+// returned without decoding.
+u32 gfxGetNextCharacterAndBatchInternal(DrawTextState* state, TextDrawBatch** batch, char32* character)
 {
     if (state->batchIndex >= state->batchesCount)
     {
@@ -344,11 +1769,26 @@ u32 gfxGetNextCharacterAndBatchInternal(DrawTextState* state, TextDrawBatch** ba
     Assert(currentBatch->dataCount > 0);
     u32 index = state->charIndex;
 
-    state->charIndex++;
+    if (index >= state->asciiEnd)
+    {
+        state->asciiEnd = index + utf8AsciiPrefixLength(currentBatch->data + index, currentBatch->dataCount - index);
+    }
+
+    if (index < state->asciiEnd)
+    {
+        *character = (char32)currentBatch->data[index];
+        state->charIndex++;
+    }
+    else
+    {
+        state->charIndex += utf8DecodeCodepoint(currentBatch->data + index, currentBatch->dataCount - index, character);
+    }
+
     if (state->charIndex >= currentBatch->dataCount)
     {
         state->batchIndex++;
         state->charIndex = 0;
+        state->asciiEnd = 0;
     }
 
     *batch = currentBatch;
@@ -374,10 +1814,16 @@ void gfxPrepareNextTextLineInternal(DrawTextState* state, bool writeLineCache)
     f32 minDescent = f32_Infinity;
     f32 maxLineGap = 0.0f;
 
+    // NOTE: Kerning only applies between glyphs of one line drawn with the same font at the same height.
+    Font* previousFont = NULL;
+    f32 previousScale = 0.0f;
+    u32 previousGlyphIndex = 0;
+
     while (true)
     {
         TextDrawBatch* batch = NULL;
-        u32 index = gfxGetNextCharacterAndBatchInternal(state, &batch);
+        char32 c = 0;
+        u32 index = gfxGetNextCharacterAndBatchInternal(state, &batch, &c);
 
         if (batch == NULL)
         {
@@ -392,8 +1838,6 @@ void gfxPrepareNextTextLineInternal(DrawTextState* state, bool writeLineCache)
             break;
         }
 
-        char32 c = batch->data[index];
-
         if (utf32OneOf(c, SkipCharacters))
         {
             continue;
@@ -411,10 +1855,22 @@ void gfxPrepareNextTextLineInternal(DrawTextState* state, bool writeLineCache)
         Font* font = batch->font;
         f32 scale = batch->height * font->bakedHeightRcp;
 
-        FontGlyphInfo* g = font->glyphs + font->glyphsTable[c];
+        u32 glyphIndex = GetGlyphIndex(font, c);
+        FontGlyphInfo* g = font->glyphs + glyphIndex;
+
+        f32 kerning = 0.0f;
+        if (state->kerning && font == previousFont && scale == previousScale)
+        {
+            kerning = GetKerningAdvance(font, previousGlyphIndex, glyphIndex) * scale;
+        }
+
+        previousFont = font;
+        previousScale = scale;
+        previousGlyphIndex = glyphIndex;
+
         f32 scalableAdvance = g->boxMax.x - g->boxMin.x;
         f32 constantAdvance = g->advance * scale - scalableAdvance;
-        f32 newWidth = fitWidth + scalableAdvance + constantAdvance;
+        f32 newWidth = fitWidth + kerning + scalableAdvance + constantAdvance;
         maxAscent = fMax(maxAscent, font->ascent * scale);
         maxAscent = fMax(maxAscent, g->boxMax.y * scale);
         minDescent = fMin(minDescent, g->boxMin.y * scale);
@@ -443,12 +1899,13 @@ void gfxPrepareNextTextLineInternal(DrawTextState* state, bool writeLineCache)
 
         fitWidth = newWidth;
 
-        if (writeLineCache)
+        // NOTE: Glyphs past lineCacheSize are only measured, the caller grows the cache and measures the line again.
+        if (writeLineCache && fitCharCount < state->lineCacheSize)
         {
-            Assert(fitCharCount < state->lineCacheSize);
             state->lineCache[fitCharCount].glyph = g;
             state->lineCache[fitCharCount].color = batch->color;
             state->lineCache[fitCharCount].scale = scale;
+            state->lineCache[fitCharCount].kerning = kerning;
         }
 
         fitCharCount++;
@@ -488,16 +1945,9 @@ void gfxPrepareNextTextLineInternal(DrawTextState* state, bool writeLineCache)
         {
             // Eat trailing space.
             TextDrawBatch* unused;
-            gfxGetNextCharacterAndBatchInternal(state, &unused);
+            char32 space;
+            gfxGetNextCharacterAndBatchInternal(state, &unused, &space);
         }
     }
 }
 
-// TODO: Allocate it via core allocators?
-static LineCacheEntry _gfxLineCacheInternal[262144];
-
-void gfxSetupLineCacheInternal(DrawTextState* state)
-{
-    state->lineCache = _gfxLineCacheInternal;
-    state->lineCacheSize = ArrayCount(_gfxLineCacheInternal);
-}
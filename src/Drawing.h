@@ -1,23 +1,92 @@
 #pragma once
 
 #include "renderer/RendererAPI.h"
+#include "core/Memory.h"
 #include "Rect.h"
 
+// Indices are 16 bit, so one draw can address this many vertices.
+#define GeometryBatchMaxVertices (0x10000)
+
+typedef struct
+{
+    uptr vertexByteOffset;
+    u32 vertexCount;
+    u32 indexOffset;
+    u32 indexCount;
+} GeometryBatchRange;
+
+// NOTE: Every batch picks its own vertex format, so vertex storage is addressed in bytes.
+// The current range starts at vertexBuffer + vertexByteOffset, its vertices are
+// [vertexOffset, vertexCount) and indices are relative to vertexOffset. When a batch would
+// outgrow GeometryBatchMaxVertices the emitters close the range into rangeBuffer and continue
+// in a new one, rcmdPushGeometryBatch submits every range of the batch as its own draw.
 typedef struct
 {
     u32 vertexCount;
     u32 indexCount;
     u32 vertexOffset;
     u32 indexOffset;
-    RenderVertex* vertexBuffer;
-    u32* indexBuffer;
+    RenderVertexFormat vertexFormat;
+    uptr vertexByteOffset;
+    void* vertexBuffer;
+    u16* indexBuffer;
+    u32 rangeCount;
+    u32 rangeOffset;
+    GeometryBatchRange* rangeBuffer;
+    u32 segmentCount;
+    u32 segmentOffset;
+    RenderLineSegment* segmentBuffer;
+    struct _GeometryBufferPages* pages;
 } GeometryBuffer;
 
+// NOTE: Reserved storage of a growable GeometryBuffer, the buffer pointers point at the start of these ranges.
+// Every emitter commits pages for the most geometry it can write before it starts writing.
+typedef struct _GeometryBufferPages
+{
+    VirtualMemoryRange vertices;
+    VirtualMemoryRange indices;
+    VirtualMemoryRange ranges;
+    VirtualMemoryRange segments;
+} GeometryBufferPages;
+
+#define RetainedGeometryBucketsCount (256)
+
+// NOTE: Commands recorded once together with the geometry their draws point at. The copy is read only,
+// appending it never merges its draws with others because merging rewrites indices.
+typedef struct _RetainedGeometry
+{
+    u64 key;
+    u64 lastUsedFrame;
+    RenderCommandBuffer commandBuffer;
+    u32 vertexCount;
+    u32 segmentCount;
+    uptr dataSize;
+    struct _RetainedGeometry* next;
+} RetainedGeometry;
+
+// NOTE: Retained geometry keyed by a hash of whatever produced it, callers look the key up and record and retain
+// only on a miss. Everything lives in dataStack past the point the cache was created at. Entries which were not
+// looked up during a frame are dropped at its end, and once dropped entries outweigh live ones the whole cache is
+// rewound and live entries are recorded again next frame. Not thread safe.
+typedef struct
+{
+    MemoryStack* dataStack;
+    MemoryStackScope dataScope;
+    MemoryPool entryPool;
+    RetainedGeometry* buckets[RetainedGeometryBucketsCount];
+    u64 frameIndex;
+    u32 entriesCount;
+    uptr liveBytes;
+    uptr staleBytes;
+    u32 frameHitsCount;
+    u32 frameMissesCount;
+} RetainedGeometryCache;
 
 typedef struct
 {
     Font* font;
-    const char32* data;
+    // NOTE: UTF-8, dataCount is in bytes. The layout decodes it as it goes.
+    const char* data;
     u32 dataCount;
     f32 height;
     u32 color;
@@ -27,8 +96,64 @@ typedef struct
 {
     f32 horzAlignment;
     f32 vertAlignment;
+    // NOTE: Applies the font's kerning pairs between neighbouring glyphs of the same font and height.
+    b32 kerning;
 } TextDrawParams;
 
+#define TextLayoutBucketsCount (256)
+
+typedef struct
+{
+    Vector2 min;
+    Vector2 max;
+    Vector2 uv0;
+    Vector2 uv1;
+    u32 color;
+} TextLayoutQuad;
+
+// NOTE: Glyph quads of a laid out text box, in the coordinates of the rect it was laid out in.
+typedef struct _TextLayout
+{
+    u64 key;
+    u64 lastUsedFrame;
+    Rectangle2D boundingBox;
+    u32 linesCount;
+    u32 quadsCount;
+    TextLayoutQuad* quads;
+    uptr dataSize;
+    struct _TextLayout* next;
+} TextLayout;
+
+// NOTE: Text box layouts keyed by a hash of the text and everything else which shapes it, works like
+// RetainedGeometryCache. Quads copy glyph metrics, reset the cache when a font changes. Not thread safe.
+typedef struct
+{
+    MemoryStack* dataStack;
+    MemoryStackScope dataScope;
+    MemoryPool entryPool;
+    TextLayout* buckets[TextLayoutBucketsCount];
+    u64 frameIndex;
+    u32 entriesCount;
+    uptr liveBytes;
+    uptr staleBytes;
+    u32 frameHitsCount;
+    u32 frameMissesCount;
+} TextLayoutCache;
+
+typedef enum
+{
+    PathJoinType_Miter,
+    PathJoinType_Bevel,
+    PathJoinType_Round
+} PathJoinType;
+
+typedef struct
+{
+    PathJoinType joinType;
+    // Miters longer than miterLimit * thickness / 2 fall back to bevel.
+    f32 miterLimit;
+} PathDrawParams;
+
 #define DefaultColor_White MakeVector4(1.0f, 1.0f, 1.0f, 1.0f)
 #define DefaultColor32_White (0xffffffff)
 #define DefaultColor32_Black (0xff000000)
@@ -39,14 +164,44 @@ Vector4 gfxUnpackColor(u32 color);
 Vector4 gfxColorToLinear(Vector4 color);
 Vector4 gfxColorFromLinear(Vector4 color);
 
-void gfxStartGeometryBatch(GeometryBuffer* buffer);
-void gfxEmitPathGeometry(GeometryBuffer* buffer, Vector2* points, u32 pointsCount, f32 thickness, u32 color);
-void gfxEmitQuadGeometry(GeometryBuffer* buffer, Vector2 min, Vector2 max, Vector2 uv0, Vector2 uv1, u32 vertexColor);
+void gfxResetGeometryBuffer(GeometryBuffer* buffer);
+void gfxSetGeometryBufferPages(GeometryBuffer* buffer, GeometryBufferPages* pages);
+void gfxDecommitGeometryBuffer(GeometryBuffer* buffer);
+uptr gfxGetGeometryCommittedBytes(GeometryBuffer* buffer);
+void gfxStartGeometryBatch(GeometryBuffer* buffer, RenderVertexFormat vertexFormat);
+uptr gfxGetVertexBytesCount(GeometryBuffer* buffer);
+b32 gfxEmitPathGeometry(GeometryBuffer* buffer, Vector2* points, u32 pointsCount, f32 thickness, u32 color);
+b32 gfxEmitPathSegments(GeometryBuffer* buffer, Vector2* points, u32 pointsCount, f32 thickness, u32 color);
+b32 gfxEmitJoinedPathGeometry(GeometryBuffer* buffer, Vector2* points, u32 pointsCount, f32 thickness, u32 color, PathDrawParams params);
+b32 gfxEmitQuadGeometry(GeometryBuffer* buffer, Vector2 min, Vector2 max, Vector2 uv0, Vector2 uv1, u32 vertexColor);
 
+void rcmdResetCommandBuffer(RenderCommandBuffer* commandBuffer);
+void rcmdSetSortLayer(RenderCommandBuffer* commandBuffer, u32 layer);
+void rcmdSetSortDepth(RenderCommandBuffer* commandBuffer, f32 depth);
+void rcmdSortCommandBuffer(RenderCommandBuffer* commandBuffer, MemoryStack* scratch);
 RenderCommandEntry* rcmdPushCommand(RenderCommandBuffer* commandBuffer);
 void rcmdPushGeometryBatch(RenderCommandBuffer* commandBuffer, GeometryBuffer* buffer, Matrix4x4* transform);
+void rcmdPushLineSegmentsBatch(RenderCommandBuffer* commandBuffer, GeometryBuffer* buffer, Matrix4x4* transform);
 void rcmdSetQuadMaterial(RenderCommandBuffer* commandBuffer, TextureDescriptor textureId, SamplerDescriptor sampler, Vector4 color);
+void rcmdSetTextSdfMaterial(RenderCommandBuffer* commandBuffer, TextureDescriptor textureId, SamplerDescriptor sampler, Vector4 sdfParams, Vector4 color);
+void rcmdAppendCommandBuffer(RenderCommandBuffer* commandBuffer, RenderCommandBuffer* source);
 void rcmdClear(RenderCommandBuffer* commandBuffer, RenderClearFlags flags, Vector4 color, f32 depth);
 
+u64 gfxHashGeometryKey(u64 hash, const void* data, uptr size);
+void gfxInitRetainedGeometryCache(RetainedGeometryCache* cache, MemoryStack* dataStack);
+void gfxResetRetainedGeometryCache(RetainedGeometryCache* cache);
+RetainedGeometry* gfxFindRetainedGeometry(RetainedGeometryCache* cache, u64 key);
+RetainedGeometry* gfxRetainGeometry(RetainedGeometryCache* cache, u64 key, RenderCommandBuffer* source);
+void gfxEndRetainedGeometryFrame(RetainedGeometryCache* cache);
+void rcmdAppendRetainedGeometry(RenderCommandBuffer* commandBuffer, RetainedGeometry* retained);
+
 Rectangle2D gfxCalcTextBoundingBox(Rectangle2D rect, TextDrawBatch* batches, u32 count, TextDrawParams params, u32* outLinesCount);
-void gfxEmitTextBoxGeometry(GeometryBuffer* buffer, Rectangle2D rect, TextDrawBatch* batches, u32 count, TextDrawParams params);
+void gfxEmitTextBoxGeometry(GeometryBuffer* buffer, Rectangle2D rect, TextDrawBatch* batches, u32 count, TextDrawParams params, MemoryStack* scratch);
+
+u64 gfxHashTextLayoutKey(const char* utf8Text, Font* font, f32 height, u32 color, Rectangle2D rect, TextDrawParams params);
+void gfxInitTextLayoutCache(TextLayoutCache* cache, MemoryStack* dataStack);
+void gfxResetTextLayoutCache(TextLayoutCache* cache);
+TextLayout* gfxFindTextLayout(TextLayoutCache* cache, u64 key);
+TextLayout* gfxLayoutTextBox(TextLayoutCache* cache, u64 key, Rectangle2D rect, TextDrawBatch* batches, u32 count, TextDrawParams params, MemoryStack* scratch);
+void gfxEndTextLayoutFrame(TextLayoutCache* cache);
+void gfxEmitTextLayoutGeometry(GeometryBuffer* buffer, TextLayout* layout);
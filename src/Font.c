@@ -34,6 +34,7 @@ typedef struct
     int yoff;
     f32 advance;
     f32 leftBearing;
+    int glyphIndex;
     u32 xBitmap;
     u32 yBitmap;
 
@@ -43,15 +44,390 @@ typedef struct
     int x1;
     int y1;
 
-    char* bitmap;
+    b32 hasBitmap;
 } GlyphBitmapInfo;
 
-Font LoadFont(MemoryStack* tempStack, void* fileBytes, f32 height, CodepointRange* ranges, u32 rangeCount, const char* _fontName)
+// NOTE: Shared by the jobs baking one font. Every job copies the font info and points its allocations at the
+// scratch stack of the thread it runs on.
+typedef struct
+{
+    const stbtt_fontinfo* font;
+    CoreAPI* coreAPI;
+    MemoryStack* tempStack;
+    GlyphBitmapInfo* bitmaps;
+    u32 bitmapsCount;
+    f32 scale;
+
+    stbrp_rect* rects;
+    char* atlas;
+    u32 atlasDim;
+    int sdfPadding;
+    f32 onEdgeValue;
+    f32 pixelDistScale;
+} FontBakeJobData;
+
+// NOTE: Without a coreAPI everything runs on the calling thread.
+static void RunFontBakeJobs(FontBakeJobData* data, u32 count, CoreParallelForFn* fn)
+{
+    if (data->coreAPI != NULL)
+    {
+        data->coreAPI->ParallelFor(count, fn, data);
+        return;
+    }
+
+    for (u32 i = 0; i < count; i++)
+    {
+        fn(data, i, 0);
+    }
+}
+
+static MemoryStack* GetFontBakeScratch(FontBakeJobData* data)
+{
+    return data->coreAPI != NULL ? data->coreAPI->GetScratchStack(data->tempStack) : data->tempStack;
+}
+
+// NOTE: Same box stbtt_GetGlyphSDF computes, so the atlas can be packed before any SDF is generated.
+static void MeasureGlyphSdf(const stbtt_fontinfo* font, f32 scale, int padding, GlyphBitmapInfo* info)
+{
+    int ix0, iy0, ix1, iy1;
+    stbtt_GetGlyphBitmapBoxSubpixel(font, info->glyphIndex, scale, scale, 0.0f, 0.0f, &ix0, &iy0, &ix1, &iy1);
+    if (scale == 0.0f || ix0 == ix1 || iy0 == iy1)
+    {
+        return;
+    }
+
+    info->hasBitmap = true;
+    info->width = ix1 - ix0 + padding * 2;
+    info->height = iy1 - iy0 + padding * 2;
+    info->xoff = ix0 - padding;
+    info->yoff = iy0 - padding;
+}
+
+// NOTE: Glyph rects on the atlas do not overlap, so every glyph is generated and copied straight into
+// place. The SDF only lives on the scratch stack for the duration of the copy.
+static void BakeGlyphSdfJob(void* jobData, u32 index, u32 threadIndex)
+{
+    FontBakeJobData* data = (FontBakeJobData*)jobData;
+    GlyphBitmapInfo* info = data->bitmaps + index;
+    if (!info->hasBitmap)
+    {
+        return;
+    }
+
+    MemoryStack* scratch = GetFontBakeScratch(data);
+    MemoryStackScope scope = mmBeginStackScope(scratch);
+
+    stbtt_fontinfo font = *data->font;
+    font.userdata = scratch;
+
+    int width, height, xoff, yoff;
+    byte* sdf = stbtt_GetGlyphSDF(&font, data->scale, info->glyphIndex, data->sdfPadding, (unsigned char)data->onEdgeValue, data->pixelDistScale, &width, &height, &xoff, &yoff);
+    Assert(sdf != NULL && width == info->width && height == info->height);
+
+    // It looks like glyph coords are top->bottom but our coords are bottom->top
+    stbrp_rect* rect = data->rects + index;
+    for (u32 y = 0; y < (u32)rect->h; y++)
+    {
+        mmCopy(data->atlas + (rect->y + rect->h - y) * data->atlasDim + rect->x, sdf + y * rect->w, rect->w);
+    }
+
+    mmEndStackScope(scope);
+}
+
+// NOTE: Open addressing like GetKerningAdvance, the first advance inserted for a pair wins.
+static void InsertKerningPair(FontKerningPair* table, u32 tableSize, u32* pairsCount, u32 pair, f32 advance)
+{
+    u32 slot = HashKerningPair(pair) & (tableSize - 1);
+    while (table[slot].pair != 0)
+    {
+        if (table[slot].pair == pair)
+        {
+            return;
+        }
+
+        slot = (slot + 1) & (tableSize - 1);
+    }
+
+    table[slot].pair = pair;
+    table[slot].advance = advance;
+    (*pairsCount)++;
+}
+
+// NOTE: Pairs of font glyphs, collected on the scratch stack in the order stb_truetype would find them.
+// Loaded glyphs are chained per font glyph, several codepoints may share one.
+typedef struct
+{
+    MemoryStack* scratch;
+    FontKerningPair* table;
+    u32 tableSize;
+    u32 pairsCount;
+    u32* firstLoaded;
+    u32* nextLoaded;
+    f32 scale;
+} KerningPairsBuilder;
+
+static void AddKerningPair(KerningPairsBuilder* builder, u32 firstGlyph, u32 secondGlyph, i32 advance)
+{
+    for (u32 first = builder->firstLoaded[firstGlyph]; first != 0; first = builder->nextLoaded[first])
+    {
+        for (u32 second = builder->firstLoaded[secondGlyph]; second != 0; second = builder->nextLoaded[second])
+        {
+            if ((builder->pairsCount + 1) * 2 > builder->tableSize)
+            {
+                u32 tableSize = builder->tableSize * 2;
+                FontKerningPair* table = mmStackPush(builder->scratch, sizeof(FontKerningPair) * tableSize);
+                mmSet(table, 0, sizeof(FontKerningPair) * tableSize);
+
+                u32 pairsCount = 0;
+                for (u32 i = 0; i < builder->tableSize; i++)
+                {
+                    if (builder->table[i].pair != 0)
+                    {
+                        InsertKerningPair(table, tableSize, &pairsCount, builder->table[i].pair, builder->table[i].advance);
+                    }
+                }
+
+                builder->table = table;
+                builder->tableSize = tableSize;
+            }
+
+            InsertKerningPair(builder->table, builder->tableSize, &builder->pairsCount, (first << 16) | second, advance * builder->scale);
+        }
+    }
+}
+
+// NOTE: Mirrors stbtt__GetGlyphGPOSInfoAdvance. For every first glyph the subtables are searched in order, a format 1
+// subtable which does not list the second glyph passes it on and everything else ends the search. Zero advances are
+// kept until the end, so later subtables can not override them.
+static void CollectGposKerningPairs(KerningPairsBuilder* builder, const stbtt_fontinfo* font)
+{
+    stbtt_uint8* data = font->data + font->gpos;
+    if (ttUSHORT(data + 0) != 1 || ttUSHORT(data + 2) != 0)
+    {
+        return;
+    }
+
+    u32 glyphsCount = (u32)font->numGlyphs;
+    b8* searchEnded = mmStackPush(builder->scratch, sizeof(b8) * glyphsCount);
+    mmSet(searchEnded, 0, sizeof(b8) * glyphsCount);
+    u32* classGlyphs = mmStackPush(builder->scratch, sizeof(u32) * glyphsCount);
+
+    stbtt_uint8* lookupList = data + ttUSHORT(data + 8);
+    u32 lookupCount = ttUSHORT(lookupList);
+    for (u32 i = 0; i < lookupCount; i++)
+    {
+        stbtt_uint8* lookupTable = lookupList + ttUSHORT(lookupList + 2 + 2 * i);
+        if (ttUSHORT(lookupTable) != 2)
+        {
+            continue;
+        }
+
+        u32 subTableCount = ttUSHORT(lookupTable + 4);
+        for (u32 subTable = 0; subTable < subTableCount; subTable++)
+        {
+            stbtt_uint8* table = lookupTable + ttUSHORT(lookupTable + 6 + 2 * subTable);
+            u32 posFormat = ttUSHORT(table);
+            stbtt_uint8* coverage = table + ttUSHORT(table + 2);
+            b32 supported = (posFormat == 1 || posFormat == 2) && ttUSHORT(table + 4) == 4 && ttUSHORT(table + 6) == 0;
+
+            // Loaded second glyphs sorted by their class, classStarts has class2Count + 1 entries. Not rewound,
+            // the pair table may have grown above it.
+            u32 class2Count = 0;
+            u32* classStarts = NULL;
+            if (supported && posFormat == 2)
+            {
+                stbtt_uint8* classDef2 = table + ttUSHORT(table + 10);
+                class2Count = ttUSHORT(table + 14);
+                classStarts = mmStackPush(builder->scratch, sizeof(u32) * (class2Count + 2));
+                mmSet(classStarts, 0, sizeof(u32) * (class2Count + 2));
+                for (u32 glyph = 0; glyph < glyphsCount; glyph++)
+                {
+                    i32 glyphClass = builder->firstLoaded[glyph] != 0 ? stbtt__GetGlyphClass(classDef2, glyph) : -1;
+                    if (glyphClass >= 0 && (u32)glyphClass < class2Count)
+                    {
+                        classStarts[glyphClass + 2]++;
+                    }
+                }
+
+                for (u32 c = 2; c < class2Count + 2; c++)
+                {
+                    classStarts[c] += classStarts[c - 1];
+                }
+
+                for (u32 glyph = 0; glyph < glyphsCount; glyph++)
+                {
+                    i32 glyphClass = builder->firstLoaded[glyph] != 0 ? stbtt__GetGlyphClass(classDef2, glyph) : -1;
+                    if (glyphClass >= 0 && (u32)glyphClass < class2Count)
+                    {
+                        classGlyphs[classStarts[glyphClass + 1]++] = glyph;
+                    }
+                }
+            }
+
+            for (u32 first = 0; first < glyphsCount; first++)
+            {
+                if (builder->firstLoaded[first] == 0 || searchEnded[first])
+                {
+                    continue;
+                }
+
+                i32 coverageIndex = stbtt__GetCoverageIndex(coverage, first);
+                if (coverageIndex == -1)
+                {
+                    continue;
+                }
+
+                if (supported && posFormat == 1 && (u32)coverageIndex < ttUSHORT(table + 8))
+                {
+                    stbtt_uint8* pairValueTable = table + ttUSHORT(table + 10 + 2 * coverageIndex);
+                    u32 pairValueCount = ttUSHORT(pairValueTable);
+                    for (u32 k = 0; k < pairValueCount; k++)
+                    {
+                        stbtt_uint8* pairValue = pairValueTable + 2 + 4 * k;
+                        u32 second = ttUSHORT(pairValue);
+                        if (second < glyphsCount && builder->firstLoaded[second] != 0)
+                        {
+                            AddKerningPair(builder, first, second, ttSHORT(pairValue + 2));
+                        }
+                    }
+
+                    continue;
+                }
+
+                searchEnded[first] = true;
+                if (!supported || posFormat != 2)
+                {
+                    continue;
+                }
+
+                i32 class1 = stbtt__GetGlyphClass(table + ttUSHORT(table + 8), first);
+                if (class1 < 0 || (u32)class1 >= ttUSHORT(table + 12))
+                {
+                    continue;
+                }
+
+                stbtt_uint8* class2Records = table + 16 + 2 * (class1 * class2Count);
+                for (u32 c = 0; c < class2Count; c++)
+                {
+                    i32 advance = ttSHORT(class2Records + 2 * c);
+                    for (u32 k = classStarts[c]; advance != 0 && k < classStarts[c + 1]; k++)
+                    {
+                        AddKerningPair(builder, first, classGlyphs[k], advance);
+                    }
+                }
+            }
+        }
+    }
+}
+
+// NOTE: Only the first kern subtable, like stbtt__GetGlyphKernInfoAdvance.
+static void CollectKernKerningPairs(KerningPairsBuilder* builder, const stbtt_fontinfo* font)
+{
+    int entriesCount = stbtt_GetKerningTableLength(font);
+    stbtt_kerningentry* entries = mmStackPush(builder->scratch, sizeof(stbtt_kerningentry) * (entriesCount + 1));
+    entriesCount = stbtt_GetKerningTable(font, entries, entriesCount);
+    for (int i = 0; i < entriesCount; i++)
+    {
+        u32 first = (u32)entries[i].glyph1;
+        u32 second = (u32)entries[i].glyph2;
+        if (first < (u32)font->numGlyphs && second < (u32)font->numGlyphs)
+        {
+            AddKerningPair(builder, first, second, entries[i].advance);
+        }
+    }
+}
+
+// NOTE: Walks the pairs the font actually has, GPOS pair adjustments when the font has a GPOS table and the kern
+// table otherwise, the same choice stbtt_GetGlyphKernAdvance makes. Glyphs without an outline in the font,
+// the missing glyph included, are left out.
+static u32 BakeKerningPairs(FontBakeJobData* data, FontKerningPair** outTable, u32* outTableSize)
+{
+    const stbtt_fontinfo* font = data->font;
+    *outTable = NULL;
+    *outTableSize = 0;
+    if (font->numGlyphs <= 0 || (!font->gpos && !font->kern))
+    {
+        return 0;
+    }
+
+    // NOTE: Without a coreAPI the scratch stack is tempStack itself, the builder's storage then stays under the table.
+    KerningPairsBuilder builder = {0};
+    builder.scratch = GetFontBakeScratch(data);
+    MemoryStackScope scope = mmBeginStackScope(builder.scratch);
+    b32 ownScratch = builder.scratch != data->tempStack;
+    builder.scale = data->scale;
+    builder.tableSize = 256;
+    builder.table = mmStackPush(builder.scratch, sizeof(FontKerningPair) * builder.tableSize);
+    mmSet(builder.table, 0, sizeof(FontKerningPair) * builder.tableSize);
+
+    u32 glyphsCount = (u32)font->numGlyphs;
+    builder.firstLoaded = mmStackPush(builder.scratch, sizeof(u32) * glyphsCount);
+    mmSet(builder.firstLoaded, 0, sizeof(u32) * glyphsCount);
+    builder.nextLoaded = mmStackPush(builder.scratch, sizeof(u32) * data->bitmapsCount);
+    mmSet(builder.nextLoaded, 0, sizeof(u32) * data->bitmapsCount);
+    for (u32 i = data->bitmapsCount - 1; i > 0; i--)
+    {
+        u32 glyph = (u32)data->bitmaps[i].glyphIndex;
+        if (glyph != 0 && glyph < glyphsCount)
+        {
+            builder.nextLoaded[i] = builder.firstLoaded[glyph];
+            builder.firstLoaded[glyph] = i;
+        }
+    }
+
+    if (font->gpos)
+    {
+        CollectGposKerningPairs(&builder, font);
+    }
+    else
+    {
+        CollectKernKerningPairs(&builder, font);
+    }
+
+    u32 pairsCount = 0;
+    for (u32 i = 0; i < builder.tableSize; i++)
+    {
+        pairsCount += builder.table[i].pair != 0 && builder.table[i].advance != 0.0f ? 1 : 0;
+    }
+
+    if (pairsCount > 0)
+    {
+        u32 tableSize = 16;
+        while (tableSize < pairsCount * 2)
+        {
+            tableSize *= 2;
+        }
+
+        FontKerningPair* table = mmStackPush(data->tempStack, sizeof(FontKerningPair) * tableSize);
+        mmSet(table, 0, sizeof(FontKerningPair) * tableSize);
+        u32 insertedCount = 0;
+        for (u32 i = 0; i < builder.tableSize; i++)
+        {
+            if (builder.table[i].pair != 0 && builder.table[i].advance != 0.0f)
+            {
+                InsertKerningPair(table, tableSize, &insertedCount, builder.table[i].pair, builder.table[i].advance);
+            }
+        }
+
+        *outTable = table;
+        *outTableSize = tableSize;
+    }
+
+    if (ownScratch)
+    {
+        mmEndStackScope(scope);
+    }
+
+    return pairsCount;
+}
+
+Font LoadFont(CoreAPI* coreAPI, MemoryStack* tempStack, void* fileBytes, f32 height, CodepointRange* ranges, u32 rangeCount, const char* _fontName)
 {
     // [https://github.com/nothings/stb/blob/master/tests/sdf/sdf_test.c]
     const f32 OnEdgeValue = 128.0f;
     const f32 PixelDistScale = 64.0f;
     const f32 PixelDistScaleOffset = 30.0f;
+    const int SdfPadding = 5;
 
     const char* fontName = _fontName ? _fontName : "";
 
@@ -72,8 +448,6 @@ Font LoadFont(MemoryStack* tempStack, void* fileBytes, f32 height, CodepointRang
     f32 scale = stbtt_ScaleForPixelHeight(&font, height);
 
     u32 codepointsCount = CalcGlyphTableLength(ranges, rangeCount);
-    u32 kernTableLength = (u32)stbtt_GetKerningTableLength(&font);
-    Log_Info("FontLoader", "Font \"%s\" has %lu kerning table entries\n", fontName, kernTableLength);
 
     int fontBBoxMinX;
     int fontBBoxMinY;
@@ -81,20 +455,22 @@ Font LoadFont(MemoryStack* tempStack, void* fileBytes, f32 height, CodepointRang
     int fontBBoxMaxY;
     stbtt_GetFontBoundingBox(&font, &fontBBoxMinX, &fontBBoxMinY, &fontBBoxMaxX, &fontBBoxMaxY);
 
-    GlyphBitmapInfo* bitmaps = mmStackPush(tempStack, sizeof(GlyphBitmapInfo) * codepointsCount + 1); // 1 for "missing" glyph
+    f64 bakeBegin = coreAPI != NULL ? coreAPI->GetTimestamp() : 0.0;
+
+    GlyphBitmapInfo* bitmaps = mmStackPush(tempStack, sizeof(GlyphBitmapInfo) * (codepointsCount + 1)); // 1 for "missing" glyph
 
-    // Render glyphs bitmaps
+    // Measure glyphs, the bitmaps are generated once they have a place on the atlas.
 
     GlyphBitmapInfo* missingGlyphInfo = bitmaps + 0;
     mmSet(missingGlyphInfo, 0, sizeof(GlyphBitmapInfo));
     missingGlyphInfo->codepoint = 9633; // 'WHITE SQUARE' (U+25A1)
-    missingGlyphInfo->bitmap = stbtt_GetGlyphSDF(&font, scale, 0, 5, (unsigned char)OnEdgeValue, PixelDistScale, &(missingGlyphInfo->width), &(missingGlyphInfo->height), &(missingGlyphInfo->xoff), &(missingGlyphInfo->yoff));
+    MeasureGlyphSdf(&font, scale, SdfPadding, missingGlyphInfo);
     int missingGlyphAdvance;
     int missingGlyphLeftBearing;
     stbtt_GetGlyphHMetrics(&font, 0, &missingGlyphAdvance, &missingGlyphLeftBearing);
     missingGlyphInfo->advance = missingGlyphAdvance * scale;
     missingGlyphInfo->leftBearing = missingGlyphLeftBearing * scale;
-    if (missingGlyphInfo->bitmap == NULL)
+    if (!missingGlyphInfo->hasBitmap)
     {
         Log_Warn("FontLoader", "\"Missing Character\" glyph for font \"%s\" is missing\n", fontName);
     }
@@ -107,8 +483,10 @@ Font LoadFont(MemoryStack* tempStack, void* fileBytes, f32 height, CodepointRang
         {
             int glyphIndex = stbtt_FindGlyphIndex(&font, (int)codepoint);
             GlyphBitmapInfo* info = bitmaps + bitmapIndex;
+            mmSet(info, 0, sizeof(GlyphBitmapInfo));
             info->codepoint = codepoint;
-            info->bitmap = stbtt_GetGlyphSDF(&font, scale, glyphIndex, 5, (unsigned char)OnEdgeValue, PixelDistScale, &(info->width), &(info->height), &(info->xoff), &(info->yoff));
+            info->glyphIndex = glyphIndex;
+            MeasureGlyphSdf(&font, scale, SdfPadding, info);
 
             int advance, leftBearing;
             stbtt_GetGlyphHMetrics(&font, glyphIndex, &advance, &leftBearing);
@@ -165,54 +543,71 @@ Font LoadFont(MemoryStack* tempStack, void* fileBytes, f32 height, CodepointRang
 
     Log_Info("FontLoader", "Packed font \"%s\" to %lux%lu atlas\n", fontName, usedTextureSize, usedTextureSize);
 
-    // Copy glyphs bitmaps to atlas
+    // Bake glyphs bitmaps into the atlas
 
-    char* bitmap = mmStackPush(tempStack, usedTextureSize * usedTextureSize);
-    mmSet(bitmap, 0, usedTextureSize * usedTextureSize);
+    // NOTE: Glyph rows are written one row up from their rect, the extra row keeps a glyph packed against the
+    // top edge inside the allocation.
+    char* bitmap = mmStackPush(tempStack, usedTextureSize * (usedTextureSize + 1));
+    mmSet(bitmap, 0, usedTextureSize * (usedTextureSize + 1));
 
     for (u32 i = 0; i < btimapsCount; i++)
     {
-        stbrp_rect* rect = rects + i;
         GlyphBitmapInfo* info = bitmaps + i;
-
-        if (info->bitmap == NULL)
-        {
-            continue;
-        }
-
-        u32 numPixels = (u32)(rect->w * rect->h);
-        for (u32 j = 0; j < numPixels; j++)
+        if (info->hasBitmap)
         {
-            u32 y = j / rect->w;
-            // It looks like glyph coords are top->bottom but our coords are bottom->top
-            y = rect->h - y;
-            u32 x = j % rect->w;
-            u32 yBitmap = rect->y + y;
-            u32 xBitmap = rect->x + x;
-
-            info->xBitmap = xBitmap;
-            info->yBitmap = yBitmap;
-            bitmap[yBitmap * usedTextureSize + xBitmap] = info->bitmap[j];
+            info->xBitmap = rects[i].x + rects[i].w - 1;
+            info->yBitmap = rects[i].y + 1;
         }
-        stbtt_FreeSDF(info->bitmap, tempStack);
     }
 
+    FontBakeJobData bakeData = {0};
+    bakeData.font = &font;
+    bakeData.coreAPI = coreAPI;
+    bakeData.tempStack = tempStack;
+    bakeData.bitmaps = bitmaps;
+    bakeData.bitmapsCount = btimapsCount;
+    bakeData.scale = scale;
+    bakeData.rects = rects;
+    bakeData.atlas = bitmap;
+    bakeData.atlasDim = usedTextureSize;
+    bakeData.sdfPadding = SdfPadding;
+    bakeData.onEdgeValue = OnEdgeValue;
+    bakeData.pixelDistScale = PixelDistScale;
+    RunFontBakeJobs(&bakeData, btimapsCount, BakeGlyphSdfJob);
+
     // Prepare font data
 
     FontGlyphInfo* glyphsInfo = mmStackPush(tempStack, sizeof(FontGlyphInfo) * btimapsCount);
-    u16* glyphsTable = mmStackPush(tempStack, sizeof(u16) * FONT_GLYPHS_TABLE_SIZE);
-    mmSet(glyphsTable, 0, sizeof(u16) * FONT_GLYPHS_TABLE_SIZE);
     f32 uvScale = 1.0f / usedTextureSize;
 
+    // NOTE: Pages are numbered in the order their first codepoint shows up, page 0 stays empty.
+    u16* pageTable = mmStackPush(tempStack, sizeof(u16) * FONT_GLYPH_PAGE_TABLE_SIZE);
+    mmSet(pageTable, 0, sizeof(u16) * FONT_GLYPH_PAGE_TABLE_SIZE);
+    u32 glyphPagesCount = 1;
+    for (u32 i = 1; i < btimapsCount; i++)
+    {
+        u32 codepoint = bitmaps[i].codepoint;
+        if (codepoint <= FONT_MAX_CODEPOINT && pageTable[codepoint >> FONT_GLYPH_PAGE_BITS] == 0)
+        {
+            pageTable[codepoint >> FONT_GLYPH_PAGE_BITS] = (u16)glyphPagesCount++;
+        }
+    }
+
+    Assert(btimapsCount <= u16_Max && glyphPagesCount <= u16_Max);
+    u32 glyphsTableSize = FONT_GLYPH_PAGE_TABLE_SIZE + glyphPagesCount * FONT_GLYPH_PAGE_SIZE;
+    u16* glyphsTable = mmStackPush(tempStack, sizeof(u16) * glyphsTableSize);
+    mmCopy(glyphsTable, pageTable, sizeof(u16) * FONT_GLYPH_PAGE_TABLE_SIZE);
+    u16* glyphPages = glyphsTable + FONT_GLYPH_PAGE_TABLE_SIZE;
+    mmSet(glyphPages, 0, sizeof(u16) * glyphPagesCount * FONT_GLYPH_PAGE_SIZE);
+
     for (u32 i = 0; i < btimapsCount; i++)
     {
         GlyphBitmapInfo* tempInfo = bitmaps + i;
         FontGlyphInfo* info = glyphsInfo + i;
 
-        if (tempInfo->codepoint > u16_Max)
+        if (tempInfo->codepoint > FONT_MAX_CODEPOINT)
         {
-            // TODO: Support full unicode.
-            Log_Error("FontLoader", "Codepoint %lu in font \"%s\" exceeds u16_Max. It will be discarded\n", tempInfo->codepoint, fontName);
+            Log_Error("FontLoader", "Codepoint %lu in font \"%s\" is not a Unicode codepoint. It will be discarded\n", tempInfo->codepoint, fontName);
             continue;
         }
 
@@ -233,7 +628,23 @@ Font LoadFont(MemoryStack* tempStack, void* fileBytes, f32 height, CodepointRang
         info->advance = tempInfo->advance;
         info->leftBearing = tempInfo->leftBearing;
 
-        glyphsTable[tempInfo->codepoint] = i;
+        // NOTE: The missing glyph is index 0 already, its codepoint must not get a page of its own.
+        if (i != 0)
+        {
+            u32 page = glyphsTable[tempInfo->codepoint >> FONT_GLYPH_PAGE_BITS];
+            glyphPages[(page << FONT_GLYPH_PAGE_BITS) | (tempInfo->codepoint & (FONT_GLYPH_PAGE_SIZE - 1))] = (u16)i;
+        }
+    }
+
+    FontKerningPair* kerningTable = NULL;
+    u32 kerningTableSize = 0;
+    u32 kerningPairsCount = BakeKerningPairs(&bakeData, &kerningTable, &kerningTableSize);
+    Log_Info("FontLoader", "Font \"%s\" has %lu kerning pairs between loaded glyphs\n", fontName, kerningPairsCount);
+
+    if (coreAPI != NULL)
+    {
+        Log_Info("FontLoader", "Baked %lu glyphs of font \"%s\" in %.1f ms on %lu threads\n", btimapsCount, fontName,
+                 (coreAPI->GetTimestamp() - bakeBegin) * 1000.0, coreAPI->GetJobThreadsCount());
     }
 
     result.ascent = ascent * scale;
@@ -249,6 +660,11 @@ Font LoadFont(MemoryStack* tempStack, void* fileBytes, f32 height, CodepointRang
     result.glyphCount = btimapsCount;
     result.glyphs = glyphsInfo;
     result.glyphsTable = glyphsTable;
+    result.glyphPages = glyphPages;
+    result.glyphPagesCount = glyphPagesCount;
+    result.kerningTable = kerningTable;
+    result.kerningTableSize = kerningTableSize;
+    result.kerningPairsCount = kerningPairsCount;
 
     result.sdfBakeParams.x = OnEdgeValue;
     result.sdfBakeParams.x = PixelDistScale;
@@ -2,6 +2,7 @@
 
 #include "core/Common.h"
 #include "core/Memory.h"
+#include "core/CoreAPI.h"
 
 typedef struct
 {
@@ -26,6 +27,14 @@ typedef struct
     f32 leftBearing;
 } FontGlyphInfo;
 
+// NOTE: One slot of the kerning hash table. pair is (first glyph index << 16) | second glyph index, pairs with
+// the missing glyph are never stored so 0 marks an empty slot.
+typedef struct
+{
+    u32 pair;
+    f32 advance;
+} FontKerningPair;
+
 typedef struct
 {
     f32 ascent;
@@ -44,10 +53,68 @@ typedef struct
     Vector2 sdfDrawParams;
     Vector2 sdfBakeParams;
 
-    // Unicode codepoint -> glyphIndex;
-    // TODO: Use hash table for full unicode support.
-#define FONT_GLYPHS_TABLE_SIZE u16_Max
+    // Unicode codepoint -> glyph index through a two level table. glyphsTable holds one page index per
+    // FONT_GLYPH_PAGE_SIZE codepoints followed by the pages themselves. Page 0 is all zeros, so codepoints
+    // the font has no glyph for land on the missing glyph without a branch.
+#define FONT_MAX_CODEPOINT 0x10ffff
+#define FONT_GLYPH_PAGE_BITS 8
+#define FONT_GLYPH_PAGE_SIZE (1 << FONT_GLYPH_PAGE_BITS)
+#define FONT_GLYPH_PAGE_TABLE_SIZE ((FONT_MAX_CODEPOINT >> FONT_GLYPH_PAGE_BITS) + 1)
     u16* glyphsTable;
+    u16* glyphPages;
+    u32 glyphPagesCount;
+
+    // Kerning adjustments in baked pixels, open addressed with a power of two slots count.
+    FontKerningPair* kerningTable;
+    u32 kerningTableSize;
+    u32 kerningPairsCount;
 } Font;
 
-Font LoadFont(MemoryStack* tempStack, void* fileBytes, f32 height, CodepointRange* ranges, u32 rangeCount, const char* fontName);
+// NOTE: Size of glyphsTable in entries, the page table and the pages are one allocation.
+inline u32 GetGlyphsTableSize(const Font* font)
+{
+    return FONT_GLYPH_PAGE_TABLE_SIZE + font->glyphPagesCount * FONT_GLYPH_PAGE_SIZE;
+}
+
+inline u32 GetGlyphIndex(const Font* font, char32 codepoint)
+{
+    if (codepoint > FONT_MAX_CODEPOINT)
+    {
+        return 0;
+    }
+
+    u32 page = font->glyphsTable[codepoint >> FONT_GLYPH_PAGE_BITS];
+    return font->glyphPages[(page << FONT_GLYPH_PAGE_BITS) | (codepoint & (FONT_GLYPH_PAGE_SIZE - 1))];
+}
+
+inline u32 HashKerningPair(u32 pair)
+{
+    u32 hash = pair * 0x9e3779b1;
+    return hash ^ (hash >> 16);
+}
+
+// NOTE: Kerning between two glyph indices, to be scaled like the advance. The table is at most half full,
+// a pair without kerning usually stops at the first slot.
+inline f32 GetKerningAdvance(const Font* font, u32 firstGlyph, u32 secondGlyph)
+{
+    if (font->kerningPairsCount == 0)
+    {
+        return 0.0f;
+    }
+
+    u32 pair = (firstGlyph << 16) | secondGlyph;
+    u32 mask = font->kerningTableSize - 1;
+    for (u32 slot = HashKerningPair(pair) & mask; font->kerningTable[slot].pair != 0; slot = (slot + 1) & mask)
+    {
+        if (font->kerningTable[slot].pair == pair)
+        {
+            return font->kerningTable[slot].advance;
+        }
+    }
+
+    return 0.0f;
+}
+
+// NOTE: Glyph SDFs are baked on the job threads when coreAPI is given, on the calling thread otherwise. Kerning pairs
+// are always collected on the calling thread. Must be called from the main thread or a job.
+Font LoadFont(CoreAPI* coreAPI, MemoryStack* tempStack, void* fileBytes, f32 height, CodepointRange* ranges, u32 rangeCount, const char* fontName);
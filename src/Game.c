@@ -10,6 +10,7 @@
 #include "core/Keys.h"
 #include "Assets.h"
 #include "StringUtils.h"
+#include <utf8/utf8.h>
 
 char* LoremIpsum = "Давно выяснено, что при оценке дизайна и композиции читаемый текст мешает сосредоточиться. Lorem Ipsum используют потому, что тот обеспечивает более или менее стандартное заполнение шаблона, а также реальное распределение букв и пробелов в абзацах, которое не получается при простой дубликации Здесь ваш текст.. Здесь ваш текст.. Здесь ваш текст.. Многие программы электронной вёрстки и редакторы HTML используют Lorem Ipsum в качестве текста по умолчанию, так что поиск по ключевым словам lorem ipsum сразу показывает, как много веб-страниц всё ещё дожидаются своего настоящего рождения. За прошедшие годы текст Lorem Ipsum получил много версий. Некоторые версии появились по ошибке, некоторые - намеренно (например, юмористические варианты).";
 
@@ -28,16 +29,84 @@ f32 RandomUnilateral(RandomSeries* state)
     return (f32)(state->a / (f64)u32_Max);
 }
 
+typedef enum
+{
+    ScenePathMode_Joined,
+    ScenePathMode_Quads,
+    ScenePathMode_Segments,
+
+    ScenePathMode_Count
+} ScenePathMode;
+
+static const char* ScenePathModeNames[ScenePathMode_Count] = { "joined", "quads", "segments" };
+
+// NOTE: Sort layers, draws are submitted layer by layer and grouped by material within a layer.
+typedef enum
+{
+    SceneLayer_Paths,
+    SceneLayer_Text,
+    SceneLayer_Image
+} SceneLayer;
+
+// NOTE: Path batches are recorded in parallel, each slice owns its geometry and commands and they are
+// appended to the frame command buffer in slice order. The slice count is fixed so the recorded scene
+// does not depend on how many job threads are running.
+#define ScenePathSlicesCount (16)
+#define ScenePathPolyBatchesCount (500)
+#define ScenePathCircleBatchesCount (10)
+
+#define ScenePathSliceCommandsSize (Megabytes(1))
+#define ScenePathSliceVerticesSize (Megabytes(128))
+#define ScenePathSliceIndicesSize (Megabytes(64))
+#define ScenePathSliceRangesSize (Megabytes(1))
+#define ScenePathSliceSegmentsSize (Megabytes(32))
+// NOTE: Every slice buffer is aligned to the commit granularity, the last term is room for that padding.
+#define ScenePathSliceSize (ScenePathSliceCommandsSize + ScenePathSliceVerticesSize + ScenePathSliceIndicesSize + ScenePathSliceRangesSize + ScenePathSliceSegmentsSize + 5 * SceneCommitGranularity)
+
+// NOTE: Big buffers only reserve address space, pages are committed in steps of this size as they fill up.
+#define SceneCommitGranularity (Kilobytes(256))
+
+typedef struct
+{
+    GeometryBuffer geometryBuffer;
+    GeometryBufferPages geometryPages;
+    RenderCommandBuffer commandBuffer;
+    VirtualMemoryRange commandPages;
+    // NOTE: Kept across frames, a cached slice is not recorded again and keeps the count from when it was.
+    u32 segmentsCount;
+    u64 retainedKey;
+    RetainedGeometry* retained;
+} ScenePathSlice;
+
 typedef struct
 {
     GeometryBuffer geometryBuffer;
+    GeometryBufferPages geometryPages;
+    ScenePathSlice pathSlices[ScenePathSlicesCount];
+    // NOTE: Reserved address space reset every frame, each path slice carves its buffers out of it.
+    ConcurrentMemoryStack pathArena;
+    // NOTE: Path slices are static, each one is recorded once and submitted from the cache after that.
+    RetainedGeometryCache pathCache;
+    VirtualMemoryRange retainedPages;
+    MemoryStack retainedStack;
+    TextLayoutCache textLayoutCache;
+    VirtualMemoryRange textLayoutPages;
+    MemoryStack textLayoutStack;
+    u32 recordedSlices[ScenePathSlicesCount];
+    b32 retainGeometry;
+    b32 decommitUnused;
+    MemoryTracker memoryTracker;
+    b32 memoryReport;
+    ScenePathMode pathMode;
+    b32 compactVertices;
+    b32 sortCommands;
+    b32 kerning;
 
     Texture2D texture;
     RenderCommandBuffer commandBuffer;
+    VirtualMemoryRange commandPages;
     Matrix4x4 projectionTransform;
 
-    MemoryStack tempStack;
-    MemoryStack tempStack1;
     CoreState* core;
 
     Texture2D whiteTexture;
@@ -77,6 +146,145 @@ void _WriteLog(CoreLogLevel logLevel, const char* tags, u32 tagsCount, const cha
 #define Log_Trace(tag, format, ...) _WriteLog(CoreLogLevel_Trace, tag, 1, format, ##__VA_ARGS__)
 #define Log_Warn(tag, format, ...) _WriteLog(CoreLogLevel_Warning, tag, 1, format, ##__VA_ARGS__)
 
+// NOTE: Stage timers are no-ops unless the platform layer provides a frame profile.
+// ProfileEnd returns the current timestamp so consecutive stages can be chained.
+static inline f64 ProfileBegin(GameState* gameState)
+{
+    return gameState->core->frameProfile != NULL ? gameState->core->coreAPI.GetTimestamp() : 0.0;
+}
+
+static inline f64 ProfileEnd(GameState* gameState, FrameProfileStage stage, f64 begin)
+{
+    FrameProfile* profile = gameState->core->frameProfile;
+    if (profile == NULL)
+    {
+        return 0.0;
+    }
+
+    f64 now = gameState->core->coreAPI.GetTimestamp();
+    profile->stageTimes[stage] += now - begin;
+    return now;
+}
+
+VirtualMemoryRange ReserveVirtualRange(CoreAPI* core, uptr size, AllocationFailStrategy failStrategy, const char* debugTag)
+{
+    PagesAllocationResult pages = core->ReservePages(size);
+    Assert(pages.memory);
+    return mmCreateVirtualRange(pages.memory, pages.actualSize, SceneCommitGranularity, core->CommitPages, core->DecommitPages, failStrategy, debugTag);
+}
+
+// NOTE: Carves a range out of reserved memory, the stack only hands out addresses and never touches them.
+VirtualMemoryRange PushVirtualRange(CoreAPI* core, MemoryStack* stack, uptr size, AllocationFailStrategy failStrategy, const char* debugTag)
+{
+    void* memory = mmStackPushAligned(stack, size, SceneCommitGranularity);
+    return mmCreateVirtualRange(memory, size, SceneCommitGranularity, core->CommitPages, core->DecommitPages, failStrategy, debugTag);
+}
+
+void TrackGameMemory(GameState* gameState)
+{
+    MemoryTracker* tracker = &gameState->memoryTracker;
+    CoreAPI* coreAPI = &gameState->core->coreAPI;
+
+    // NOTE: Only the main thread scratch stacks are visible from here, every scope on them has to end within the frame.
+    MemoryStack* scratch = coreAPI->GetScratchStack(NULL);
+    mmTrackStack(tracker, scratch, true);
+    mmTrackStack(tracker, coreAPI->GetScratchStack(scratch), true);
+    mmTrackStack(tracker, gameState->fontStacks + 0, false);
+    mmTrackStack(tracker, gameState->fontStacks + 1, false);
+
+    mmTrackVirtualRange(tracker, &gameState->commandPages, gameState->commandPages.debugTag);
+    mmTrackVirtualRange(tracker, &gameState->geometryPages.vertices, gameState->geometryPages.vertices.debugTag);
+    mmTrackVirtualRange(tracker, &gameState->geometryPages.indices, gameState->geometryPages.indices.debugTag);
+    mmTrackVirtualRange(tracker, &gameState->geometryPages.ranges, gameState->geometryPages.ranges.debugTag);
+    mmTrackVirtualRange(tracker, &gameState->geometryPages.segments, gameState->geometryPages.segments.debugTag);
+
+    mmTrackConcurrentStack(tracker, &gameState->pathArena);
+    mmTrackStack(tracker, &gameState->retainedStack, false);
+    mmTrackPool(tracker, &gameState->pathCache.entryPool);
+    mmTrackStack(tracker, &gameState->textLayoutStack, false);
+    mmTrackPool(tracker, &gameState->textLayoutCache.entryPool);
+    for (u32 i = 0; i < ScenePathSlicesCount; i++)
+    {
+        ScenePathSlice* slice = gameState->pathSlices + i;
+        mmTrackVirtualRange(tracker, &slice->commandPages, "Path Slice Commands");
+        mmTrackVirtualRange(tracker, &slice->geometryPages.vertices, "Path Slice Vertices");
+        mmTrackVirtualRange(tracker, &slice->geometryPages.indices, "Path Slice Indices");
+        mmTrackVirtualRange(tracker, &slice->geometryPages.ranges, "Path Slice Ranges");
+        mmTrackVirtualRange(tracker, &slice->geometryPages.segments, "Path Slice Segments");
+    }
+}
+
+void ReportGameMemory(GameState* gameState)
+{
+    MemoryTracker* tracker = &gameState->memoryTracker;
+    for (u32 i = 0; i < tracker->tagsCount; i++)
+    {
+        MemoryTagStats* tag = tracker->tags + i;
+        if (tag->frameLeakedBytes != 0 && tracker->leaksChanged && tag->leakingFramesCount == 1)
+        {
+            Log_Error("Memory", "\"%s\" kept %llu bytes past the end of frame %llu, a stack scope was not ended.\n", tag->debugTag, (unsigned long long)tag->frameLeakedBytes, (unsigned long long)tracker->framesCount);
+        }
+    }
+
+    if (!gameState->memoryReport || !tracker->peaksChanged)
+    {
+        return;
+    }
+
+    Log_Info("Memory", "High-water marks after frame %llu:\n", (unsigned long long)tracker->framesCount);
+    for (u32 i = 0; i < tracker->tagsCount; i++)
+    {
+        MemoryTagStats* tag = tracker->tags + i;
+        Log_Info("Memory", "  %-22s x%-3u %10.2f MB peak of %10.2f MB, %8llu pushes, %10.2f MB pushed per frame\n", tag->debugTag, tag->objectsCount,
+            tag->peak / (f64)Megabytes(1), tag->capacity / (f64)Megabytes(1), (unsigned long long)tag->framePushesCount, tag->framePushedBytes / (f64)Megabytes(1));
+    }
+}
+
+void ShowMemoryWindow(GameState* gameState)
+{
+    ImGuiApi* imgui = gameState->core->imgui;
+    MemoryTracker* tracker = &gameState->memoryTracker;
+
+    if (imgui->igBegin("Memory", NULL, 0))
+    {
+        ImVec2 size = {0.0f, 0.0f};
+        if (imgui->igBeginTable("MemoryTags", 7, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg, size, 0.0f))
+        {
+            imgui->igTableSetupColumn("Tag", 0, 0.0f, 0);
+            imgui->igTableSetupColumn("Used MB", 0, 0.0f, 0);
+            imgui->igTableSetupColumn("Frame Peak MB", 0, 0.0f, 0);
+            imgui->igTableSetupColumn("Peak MB", 0, 0.0f, 0);
+            imgui->igTableSetupColumn("Capacity MB", 0, 0.0f, 0);
+            imgui->igTableSetupColumn("Pushes / Frame", 0, 0.0f, 0);
+            imgui->igTableSetupColumn("Leaked", 0, 0.0f, 0);
+            imgui->igTableHeadersRow();
+
+            for (u32 i = 0; i < tracker->tagsCount; i++)
+            {
+                MemoryTagStats* tag = tracker->tags + i;
+                imgui->igTableNextRow(0, 0.0f);
+                imgui->igTableNextColumn();
+                imgui->igText("%s (%u)", tag->debugTag, tag->objectsCount);
+                imgui->igTableNextColumn();
+                imgui->igText("%.2f", tag->used / (f64)Megabytes(1));
+                imgui->igTableNextColumn();
+                imgui->igText("%.2f", tag->framePeak / (f64)Megabytes(1));
+                imgui->igTableNextColumn();
+                imgui->igText("%.2f", tag->peak / (f64)Megabytes(1));
+                imgui->igTableNextColumn();
+                imgui->igText("%.2f", tag->capacity / (f64)Megabytes(1));
+                imgui->igTableNextColumn();
+                imgui->igText("%llu", (unsigned long long)tag->framePushesCount);
+                imgui->igTableNextColumn();
+                imgui->igText("%llu B in %llu frames", (unsigned long long)tag->frameLeakedBytes, (unsigned long long)tag->leakingFramesCount);
+            }
+
+            imgui->igEndTable();
+        }
+    }
+    imgui->igEnd();
+}
+
 void* LoadFile(CoreAPI* core, const char* filename, MemoryStack* stack)
 {
     FileHandle handle = core->OpenFile(filename, OpenFileMode_Read);
@@ -103,7 +311,8 @@ void* LoadFile(CoreAPI* core, const char* filename, MemoryStack* stack)
 void ReloadFont(GameState* gameState)
 {
     mmStackRewind(gameState->fontStacks + 1);
-    mmStackSetMark(gameState->fontStacks + 0);
+    MemoryStack* scratch = gameState->core->coreAPI.GetScratchStack(NULL);
+    MemoryStackScope scratchScope = mmBeginStackScope(scratch);
 
     gameState->core->rendererAPI->UnloadTexture2D(gameState->fontAtlasTexture.id);
 
@@ -114,32 +323,48 @@ void ReloadFont(GameState* gameState)
     ranges[1].begin = 1024;
     ranges[1].end = 1024 + 256;
 
-    Font font = LoadFont(gameState->fontStacks + 0, gameState->fontFileData, gameState->fontSize, ranges, 2, gameState->fontName);
+    Font font = LoadFont(&gameState->core->coreAPI, scratch, gameState->fontFileData, gameState->fontSize, ranges, 2, gameState->fontName);
     Assert(font.bitmap);
 
     void* newGlyphs = mmStackPush(gameState->fontStacks + 1, sizeof(FontGlyphInfo) * font.glyphCount);
     mmCopy(newGlyphs, font.glyphs, sizeof(FontGlyphInfo) * font.glyphCount);
     font.glyphs = newGlyphs;
 
-    void* newGlyphsTable = mmStackPushAligned(gameState->fontStacks + 1, sizeof(u16) * FONT_GLYPHS_TABLE_SIZE, 1);
-    mmCopy(newGlyphsTable, font.glyphsTable, sizeof(u16) * FONT_GLYPHS_TABLE_SIZE);
+    u32 glyphsTableSize = GetGlyphsTableSize(&font);
+    u16* newGlyphsTable = mmStackPush(gameState->fontStacks + 1, sizeof(u16) * glyphsTableSize);
+    mmCopy(newGlyphsTable, font.glyphsTable, sizeof(u16) * glyphsTableSize);
     font.glyphsTable = newGlyphsTable;
+    font.glyphPages = newGlyphsTable + FONT_GLYPH_PAGE_TABLE_SIZE;
+
+    if (font.kerningTableSize > 0)
+    {
+        FontKerningPair* newKerningTable = mmStackPush(gameState->fontStacks + 1, sizeof(FontKerningPair) * font.kerningTableSize);
+        mmCopy(newKerningTable, font.kerningTable, sizeof(FontKerningPair) * font.kerningTableSize);
+        font.kerningTable = newKerningTable;
+    }
 
     gameState->font = font;
+    gfxResetTextLayoutCache(&gameState->textLayoutCache);
 
     TextureSamplerSettings sampler;
     sampler.filtering = TextureFiltering_Bilinear;
     gameState->fontAtlasTexture = gameState->core->rendererAPI->LoadTexture2D(font.bitmapDim, font.bitmapDim, TextureFormat_R8, font.bitmap, 0);
     Assert(gameState->fontAtlasTexture.id.data0);
 
-    mmStackRewind(gameState->fontStacks + 0);
+    mmEndStackScope(scratchScope);
 }
 
 Texture2D LoadTextureFromPng(const char* file, MemoryStack* stack, CoreState* core)
 {
-    mmStackSetMark(stack);
+    MemoryStackScope scope = mmBeginStackScope(stack);
     ImageData img = resLoadImageFromFile(&core->coreAPI, file, 4, stack);
-    Assert(img.data != NULL);
+    if (img.data == NULL)
+    {
+        // NOTE: Happens on checkouts without LFS objects. Caller falls back to another texture.
+        mmEndStackScope(scope);
+        Texture2D empty = {0};
+        return empty;
+    }
 
     u32 x = img.width / 4;
     u32 y = img.height / 4;
@@ -155,10 +380,188 @@ Texture2D LoadTextureFromPng(const char* file, MemoryStack* stack, CoreState* co
     sampler.filtering = TextureFiltering_Point;
     Texture2D texture = core->rendererAPI->LoadTexture2D(comp.width, comp.height, TextureFormat_sRGB_DXT1, comp.data, comp.dataSize);
     Assert(texture.id.data0);
-    mmStackRewind(stack);
+    mmEndStackScope(scope);
     return texture;
 }
 
+const char* FindCommandLineValue(CoreState* core, const char* name)
+{
+    for (u32 i = 1; i + 1 < core->commandLineArgsCount; i++)
+    {
+        if (asciiStringEquals(core->commandLineArgs[i], name))
+        {
+            return core->commandLineArgs[i + 1];
+        }
+    }
+
+    return NULL;
+}
+
+#define StringBenchmarkSize (Megabytes(1))
+#define StringBenchmarkPasses (32)
+
+typedef struct
+{
+    const char* utf8Text;
+    u32 size;
+    u32 count;
+    char32* utf32Text;
+    char* utf8Out;
+} StringBenchmarkData;
+
+typedef u64 StringBenchmarkFn(StringBenchmarkData* data);
+
+static u64 StringLengthReference(StringBenchmarkData* data) { return utf8size_lazy(data->utf8Text); }
+static u64 StringLengthVectorized(StringBenchmarkData* data) { return asciiStringLength(data->utf8Text); }
+static u64 CodepointsCountReference(StringBenchmarkData* data) { return utf8len(data->utf8Text); }
+static u64 CodepointsCountVectorized(StringBenchmarkData* data) { return utf8CodepointsCount(data->utf8Text, data->size); }
+static u64 ValidateReference(StringBenchmarkData* data) { return utf8valid(data->utf8Text) == NULL; }
+static u64 ValidateVectorized(StringBenchmarkData* data) { return utf8Validate(data->utf8Text, data->size); }
+static u64 Utf8ToUtf32Vectorized(StringBenchmarkData* data) { return utf8ToUtf32(data->utf8Text, data->size, data->utf32Text); }
+static u64 Utf32ToUtf8Vectorized(StringBenchmarkData* data) { return utf32ToUtf8(data->utf32Text, data->count, data->utf8Out); }
+
+static u64 Utf8ToUtf32Reference(StringBenchmarkData* data)
+{
+    const char* at = data->utf8Text;
+    char32* out = data->utf32Text;
+    while (*at != 0)
+    {
+        at = utf8codepoint(at, (utf8_int32_t*)out++);
+    }
+
+    return (u64)(out - data->utf32Text);
+}
+
+static u64 Utf32ToUtf8Reference(StringBenchmarkData* data)
+{
+    char* out = data->utf8Out;
+    for (u32 i = 0; i < data->count; i++)
+    {
+        out = utf8catcodepoint(out, (utf8_int32_t)data->utf32Text[i], 4);
+    }
+
+    return (u64)(out - data->utf8Out);
+}
+
+typedef struct
+{
+    const char* name;
+    StringBenchmarkFn* reference;
+    StringBenchmarkFn* vectorized;
+} StringBenchmarkCase;
+
+// NOTE: Called through a volatile pointer, otherwise the utf8.h functions, which are declared pure, get
+// hoisted out of the loop and only run once.
+static f64 TimeStringBenchmark(CoreAPI* coreAPI, StringBenchmarkFn* volatile fn, StringBenchmarkData* data, u64* checksum)
+{
+    f64 begin = coreAPI->GetTimestamp();
+    for (u32 pass = 0; pass < StringBenchmarkPasses; pass++)
+    {
+        *checksum += fn(data);
+    }
+
+    return coreAPI->GetTimestamp() - begin;
+}
+
+// NOTE: --string-benchmark on times the vectorized StringUtils routines against the utf8.h loops they
+// replace, on the lorem ipsum text repeated to StringBenchmarkSize bytes.
+void RunStringBenchmark(GameState* gameState)
+{
+    CoreAPI* coreAPI = &gameState->core->coreAPI;
+    MemoryStack* scratch = coreAPI->GetScratchStack(NULL);
+    MemoryStackScope scratchScope = mmBeginStackScope(scratch);
+
+    u32 loremSize = asciiStringLength(LoremIpsum);
+    u32 size = StringBenchmarkSize - StringBenchmarkSize % loremSize;
+    char* utf8Text = mmStackPush(scratch, size + 1);
+    for (u32 offset = 0; offset < size; offset += loremSize)
+    {
+        mmCopy(utf8Text + offset, LoremIpsum, loremSize);
+    }
+    utf8Text[size] = 0;
+
+    StringBenchmarkData data = {0};
+    data.utf8Text = utf8Text;
+    data.size = size;
+    data.count = utf8CodepointsCount(utf8Text, size);
+    data.utf32Text = mmStackPush(scratch, sizeof(char32) * (data.count + 1));
+    data.utf8Out = mmStackPush(scratch, size + 1);
+    utf8ToUtf32(utf8Text, size, data.utf32Text);
+
+    StringBenchmarkCase cases[] = {
+        { "length", StringLengthReference, StringLengthVectorized },
+        { "codepoints", CodepointsCountReference, CodepointsCountVectorized },
+        { "validation", ValidateReference, ValidateVectorized },
+        { "UTF-8 to 32", Utf8ToUtf32Reference, Utf8ToUtf32Vectorized },
+        { "UTF-32 to 8", Utf32ToUtf8Reference, Utf32ToUtf8Vectorized },
+    };
+
+    Log_Info("Strings", "%u bytes, %u codepoints, %u passes:\n", data.size, data.count, StringBenchmarkPasses);
+    f64 megabytes = (f64)size * StringBenchmarkPasses / (f64)Megabytes(1);
+    u64 checksum = 0;
+    for (u32 i = 0; i < ArrayCount(cases); i++)
+    {
+        f64 referenceTime = TimeStringBenchmark(coreAPI, cases[i].reference, &data, &checksum);
+        f64 vectorizedTime = TimeStringBenchmark(coreAPI, cases[i].vectorized, &data, &checksum);
+        Log_Info("Strings", "  %-12s %9.1f MB/s utf8.h %9.1f MB/s vectorized %6.2fx\n", cases[i].name,
+                 megabytes / referenceTime, megabytes / vectorizedTime, referenceTime / vectorizedTime);
+    }
+
+    Log_Info("Strings", "  checksum %llu\n", (unsigned long long)checksum);
+    mmEndStackScope(scratchScope);
+}
+
+#define TextBenchmarkSize (Kilobytes(64))
+#define TextBenchmarkPasses (64)
+
+// NOTE: --text-benchmark on times breaking the lorem ipsum text, repeated to TextBenchmarkSize bytes, into
+// lines with kerning off and on.
+void RunTextBenchmark(GameState* gameState)
+{
+    CoreAPI* coreAPI = &gameState->core->coreAPI;
+    MemoryStack* scratch = coreAPI->GetScratchStack(NULL);
+    MemoryStackScope scratchScope = mmBeginStackScope(scratch);
+
+    u32 loremSize = asciiStringLength(LoremIpsum);
+    u32 size = TextBenchmarkSize - TextBenchmarkSize % loremSize;
+    char* utf8Text = mmStackPush(scratch, size);
+    for (u32 offset = 0; offset < size; offset += loremSize)
+    {
+        mmCopy(utf8Text + offset, LoremIpsum, loremSize);
+    }
+
+    TextDrawBatch textBatch;
+    textBatch.height = gameState->textScale;
+    textBatch.font = &gameState->font;
+    textBatch.color = DefaultColor32_Black;
+    textBatch.data = utf8Text;
+    textBatch.dataCount = size;
+
+    Rectangle2D rect = {0};
+    rect.max = MakeVector2(1600.0f, 1.0e9f);
+
+    u32 codepointsCount = utf8CodepointsCount(utf8Text, size);
+    Log_Info("Text", "%u codepoints, %u kerning pairs, %u passes:\n", codepointsCount, gameState->font.kerningPairsCount, TextBenchmarkPasses);
+    for (u32 kerning = 0; kerning < 2; kerning++)
+    {
+        TextDrawParams params = {0};
+        params.kerning = kerning;
+
+        u32 linesCount = 0;
+        f64 begin = coreAPI->GetTimestamp();
+        for (u32 pass = 0; pass < TextBenchmarkPasses; pass++)
+        {
+            gfxCalcTextBoundingBox(rect, &textBatch, 1, params, &linesCount);
+        }
+
+        f64 time = coreAPI->GetTimestamp() - begin;
+        Log_Info("Text", "  kerning %-3s %8.2f M glyphs/s, %u lines\n", kerning ? "on" : "off",
+                 (f64)codepointsCount * TextBenchmarkPasses / time * 1.0e-6, linesCount);
+    }
+
+    mmEndStackScope(scratchScope);
+}
+
 void GameInit(CoreState* core)
 {
     GameState* gameState = GetGameState();
@@ -171,23 +574,85 @@ void GameInit(CoreState* core)
     gameState->fontStacks[0] = mmCreateStack(fontPages.memory, fontPages.actualSize, false, AllocationFailedStrategy_Crash, "Font Stack 0");
     gameState->fontStacks[1] = mmCreateStack(fontPages.memory, fontPages.actualSize, true, AllocationFailedStrategy_Crash, "Font Stack 1");
 
-    PagesAllocationResult allocResult = core->coreAPI.AllocatePages(Megabytes(128));
-    gameState->tempStack = mmCreateStack(allocResult.memory, allocResult.actualSize, false, AllocationFailedStrategy_Crash, "Temp Stack 0");
-    gameState->tempStack1 = mmCreateStack(allocResult.memory, allocResult.actualSize, true, AllocationFailedStrategy_Crash, "Temp Stack 1");
-
     gameState->fontFileData = LoadFile(&gameState->core->coreAPI, "../../assets/fonts/Roboto-Medium.ttf", gameState->fontStacks + 0);
     Assert(gameState->fontFileData);
 
-    u32 commandBufferCapacity = 102400;
-    gameState->commandBuffer.commands = core->coreAPI.AllocatePages(Megabytes(1024)).memory;
-    gameState->commandBuffer.renderCommandsCount = 0;
+    gameState->commandPages = ReserveVirtualRange(&core->coreAPI, Megabytes(1024), AllocationFailedStrategy_Crash, "Command Buffer");
+    gameState->commandBuffer.commands = (RenderCommandEntry*)gameState->commandPages.memory;
+    gameState->commandBuffer.commandPages = &gameState->commandPages;
+    rcmdResetCommandBuffer(&gameState->commandBuffer);
+
+    gfxResetGeometryBuffer(&gameState->geometryBuffer);
+    gameState->geometryPages.vertices = ReserveVirtualRange(&core->coreAPI, Megabytes(1024), AllocationFailedStrategy_Crash, "Vertex Buffer");
+    gameState->geometryPages.indices = ReserveVirtualRange(&core->coreAPI, Megabytes(1024), AllocationFailedStrategy_Crash, "Index Buffer");
+    gameState->geometryPages.ranges = ReserveVirtualRange(&core->coreAPI, Megabytes(1), AllocationFailedStrategy_Crash, "Range Buffer");
+    gameState->geometryPages.segments = ReserveVirtualRange(&core->coreAPI, Megabytes(256), AllocationFailedStrategy_Crash, "Segment Buffer");
+    gfxSetGeometryBufferPages(&gameState->geometryBuffer, &gameState->geometryPages);
+
+    // NOTE: Chunks are pushed with cache line alignment, leave room for the padding.
+    PagesAllocationResult pathPages = core->coreAPI.ReservePages((ScenePathSliceSize + 64) * ScenePathSlicesCount);
+    gameState->pathArena = mmCreateConcurrentStack(pathPages.memory, pathPages.actualSize, AllocationFailedStrategy_Crash, "Path Arena");
+
+    gameState->retainedPages = ReserveVirtualRange(&core->coreAPI, Megabytes(1024), AllocationFailedStrategy_ReturnNull, "Retained Geometry");
+    gameState->retainedStack = mmCreateGrowableStack(&gameState->retainedPages, AllocationFailedStrategy_ReturnNull, "Retained Geometry");
+    gfxInitRetainedGeometryCache(&gameState->pathCache, &gameState->retainedStack);
+
+    gameState->textLayoutPages = ReserveVirtualRange(&core->coreAPI, Megabytes(64), AllocationFailedStrategy_ReturnNull, "Text Layouts");
+    gameState->textLayoutStack = mmCreateGrowableStack(&gameState->textLayoutPages, AllocationFailedStrategy_ReturnNull, "Text Layouts");
+    gfxInitTextLayoutCache(&gameState->textLayoutCache, &gameState->textLayoutStack);
+
+    // NOTE: --path-mode joined|quads|segments picks how the scene emits lines.
+    gameState->pathMode = ScenePathMode_Joined;
+    const char* pathMode = FindCommandLineValue(core, "--path-mode");
+    for (u32 mode = 0; pathMode != NULL && mode < ScenePathMode_Count; mode++)
+    {
+        if (asciiStringEquals(pathMode, ScenePathModeNames[mode]))
+        {
+            gameState->pathMode = (ScenePathMode)mode;
+        }
+    }
+
+    // NOTE: --vertex-format full keeps every batch in the 24 byte RenderVertex layout.
+    const char* vertexFormat = FindCommandLineValue(core, "--vertex-format");
+    gameState->compactVertices = vertexFormat == NULL || !asciiStringEquals(vertexFormat, "full");
+
+    // NOTE: --batch-merge off records one SetMaterial and one draw per batch.
+    const char* batchMerge = FindCommandLineValue(core, "--batch-merge");
+    gameState->commandBuffer.mergeCommands = batchMerge == NULL || !asciiStringEquals(batchMerge, "off");
+
+    // NOTE: --sort-commands off submits draws in recording order.
+    const char* sortCommands = FindCommandLineValue(core, "--sort-commands");
+    gameState->sortCommands = sortCommands == NULL || !asciiStringEquals(sortCommands, "off");
+
+    // NOTE: --decommit-unused on gives pages a frame did not need back to the system before the next one.
+    const char* decommitUnused = FindCommandLineValue(core, "--decommit-unused");
+    gameState->decommitUnused = decommitUnused != NULL && asciiStringEquals(decommitUnused, "on");
+
+    // NOTE: --retain-geometry off records every path slice every frame. Off by default under --benchmark,
+    // the scene is static and would only measure cache hits.
+    const char* retainGeometry = FindCommandLineValue(core, "--retain-geometry");
+    gameState->retainGeometry = retainGeometry != NULL ? !asciiStringEquals(retainGeometry, "off") : core->frameProfile == NULL;
+    if (core->frameProfile != NULL)
+    {
+        Log_Info("Benchmark", "Geometry retention is %s\n", gameState->retainGeometry ? "on, retained vertices are reported separately" : "off");
+    }
+
+    // NOTE: --memory-report on logs the memory table whenever a tag reaches a new high-water mark.
+    const char* memoryReport = FindCommandLineValue(core, "--memory-report");
+    gameState->memoryReport = memoryReport != NULL && asciiStringEquals(memoryReport, "on");
 
-    gameState->geometryBuffer.vertexCount = 0;
-    gameState->geometryBuffer.indexCount = 0;
-    gameState->geometryBuffer.vertexOffset = 0;
-    gameState->geometryBuffer.indexOffset = 0;
-    gameState->geometryBuffer.vertexBuffer = core->coreAPI.AllocatePages(Megabytes(1024)).memory;
-    gameState->geometryBuffer.indexBuffer = core->coreAPI.AllocatePages(Megabytes(1024)).memory;
+    // NOTE: --kerning off lays text out by glyph advances alone.
+    const char* kerning = FindCommandLineValue(core, "--kerning");
+    gameState->kerning = kerning == NULL || !asciiStringEquals(kerning, "off");
+
+    // NOTE: --string-benchmark on logs the throughput of the string routines once at startup.
+    const char* stringBenchmark = FindCommandLineValue(core, "--string-benchmark");
+    if (stringBenchmark != NULL && asciiStringEquals(stringBenchmark, "on"))
+    {
+        RunStringBenchmark(gameState);
+    }
+
+    TrackGameMemory(gameState);
 
     gameState->textScale = 0.7f;
 
@@ -207,7 +672,18 @@ void GameInit(CoreState* core)
 
     ReloadFont(gameState);
 
-    gameState->imageTexture = LoadTextureFromPng("../../assets/sinji.png", &gameState->tempStack, core);
+    // NOTE: --text-benchmark on logs line breaking throughput with kerning off and on once the font is loaded.
+    const char* textBenchmark = FindCommandLineValue(core, "--text-benchmark");
+    if (textBenchmark != NULL && asciiStringEquals(textBenchmark, "on"))
+    {
+        RunTextBenchmark(gameState);
+    }
+
+    gameState->imageTexture = LoadTextureFromPng("../../assets/sinji.png", core->coreAPI.GetScratchStack(NULL), core);
+    if (gameState->imageTexture.id.data0 == 0)
+    {
+        gameState->imageTexture = gameState->whiteTexture;
+    }
 }
 
 void GameReload(CoreState* core)
@@ -218,30 +694,71 @@ void GameUpdate(CoreState* core)
 {
 }
 
-void EmitText(GameState* gameState, GeometryBuffer* buffer, RenderCommandBuffer* commandBuffer, Rectangle2D rect, char32* text, u32 textLength, f32 height, TextDrawParams params)
+RenderVertexFormat GetPathVertexFormat(GameState* gameState)
 {
-    TextDrawBatch textBatch;
-    textBatch.height = height;
-    textBatch.font = &gameState->font;
-    textBatch.color = DefaultColor32_Black;
-    textBatch.data = text;
-    textBatch.dataCount = textLength;
+    return gameState->compactVertices ? RenderVertexFormat_Position2DColor : RenderVertexFormat_PositionUvColor;
+}
+
+RenderVertexFormat GetTexturedVertexFormat(GameState* gameState)
+{
+    return gameState->compactVertices ? RenderVertexFormat_Position2DUv16Color : RenderVertexFormat_PositionUvColor;
+}
 
-    if (textLength != 0)
+// NOTE: Text which stays the same between frames should go through the layout cache, text which changes
+// every frame would only churn it.
+void EmitText(GameState* gameState, GeometryBuffer* buffer, RenderCommandBuffer* commandBuffer, Rectangle2D rect, const char* utf8Text, f32 height, TextDrawParams params, bool cacheLayout)
+{
+    if (utf8Text[0] == 0)
+    {
+        return;
+    }
+
+    f64 time = ProfileBegin(gameState);
+    gfxStartGeometryBatch(buffer, GetTexturedVertexFormat(gameState));
+
+    rcmdSetSortLayer(commandBuffer, SceneLayer_Text);
+    Vector4 sdfParams = MakeVector4(gameState->font.sdfDrawParams.x, gameState->font.sdfDrawParams.y, height / gameState->font.bakedHeight, 0.0f);
+    rcmdSetTextSdfMaterial(commandBuffer, gameState->fontAtlasTexture.id, gameState->linearSampler, sdfParams, MakeVector4(1.0f, 1.0f, 1.0f, 1.0f));
+
+    time = ProfileEnd(gameState, FrameProfileStage_CommandRecording, time);
+
+    u64 layoutKey = 0;
+    TextLayout* layout = NULL;
+    if (cacheLayout)
+    {
+        layoutKey = gfxHashTextLayoutKey(utf8Text, &gameState->font, height, DefaultColor32_Black, rect, params);
+        layout = gfxFindTextLayout(&gameState->textLayoutCache, layoutKey);
+    }
+
+    if (layout == NULL)
     {
-        gfxStartGeometryBatch(buffer);
+        TextDrawBatch textBatch;
+        textBatch.height = height;
+        textBatch.font = &gameState->font;
+        textBatch.color = DefaultColor32_Black;
+        textBatch.data = utf8Text;
+        textBatch.dataCount = asciiStringLength(utf8Text);
+        MemoryStack* scratch = gameState->core->coreAPI.GetScratchStack(NULL);
+
+        if (cacheLayout)
+        {
+            layout = gfxLayoutTextBox(&gameState->textLayoutCache, layoutKey, rect, &textBatch, 1, params, scratch);
+        }
 
-        RenderCommandEntry* sdfMaterialCommand = rcmdPushCommand(commandBuffer);
-        sdfMaterialCommand->command = RenderCommand_SetMaterial;
-        sdfMaterialCommand->setMaterial.type = RenderMaterialType_TextSDF;
-        sdfMaterialCommand->setMaterial.textureId = gameState->fontAtlasTexture.id;
-        sdfMaterialCommand->setMaterial.sampler = gameState->linearSampler;
-        sdfMaterialCommand->setMaterial.sdfParams = MakeVector4(gameState->font.sdfDrawParams.x, gameState->font.sdfDrawParams.y, textBatch.height / gameState->font.bakedHeight, 0.0f);
-        sdfMaterialCommand->setMaterial.color = MakeVector4(1.0f, 1.0f, 1.0f, 1.0f);
+        if (layout == NULL)
+        {
+            gfxEmitTextBoxGeometry(buffer, rect, &textBatch, 1, params, scratch);
+        }
+    }
 
-        gfxEmitTextBoxGeometry(buffer, rect, &textBatch, 1, params);
-        rcmdPushGeometryBatch(commandBuffer, buffer, &gameState->projectionTransform);
+    if (layout != NULL)
+    {
+        gfxEmitTextLayoutGeometry(buffer, layout);
     }
+
+    time = ProfileEnd(gameState, FrameProfileStage_TextLayout, time);
+    rcmdPushGeometryBatch(commandBuffer, buffer, &gameState->projectionTransform);
+    ProfileEnd(gameState, FrameProfileStage_CommandRecording, time);
 }
 
 static void PathBezierCubicCurveToCasteljau(Vector2* path, float x1, float y1, float x2, float y2, float x3, float y3, float x4, float y4, float tess_tol, int level, int* index)
@@ -270,9 +787,32 @@ static void PathBezierCubicCurveToCasteljau(Vector2* path, float x1, float y1, f
     }
 }
 
-static u32 lineSegmentsCount;
+static const PathDrawParams PathParams = { PathJoinType_Miter, 4.0f };
+
+void EmitPath(GeometryBuffer* buffer, ScenePathMode mode, Vector2* points, u32 pointsCount, f32 thickness, u32 color)
+{
+    switch (mode)
+    {
+    case ScenePathMode_Joined: { gfxEmitJoinedPathGeometry(buffer, points, pointsCount, thickness, color, PathParams); } break;
+    case ScenePathMode_Quads: { gfxEmitPathGeometry(buffer, points, pointsCount, thickness, color); } break;
+    case ScenePathMode_Segments: { gfxEmitPathSegments(buffer, points, pointsCount, thickness, color); } break;
+    InvalidDefault();
+    }
+}
+
+void PushPathBatch(GameState* gameState, ScenePathSlice* slice)
+{
+    if (gameState->pathMode == ScenePathMode_Segments)
+    {
+        rcmdPushLineSegmentsBatch(&slice->commandBuffer, &slice->geometryBuffer, &gameState->projectionTransform);
+    }
+    else
+    {
+        rcmdPushGeometryBatch(&slice->commandBuffer, &slice->geometryBuffer, &gameState->projectionTransform);
+    }
+}
 
-void EmitCircle(GeometryBuffer* buffer, Vector2 position, f32 radius, u32 numSegments, u32 color, f32 thckness)
+void EmitCircle(ScenePathSlice* slice, ScenePathMode mode, Vector2 position, f32 radius, u32 numSegments, u32 color, f32 thckness)
 {
     u32 index = 0;
     Vector2 pathBuffer[4096];
@@ -286,14 +826,14 @@ void EmitCircle(GeometryBuffer* buffer, Vector2 position, f32 radius, u32 numSeg
         pathBuffer[index++] = p;
     }
 
-    lineSegmentsCount += index - 1;
-    gfxEmitPathGeometry(buffer, pathBuffer, index, thckness, color);
+    slice->segmentsCount += index - 1;
+    EmitPath(&slice->geometryBuffer, mode, pathBuffer, index, thckness, color);
 }
 
 
 static const Vector2 Directions[] = { {-1.0f, 0.0f}, {1.0f, 0.0f}, {0.0f, -1.0f}, {0.0f, 1.0f} };
 
-void EmitRandomPoly(GeometryBuffer* buffer, RandomSeries* series, u32 maxPoints, Rectangle2D rect, u32 color)
+void EmitRandomPoly(ScenePathSlice* slice, ScenePathMode mode, RandomSeries* series, u32 maxPoints, Rectangle2D rect, u32 color)
 {
     u32 index = 0;
     Vector2 pathBuffer[1024];
@@ -315,8 +855,105 @@ void EmitRandomPoly(GeometryBuffer* buffer, RandomSeries* series, u32 maxPoints,
         pathBuffer[index++] = path;
     }
 
-    lineSegmentsCount += index - 1;
-    gfxEmitPathGeometry(buffer, pathBuffer, index, 1.0f, color);
+    slice->segmentsCount += index - 1;
+    EmitPath(&slice->geometryBuffer, mode, pathBuffer, index, 1.0f, color);
+}
+
+// NOTE: Every batch gets its own random series so the scene is the same no matter which slice records it.
+void EmitPathBatch(GameState* gameState, ScenePathSlice* slice, u32 batchIndex, Rectangle2D screenRect)
+{
+    RandomSeries randomSeries = {(12345u + batchIndex * 0x9E3779B9u) | 1u};
+
+    gfxStartGeometryBatch(&slice->geometryBuffer, GetPathVertexFormat(gameState));
+    rcmdSetQuadMaterial(&slice->commandBuffer, gameState->whiteTexture.id, gameState->linearSampler, DefaultColor_White);
+
+    u32 color = (u32)((f64)RandomUnilateral(&randomSeries) * u32_Max);
+
+    if (batchIndex < ScenePathPolyBatchesCount)
+    {
+        for (u32 i = 0; i < 50; i++)
+        {
+            EmitRandomPoly(slice, gameState->pathMode, &randomSeries, 100, screenRect, color);
+        }
+    }
+    else
+    {
+        for (u32 i = 0; i < 100; i++)
+        {
+            Vector2 position = MakeVector2(RandomUnilateral(&randomSeries) * screenRect.max.x, RandomUnilateral(&randomSeries) * screenRect.max.y);
+            f32 radius = RandomUnilateral(&randomSeries) * 200.0f;
+            f32 thickness = RandomUnilateral(&randomSeries) * 5.0f + 1.0f;
+
+            EmitCircle(slice, gameState->pathMode, position, radius, 64, DefaultColor32_White, thickness);
+        }
+    }
+
+    PushPathBatch(gameState, slice);
+}
+
+// NOTE: Everything a path slice depends on besides constants, slices are looked up in the cache by it.
+static u64 GetPathSliceKey(GameState* gameState, u32 sliceIndex)
+{
+    u64 key = gfxHashGeometryKey(0, &sliceIndex, sizeof(sliceIndex));
+    key = gfxHashGeometryKey(key, &gameState->pathMode, sizeof(gameState->pathMode));
+    key = gfxHashGeometryKey(key, &gameState->compactVertices, sizeof(gameState->compactVertices));
+    key = gfxHashGeometryKey(key, &gameState->commandBuffer.mergeCommands, sizeof(gameState->commandBuffer.mergeCommands));
+    key = gfxHashGeometryKey(key, &gameState->whiteTexture.id, sizeof(gameState->whiteTexture.id));
+    key = gfxHashGeometryKey(key, &gameState->linearSampler, sizeof(gameState->linearSampler));
+    return key;
+}
+
+// NOTE: A cached slice records nothing this frame, its buffers would point into chunks other slices now use.
+static void ClearPathSlice(ScenePathSlice* slice)
+{
+    mmSet(&slice->commandPages, 0, sizeof(slice->commandPages));
+    mmSet(&slice->geometryPages, 0, sizeof(slice->geometryPages));
+    rcmdResetCommandBuffer(&slice->commandBuffer);
+    gfxResetGeometryBuffer(&slice->geometryBuffer);
+}
+
+static void EmitPathSliceJob(void* data, u32 recordedIndex, u32 threadIndex)
+{
+    GameState* gameState = (GameState*)data;
+    u32 sliceIndex = gameState->recordedSlices[recordedIndex];
+    ScenePathSlice* slice = gameState->pathSlices + sliceIndex;
+
+    Rectangle2D screenRect = {0};
+    screenRect.max = MakeVector2(1600.0f, 1200.0f);
+
+    // NOTE: Which chunk a slice gets changes from frame to frame, so its pages are tracked from scratch.
+    // Committing pages which are already committed is cheap.
+    CoreAPI* coreAPI = &gameState->core->coreAPI;
+    MemoryStack sliceStack = mmConcurrentStackPushChunk(&gameState->pathArena, ScenePathSliceSize, "Path Slice");
+    slice->commandPages = PushVirtualRange(coreAPI, &sliceStack, ScenePathSliceCommandsSize, AllocationFailedStrategy_Crash, "Path Slice Commands");
+    slice->commandBuffer.commands = (RenderCommandEntry*)slice->commandPages.memory;
+    slice->commandBuffer.commandPages = &slice->commandPages;
+    rcmdResetCommandBuffer(&slice->commandBuffer);
+
+    gfxResetGeometryBuffer(&slice->geometryBuffer);
+    slice->geometryPages.vertices = PushVirtualRange(coreAPI, &sliceStack, ScenePathSliceVerticesSize, AllocationFailedStrategy_Crash, "Path Slice Vertices");
+    slice->geometryPages.indices = PushVirtualRange(coreAPI, &sliceStack, ScenePathSliceIndicesSize, AllocationFailedStrategy_Crash, "Path Slice Indices");
+    slice->geometryPages.ranges = PushVirtualRange(coreAPI, &sliceStack, ScenePathSliceRangesSize, AllocationFailedStrategy_Crash, "Path Slice Ranges");
+    slice->geometryPages.segments = PushVirtualRange(coreAPI, &sliceStack, ScenePathSliceSegmentsSize, AllocationFailedStrategy_Crash, "Path Slice Segments");
+    gfxSetGeometryBufferPages(&slice->geometryBuffer, &slice->geometryPages);
+
+    slice->commandBuffer.mergeCommands = gameState->commandBuffer.mergeCommands;
+    slice->segmentsCount = 0;
+
+    rcmdSetSortLayer(&slice->commandBuffer, SceneLayer_Paths);
+
+    u32 batchesCount = ScenePathPolyBatchesCount + ScenePathCircleBatchesCount;
+    u32 firstBatch = batchesCount * sliceIndex / ScenePathSlicesCount;
+    u32 lastBatch = batchesCount * (sliceIndex + 1) / ScenePathSlicesCount;
+    for (u32 i = firstBatch; i < lastBatch; i++)
+    {
+        EmitPathBatch(gameState, slice, i, screenRect);
+    }
+
+    if (gameState->decommitUnused)
+    {
+        gfxDecommitGeometryBuffer(&slice->geometryBuffer);
+    }
 }
 
 void GameRender(CoreState* core)
@@ -324,14 +961,25 @@ void GameRender(CoreState* core)
     GameState* gameState = GetGameState();
     gameState->core = core;
 
+    MemoryStack* scratch = core->coreAPI.GetScratchStack(NULL);
+    MemoryStack* scratch1 = core->coreAPI.GetScratchStack(scratch);
+    u64 stackPushesCount = scratch->pushesCount + scratch1->pushesCount;
+    u64 stackPushedBytes = scratch->pushedBytes + scratch1->pushedBytes;
+    mmTrackerBeginFrame(&gameState->memoryTracker);
+
     core->rendererAPI->BeginFrame();
 
-    gameState->commandBuffer.renderCommandsCount = 0;
+    f64 time = ProfileBegin(gameState);
+
+    if (gameState->decommitUnused)
+    {
+        mmDecommitVirtualRange(&gameState->commandPages, sizeof(RenderCommandEntry) * gameState->commandBuffer.renderCommandsCount);
+        gfxDecommitGeometryBuffer(&gameState->geometryBuffer);
+    }
+
+    rcmdResetCommandBuffer(&gameState->commandBuffer);
 
-    gameState->geometryBuffer.vertexCount = 0;
-    gameState->geometryBuffer.indexCount = 0;
-    gameState->geometryBuffer.vertexOffset = 0;
-    gameState->geometryBuffer.indexOffset = 0;
+    gfxResetGeometryBuffer(&gameState->geometryBuffer);
 
     gameState->projectionTransform = OrthoGLRH(0.0f, 1600.0f, 0.0f, 1200.0f, 0.0f, 1.0f);
 
@@ -340,82 +988,162 @@ void GameRender(CoreState* core)
     Rectangle2D screenRect = {0};
     screenRect.min = MakeVector2(0.0f, 0.0f);
     screenRect.max = MakeVector2(1600.0f, 1200.0f);
-    RandomSeries randomSeries = {12345};
 
-    for (u32 i = 0; i < 500; i++)
-    {
-        gfxStartGeometryBatch(&gameState->geometryBuffer);
-        rcmdSetQuadMaterial(&gameState->commandBuffer, gameState->whiteTexture.id, gameState->linearSampler, DefaultColor_White);
+    mmConcurrentStackReset(&gameState->pathArena);
 
-        u32 color = (u32)((f64)RandomUnilateral(&randomSeries) * u32_Max);
+    time = ProfileEnd(gameState, FrameProfileStage_CommandRecording, time);
 
-        for (u32 i = 0; i < 50; i++)
+    u32 recordedSlicesCount = 0;
+    u32 retainedVerticesCount = 0;
+    for (u32 i = 0; i < ScenePathSlicesCount; i++)
+    {
+        ScenePathSlice* slice = gameState->pathSlices + i;
+        slice->retainedKey = GetPathSliceKey(gameState, i);
+        slice->retained = gameState->retainGeometry ? gfxFindRetainedGeometry(&gameState->pathCache, slice->retainedKey) : NULL;
+        if (slice->retained == NULL)
         {
-            EmitRandomPoly(&gameState->geometryBuffer, &randomSeries, 100, screenRect, color);
+            gameState->recordedSlices[recordedSlicesCount++] = i;
+        }
+        else
+        {
+            ClearPathSlice(slice);
+            retainedVerticesCount += slice->retained->vertexCount;
         }
-
-        rcmdPushGeometryBatch(&gameState->commandBuffer, &gameState->geometryBuffer, &gameState->projectionTransform);
     }
 
-    for (u32 i = 0; i < 10; i++)
+    core->coreAPI.ParallelFor(recordedSlicesCount, EmitPathSliceJob, gameState);
+
+    // NOTE: Retained before appending, appending merges draws and rewrites the indices of the slice.
+    for (u32 i = 0; gameState->retainGeometry && i < recordedSlicesCount; i++)
     {
-        gfxStartGeometryBatch(&gameState->geometryBuffer);
-        rcmdSetQuadMaterial(&gameState->commandBuffer, gameState->whiteTexture.id, gameState->linearSampler, DefaultColor_White);
+        ScenePathSlice* slice = gameState->pathSlices + gameState->recordedSlices[i];
+        slice->retained = gfxRetainGeometry(&gameState->pathCache, slice->retainedKey, &slice->commandBuffer);
+    }
 
-        u32 color = (u32)((f64)RandomUnilateral(&randomSeries) * u32_Max);
+    time = ProfileEnd(gameState, FrameProfileStage_PathEmission, time);
 
-        for (u32 i = 0; i < 100; i++)
+    u32 verticesCount = 0;
+    u32 segmentsCount = 0;
+    for (u32 i = 0; i < ScenePathSlicesCount; i++)
+    {
+        ScenePathSlice* slice = gameState->pathSlices + i;
+        if (slice->retained != NULL)
         {
-            Vector2 position = MakeVector2(RandomUnilateral(&randomSeries) * screenRect.max.x, RandomUnilateral(&randomSeries) * screenRect.max.y);
-            f32 radius = RandomUnilateral(&randomSeries) * 200.0f;
-            f32 thickness = RandomUnilateral(&randomSeries) * 5.0f + 1.0f;
-
-            EmitCircle(&gameState->geometryBuffer, position, radius, 64, DefaultColor32_White, thickness);
+            rcmdAppendRetainedGeometry(&gameState->commandBuffer, slice->retained);
+            verticesCount += slice->retained->vertexCount;
+        }
+        else
+        {
+            rcmdAppendCommandBuffer(&gameState->commandBuffer, &slice->commandBuffer);
+            verticesCount += slice->geometryBuffer.vertexCount;
         }
 
-        rcmdPushGeometryBatch(&gameState->commandBuffer, &gameState->geometryBuffer, &gameState->projectionTransform);
+        segmentsCount += slice->segmentsCount;
     }
 
-    mmStackSetMark(&gameState->tempStack);
-
-    char32* line = utf8toUtf32Str(gameState->inputText, &gameState->tempStack);
-    u32 lineLength = utf32StringLength(line);
+    time = ProfileEnd(gameState, FrameProfileStage_CommandRecording, time);
 
     TextDrawParams textParams;
     textParams.horzAlignment = 0.0f;
     textParams.vertAlignment = 0.0f;
+    textParams.kerning = gameState->kerning;
 
-    EmitText(gameState, &gameState->geometryBuffer, &gameState->commandBuffer, screenRect, line, lineLength, gameState->textScale, textParams);
+    EmitText(gameState, &gameState->geometryBuffer, &gameState->commandBuffer, screenRect, gameState->inputText, gameState->textScale, textParams, true);
+    time = ProfileBegin(gameState);
 
     Rectangle2D fpsRect = {0};
     fpsRect.min = MakeVector2(50.0f, 0.0f);
     fpsRect.max = MakeVector2(1600.0f, 60.0f);
 
     char buffer[1024];
-    sprintf(buffer, "FPS: %d BATCHES: %d VERTICES: %d LINE SEGS: %d", (int)(1.0f / gameState->core->renderDeltaTime), gameState->commandBuffer.renderCommandsCount, gameState->geometryBuffer.vertexCount, lineSegmentsCount);
-    lineSegmentsCount = 0;
-    line = utf8toUtf32Str(buffer, &gameState->tempStack);
-    lineLength = utf32StringLength(line);
+    sprintf(buffer, "FPS: %d BATCHES: %d VERTICES: %d LINE SEGS: %d", (int)(1.0f / gameState->core->renderDeltaTime), gameState->commandBuffer.renderCommandsCount, verticesCount + gameState->geometryBuffer.vertexCount, segmentsCount);
 
-    EmitText(gameState, &gameState->geometryBuffer, &gameState->commandBuffer, fpsRect, line, lineLength, 25.0f, textParams);
-    mmStackRewind(&gameState->tempStack);
+    time = ProfileEnd(gameState, FrameProfileStage_TextLayout, time);
+    EmitText(gameState, &gameState->geometryBuffer, &gameState->commandBuffer, fpsRect, buffer, 25.0f, textParams, false);
+
+    time = ProfileBegin(gameState);
 
     Rectangle2D imgRect = {0};
     Vector2 imgPosition = MakeVector2(200.0f, 200.0f);
     imgRect.min = imgPosition;
     imgRect.max = v2Add(imgPosition, MakeVector2(400.0f, 400.0f));
-    gfxStartGeometryBatch(&gameState->geometryBuffer);
+    gfxStartGeometryBatch(&gameState->geometryBuffer, GetTexturedVertexFormat(gameState));
+    rcmdSetSortLayer(&gameState->commandBuffer, SceneLayer_Image);
     rcmdSetQuadMaterial(&gameState->commandBuffer, gameState->imageTexture.id, gameState->linearSampler, MakeVector4(0.1f, 0.1f, 0.1f, 1.0f));
     gfxEmitQuadGeometry(&gameState->geometryBuffer, imgRect.min, imgRect.max, MakeVector2(0.0f, 0.0f), MakeVector2(1.0f, 1.0f), DefaultColor32_White);
     rcmdPushGeometryBatch(&gameState->commandBuffer, &gameState->geometryBuffer, &gameState->projectionTransform);
 
+    if (gameState->sortCommands)
+    {
+        rcmdSortCommandBuffer(&gameState->commandBuffer, scratch);
+    }
+
+    time = ProfileEnd(gameState, FrameProfileStage_CommandRecording, time);
+
     core->rendererAPI->ExecuteCommandBuffer(&gameState->commandBuffer);
 
     core->rendererAPI->EndFrame();
 
-    ImVec2 pos = {0.0f, 0.0f};
-    gameState->core->imgui->igInputTextMultiline("Text", gameState->inputText, ArrayCount((gameState->inputText)), pos, 0, 0, 0);
-    gameState->core->imgui->igSliderFloat("TextScale", &gameState->textScale, 20.0f, 100.0f, "Text Scale", 0);
+    ProfileEnd(gameState, FrameProfileStage_Submit, time);
+
+    gfxEndRetainedGeometryFrame(&gameState->pathCache);
+    gfxEndTextLayoutFrame(&gameState->textLayoutCache);
+    mmTrackerEndFrame(&gameState->memoryTracker);
+    ReportGameMemory(gameState);
+
+    if (core->frameProfile != NULL)
+    {
+        FrameProfile* profile = core->frameProfile;
+        profile->verticesCount = gameState->geometryBuffer.vertexCount;
+        profile->retainedVerticesCount = retainedVerticesCount;
+        profile->vertexBytesCount = gfxGetVertexBytesCount(&gameState->geometryBuffer);
+        profile->indicesCount = gameState->geometryBuffer.indexCount;
+        profile->segmentsCount = gameState->geometryBuffer.segmentCount;
+        profile->committedBytes = gameState->commandPages.committedSize + gfxGetGeometryCommittedBytes(&gameState->geometryBuffer);
+        for (u32 i = 0; i < ScenePathSlicesCount; i++)
+        {
+            GeometryBuffer* sliceBuffer = &gameState->pathSlices[i].geometryBuffer;
+            profile->verticesCount += sliceBuffer->vertexCount;
+            profile->vertexBytesCount += gfxGetVertexBytesCount(sliceBuffer);
+            profile->indicesCount += sliceBuffer->indexCount;
+            profile->segmentsCount += sliceBuffer->segmentCount;
+            profile->committedBytes += gameState->pathSlices[i].commandPages.committedSize + gfxGetGeometryCommittedBytes(sliceBuffer);
+        }
+
+        profile->indexBytesCount = (u64)profile->indicesCount * sizeof(u16);
+        profile->commandsCount = gameState->commandBuffer.renderCommandsCount;
+        profile->stackPushesCount = scratch->pushesCount + scratch1->pushesCount - stackPushesCount;
+        profile->stackPushedBytes = scratch->pushedBytes + scratch1->pushedBytes - stackPushedBytes;
+    }
+
+    if (gameState->core->imgui != NULL)
+    {
+        ImVec2 pos = {0.0f, 0.0f};
+        gameState->core->imgui->igInputTextMultiline("Text", gameState->inputText, ArrayCount((gameState->inputText)), pos, 0, 0, 0);
+        gameState->core->imgui->igSliderFloat("TextScale", &gameState->textScale, 20.0f, 100.0f, "Text Scale", 0);
+
+        int pathMode = (int)gameState->pathMode;
+        gameState->core->imgui->igCombo_Str_arr("Path Mode", &pathMode, ScenePathModeNames, ScenePathMode_Count, -1);
+        gameState->pathMode = (ScenePathMode)pathMode;
+
+        bool mergeCommands = gameState->commandBuffer.mergeCommands;
+        gameState->core->imgui->igCheckbox("Merge Batches", &mergeCommands);
+        gameState->commandBuffer.mergeCommands = mergeCommands;
+
+        bool sortCommands = gameState->sortCommands;
+        gameState->core->imgui->igCheckbox("Sort Commands", &sortCommands);
+        gameState->sortCommands = sortCommands;
+
+        bool retainGeometry = gameState->retainGeometry;
+        gameState->core->imgui->igCheckbox("Retain Geometry", &retainGeometry);
+        gameState->retainGeometry = retainGeometry;
+
+        bool kerning = gameState->kerning;
+        gameState->core->imgui->igCheckbox("Kerning", &kerning);
+        gameState->kerning = kerning;
+
+        ShowMemoryWindow(gameState);
+    }
 }
 
 #include "core/Memory.c"
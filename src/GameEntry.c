@@ -43,8 +43,11 @@ GAME_CODE_ENTRY void __cdecl GameUpdateAndRender(CoreState* core, GameInvoke com
 
         //Reflection_Init(&allocator);
 
-        IMGUI_CHECKVERSION(core->imgui);
-        core->imgui->igSetCurrentContext(core->imguiContext);
+        if (core->imgui != NULL)
+        {
+            IMGUI_CHECKVERSION(core->imgui);
+            core->imgui->igSetCurrentContext(core->imguiContext);
+        }
 
         GameInit(core);
     } break;
@@ -155,6 +155,16 @@ inline f32 fCos(f32 a)
     return cosf(a);
 }
 
+inline f32 fAcos(f32 a)
+{
+    return acosf(a);
+}
+
+inline f32 fSqrt(f32 a)
+{
+    return sqrtf(a);
+}
+
 inline f64 dFloor(f64 a)
 {
     return floor(a);
@@ -230,6 +240,16 @@ inline Vector2 v2Hadamard(Vector2 a, Vector2 b)
     return result;
 }
 
+inline f32 v2Dot(Vector2 a, Vector2 b)
+{
+    return a.x * b.x + a.y * b.y;
+}
+
+inline f32 v2Cross(Vector2 a, Vector2 b)
+{
+    return a.x * b.y - a.y * b.x;
+}
+
 inline Matrix4x4 MakeMatrix4x4()
 {
     Matrix4x4 m = {0};
@@ -2,20 +2,444 @@
 
 #include <utf8/utf8.h>
 
+// NOTE: Once the pointer is 16 byte aligned the loads can read past the terminator, an aligned load never
+// crosses into the next page.
 u32 utf32StringLength(const char32* string)
 {
+    const char32* at = string;
+    while (((uptr)at & 15) != 0)
+    {
+        if (*at == 0)
+        {
+            return (u32)(at - string);
+        }
+
+        at++;
+    }
+
+    __m128i zero = _mm_setzero_si128();
+    while (true)
+    {
+        u32 mask = (u32)_mm_movemask_epi8(_mm_cmpeq_epi32(_mm_load_si128((const __m128i*)at), zero));
+        if (mask != 0)
+        {
+            return (u32)(at - string) + CountTrailingZeros32(mask) / sizeof(char32);
+        }
+
+        at += 4;
+    }
+}
+
+bool asciiStringEquals(const char* a, const char* b)
+{
+    while (*a != 0 && *a == *b)
+    {
+        a++;
+        b++;
+    }
+
+    return *a == *b;
+}
+
+// NOTE: Number of bytes before the first byte with the high bit set.
+u32 utf8AsciiPrefixLength(const char* data, u32 size)
+{
+    if (size == 0 || (data[0] & 0x80) != 0)
+    {
+        return 0;
+    }
+
+    u32 length = 0;
+    while (length + 16 <= size)
+    {
+        u32 mask = (u32)_mm_movemask_epi8(_mm_loadu_si128((const __m128i*)(data + length)));
+        if (mask != 0)
+        {
+            return length + CountTrailingZeros32(mask);
+        }
+
+        length += 16;
+    }
+
+    while (length < size && (data[length] & 0x80) == 0)
+    {
+        length++;
+    }
+
+    return length;
+}
+
+// NOTE: Decodes one codepoint from at most size bytes and returns how many bytes it took. Invalid, overlong
+// and truncated sequences decode to U+FFFD and take one byte, so the caller always makes progress.
+u32 utf8DecodeCodepoint(const char* data, u32 size, char32* outCodepoint)
+{
+    const byte* bytes = (const byte*)data;
+    byte lead = bytes[0];
+
+    u32 length = 0;
+    char32 codepoint = 0;
+    char32 minCodepoint = 0;
+    if (lead < 0x80)
+    {
+        *outCodepoint = lead;
+        return 1;
+    }
+    else if ((lead & 0xe0) == 0xc0)
+    {
+        length = 2;
+        codepoint = lead & 0x1f;
+        minCodepoint = 0x80;
+    }
+    else if ((lead & 0xf0) == 0xe0)
+    {
+        length = 3;
+        codepoint = lead & 0x0f;
+        minCodepoint = 0x800;
+    }
+    else if ((lead & 0xf8) == 0xf0)
+    {
+        length = 4;
+        codepoint = lead & 0x07;
+        minCodepoint = 0x10000;
+    }
+
+    bool valid = length != 0 && length <= size;
+    for (u32 i = 1; valid && i < length; i++)
+    {
+        valid = (bytes[i] & 0xc0) == 0x80;
+        codepoint = (codepoint << 6) | (bytes[i] & 0x3f);
+    }
+
+    valid = valid && codepoint >= minCodepoint && codepoint <= 0x10ffff && (codepoint < 0xd800 || codepoint > 0xdfff);
+    if (!valid)
+    {
+        *outCodepoint = 0xfffd;
+        return 1;
+    }
+
+    *outCodepoint = codepoint;
+    return length;
+}
+
+// NOTE: Codepoints which can not be encoded are written as U+FFFD.
+u32 utf8EncodeCodepoint(char32 codepoint, char* out)
+{
+    byte* bytes = (byte*)out;
+    if (codepoint < 0x80)
+    {
+        bytes[0] = (byte)codepoint;
+        return 1;
+    }
+    else if (codepoint < 0x800)
+    {
+        bytes[0] = (byte)(0xc0 | (codepoint >> 6));
+        bytes[1] = (byte)(0x80 | (codepoint & 0x3f));
+        return 2;
+    }
+    else if (codepoint > 0x10ffff || (codepoint >= 0xd800 && codepoint <= 0xdfff))
+    {
+        codepoint = 0xfffd;
+    }
+
+    if (codepoint < 0x10000)
+    {
+        bytes[0] = (byte)(0xe0 | (codepoint >> 12));
+        bytes[1] = (byte)(0x80 | ((codepoint >> 6) & 0x3f));
+        bytes[2] = (byte)(0x80 | (codepoint & 0x3f));
+        return 3;
+    }
+
+    bytes[0] = (byte)(0xf0 | (codepoint >> 18));
+    bytes[1] = (byte)(0x80 | ((codepoint >> 12) & 0x3f));
+    bytes[2] = (byte)(0x80 | ((codepoint >> 6) & 0x3f));
+    bytes[3] = (byte)(0x80 | (codepoint & 0x3f));
+    return 4;
+}
+
+u32 utf8EncodedSize(char32 codepoint)
+{
+    if (codepoint < 0x80)
+    {
+        return 1;
+    }
+    else if (codepoint < 0x800)
+    {
+        return 2;
+    }
+
+    return codepoint >= 0x10000 && codepoint <= 0x10ffff ? 4 : 3;
+}
+
+// NOTE: Blocks of 16 ASCII bytes are widened to 16 codepoints at once, other blocks go through
+// utf8DecodeCodepoint. Returns the number of codepoints written, out needs room for one per byte.
+u32 utf8ToUtf32(const char* data, u32 size, char32* out)
+{
+    u32 offset = 0;
     u32 count = 0;
-    while (string[count] != 0) count++;
+    while (offset < size)
+    {
+        if (offset + 16 <= size)
+        {
+            __m128i bytes = _mm_loadu_si128((const __m128i*)(data + offset));
+            u32 mask = (u32)_mm_movemask_epi8(bytes);
+            if (mask == 0)
+            {
+                _mm_storeu_si128((__m128i*)(out + count + 0), _mm_cvtepu8_epi32(bytes));
+                _mm_storeu_si128((__m128i*)(out + count + 4), _mm_cvtepu8_epi32(_mm_srli_si128(bytes, 4)));
+                _mm_storeu_si128((__m128i*)(out + count + 8), _mm_cvtepu8_epi32(_mm_srli_si128(bytes, 8)));
+                _mm_storeu_si128((__m128i*)(out + count + 12), _mm_cvtepu8_epi32(_mm_srli_si128(bytes, 12)));
+                offset += 16;
+                count += 16;
+                continue;
+            }
+
+            // NOTE: The rest of the block goes one codepoint at a time, mixed text rarely has a whole ASCII block.
+            for (u32 blockEnd = offset + 16; offset < blockEnd; count++)
+            {
+                byte lead = (byte)data[offset];
+                if (lead < 0x80)
+                {
+                    out[count] = lead;
+                    offset++;
+                }
+                else if (lead >= 0xc2 && lead < 0xe0 && offset + 1 < size && ((byte)data[offset + 1] & 0xc0) == 0x80)
+                {
+                    out[count] = ((char32)(lead & 0x1f) << 6) | ((byte)data[offset + 1] & 0x3f);
+                    offset += 2;
+                }
+                else
+                {
+                    offset += utf8DecodeCodepoint(data + offset, size - offset, out + count);
+                }
+            }
+
+            continue;
+        }
+
+        offset += utf8DecodeCodepoint(data + offset, size - offset, out + count);
+        count++;
+    }
+
     return count;
 }
 
+// NOTE: Blocks of 16 ASCII codepoints are narrowed with saturating packs, other blocks are encoded one
+// codepoint at a time. Returns the number of bytes written, out needs room for utf8EncodedSize of each.
+u32 utf32ToUtf8(const char32* data, u32 count, char* out)
+{
+    __m128i nonAscii = _mm_set1_epi32(~0x7f);
+
+    u32 index = 0;
+    u32 size = 0;
+    while (index < count)
+    {
+        if (index + 16 <= count)
+        {
+            __m128i a = _mm_loadu_si128((const __m128i*)(data + index + 0));
+            __m128i b = _mm_loadu_si128((const __m128i*)(data + index + 4));
+            __m128i c = _mm_loadu_si128((const __m128i*)(data + index + 8));
+            __m128i d = _mm_loadu_si128((const __m128i*)(data + index + 12));
+            __m128i all = _mm_or_si128(_mm_or_si128(a, b), _mm_or_si128(c, d));
+            if (_mm_testz_si128(all, nonAscii))
+            {
+                __m128i bytes = _mm_packus_epi16(_mm_packus_epi32(a, b), _mm_packus_epi32(c, d));
+                _mm_storeu_si128((__m128i*)(out + size), bytes);
+                index += 16;
+                size += 16;
+                continue;
+            }
+
+            for (u32 blockEnd = index + 16; index < blockEnd; index++)
+            {
+                char32 codepoint = data[index];
+                if (codepoint < 0x80)
+                {
+                    out[size++] = (char)codepoint;
+                }
+                else if (codepoint < 0x800)
+                {
+                    out[size++] = (char)(0xc0 | (codepoint >> 6));
+                    out[size++] = (char)(0x80 | (codepoint & 0x3f));
+                }
+                else
+                {
+                    size += utf8EncodeCodepoint(codepoint, out + size);
+                }
+            }
+
+            continue;
+        }
+
+        size += utf8EncodeCodepoint(data[index], out + size);
+        index++;
+    }
+
+    return size;
+}
+
 u32 asciiStringLength(const char* string)
 {
+    const char* at = string;
+    while (((uptr)at & 15) != 0)
+    {
+        if (*at == 0)
+        {
+            return (u32)(at - string);
+        }
+
+        at++;
+    }
+
+    __m128i zero = _mm_setzero_si128();
+    while (true)
+    {
+        u32 mask = (u32)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_load_si128((const __m128i*)at), zero));
+        if (mask != 0)
+        {
+            return (u32)(at - string) + CountTrailingZeros32(mask);
+        }
+
+        at += 16;
+    }
+}
+
+// NOTE: Every byte which is not a continuation byte (10xxxxxx) starts a codepoint. Continuation bytes are
+// the only ones below -64 as signed bytes, per-lane counters are summed before they can overflow.
+u32 utf8CodepointsCount(const char* data, u32 size)
+{
+    __m128i zero = _mm_setzero_si128();
+    __m128i lastContinuation = _mm_set1_epi8(-65);
+
     u32 count = 0;
-    while (string[count] != 0) count++;
+    u32 offset = 0;
+    while (offset + 16 <= size)
+    {
+        __m128i counters = zero;
+        for (u32 blocks = 0; blocks < 255 && offset + 16 <= size; blocks++, offset += 16)
+        {
+            __m128i bytes = _mm_loadu_si128((const __m128i*)(data + offset));
+            counters = _mm_sub_epi8(counters, _mm_cmpgt_epi8(bytes, lastContinuation));
+        }
+
+        __m128i sums = _mm_sad_epu8(counters, zero);
+        count += (u32)_mm_cvtsi128_si32(sums) + (u32)_mm_extract_epi16(sums, 4);
+    }
+
+    for (; offset < size; offset++)
+    {
+        count += (i8)data[offset] > -65 ? 1 : 0;
+    }
+
     return count;
 }
 
+#define Utf8TooShort (1 << 0)
+#define Utf8TooLong (1 << 1)
+#define Utf8Overlong3 (1 << 2)
+#define Utf8TooLarge (1 << 3)
+#define Utf8Surrogate (1 << 4)
+#define Utf8Overlong2 (1 << 5)
+#define Utf8TooLarge1000 (1 << 6)
+#define Utf8Overlong4 (1 << 6)
+#define Utf8TwoContinuations (1 << 7)
+#define Utf8Carry (Utf8TooShort | Utf8TooLong | Utf8TwoContinuations)
+
+static inline __m128i utf8HighNibblesInternal(__m128i bytes)
+{
+    return _mm_and_si128(_mm_srli_epi16(bytes, 4), _mm_set1_epi8(0x0f));
+}
+
+// NOTE: Keiser and Lemire's lookup validator. Every error is a property of a byte together with the byte
+// before it, three 16 entry tables classify the pair by nibbles and any bit set in all three is an error.
+// Continuations required by a 3 or 4 byte lead two or three bytes back are checked separately.
+static inline __m128i utf8CheckBlockInternal(__m128i input, __m128i previousInput)
+{
+    __m128i previous1 = _mm_alignr_epi8(input, previousInput, 15);
+    __m128i byte1High = _mm_shuffle_epi8(_mm_setr_epi8(
+        Utf8TooLong, Utf8TooLong, Utf8TooLong, Utf8TooLong,
+        Utf8TooLong, Utf8TooLong, Utf8TooLong, Utf8TooLong,
+        Utf8TwoContinuations, Utf8TwoContinuations, Utf8TwoContinuations, Utf8TwoContinuations,
+        Utf8TooShort | Utf8Overlong2,
+        Utf8TooShort,
+        Utf8TooShort | Utf8Overlong3 | Utf8Surrogate,
+        Utf8TooShort | Utf8TooLarge | Utf8TooLarge1000 | Utf8Overlong4), utf8HighNibblesInternal(previous1));
+    __m128i byte1Low = _mm_shuffle_epi8(_mm_setr_epi8(
+        Utf8Carry | Utf8Overlong3 | Utf8Overlong2 | Utf8Overlong4,
+        Utf8Carry | Utf8Overlong2,
+        Utf8Carry,
+        Utf8Carry,
+        Utf8Carry | Utf8TooLarge,
+        Utf8Carry | Utf8TooLarge | Utf8TooLarge1000,
+        Utf8Carry | Utf8TooLarge | Utf8TooLarge1000,
+        Utf8Carry | Utf8TooLarge | Utf8TooLarge1000,
+        Utf8Carry | Utf8TooLarge | Utf8TooLarge1000,
+        Utf8Carry | Utf8TooLarge | Utf8TooLarge1000,
+        Utf8Carry | Utf8TooLarge | Utf8TooLarge1000,
+        Utf8Carry | Utf8TooLarge | Utf8TooLarge1000,
+        Utf8Carry | Utf8TooLarge | Utf8TooLarge1000,
+        Utf8Carry | Utf8TooLarge | Utf8TooLarge1000 | Utf8Surrogate,
+        Utf8Carry | Utf8TooLarge | Utf8TooLarge1000,
+        Utf8Carry | Utf8TooLarge | Utf8TooLarge1000), _mm_and_si128(previous1, _mm_set1_epi8(0x0f)));
+    __m128i byte2High = _mm_shuffle_epi8(_mm_setr_epi8(
+        Utf8TooShort, Utf8TooShort, Utf8TooShort, Utf8TooShort,
+        Utf8TooShort, Utf8TooShort, Utf8TooShort, Utf8TooShort,
+        Utf8TooLong | Utf8Overlong2 | Utf8TwoContinuations | Utf8Overlong3 | Utf8TooLarge1000 | Utf8Overlong4,
+        Utf8TooLong | Utf8Overlong2 | Utf8TwoContinuations | Utf8Overlong3 | Utf8TooLarge,
+        Utf8TooLong | Utf8Overlong2 | Utf8TwoContinuations | Utf8Surrogate | Utf8TooLarge,
+        Utf8TooLong | Utf8Overlong2 | Utf8TwoContinuations | Utf8Surrogate | Utf8TooLarge,
+        Utf8TooShort, Utf8TooShort, Utf8TooShort, Utf8TooShort), utf8HighNibblesInternal(input));
+    __m128i specialCases = _mm_and_si128(_mm_and_si128(byte1High, byte1Low), byte2High);
+
+    __m128i previous2 = _mm_alignr_epi8(input, previousInput, 14);
+    __m128i previous3 = _mm_alignr_epi8(input, previousInput, 13);
+    __m128i isThirdByte = _mm_subs_epu8(previous2, _mm_set1_epi8((char)(0xe0 - 0x80)));
+    __m128i isFourthByte = _mm_subs_epu8(previous3, _mm_set1_epi8((char)(0xf0 - 0x80)));
+    __m128i mustBeContinuation = _mm_and_si128(_mm_or_si128(isThirdByte, isFourthByte), _mm_set1_epi8((char)0x80));
+
+    return _mm_xor_si128(mustBeContinuation, specialCases);
+}
+
+// NOTE: The tail is copied into a zeroed block, a sequence cut short by the end of the data is then followed
+// by an ASCII zero and reported like any other truncated sequence.
+bool utf8Validate(const char* data, u32 size)
+{
+    __m128i error = _mm_setzero_si128();
+    __m128i previousInput = _mm_setzero_si128();
+    __m128i previousIncomplete = _mm_setzero_si128();
+    __m128i incompleteLimit = _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+                                            (char)(0xf0 - 1), (char)(0xe0 - 1), (char)(0xc0 - 1));
+
+    for (u32 offset = 0; offset < size; offset += 16)
+    {
+        __m128i input;
+        if (offset + 16 <= size)
+        {
+            input = _mm_loadu_si128((const __m128i*)(data + offset));
+        }
+        else
+        {
+            byte tail[16] = {0};
+            mmCopy(tail, data + offset, size - offset);
+            input = _mm_loadu_si128((const __m128i*)tail);
+        }
+
+        if (_mm_movemask_epi8(input) == 0)
+        {
+            error = _mm_or_si128(error, previousIncomplete);
+        }
+        else
+        {
+            error = _mm_or_si128(error, utf8CheckBlockInternal(input, previousInput));
+            previousIncomplete = _mm_subs_epu8(input, incompleteLimit);
+        }
+
+        previousInput = input;
+    }
+
+    error = _mm_or_si128(error, previousIncomplete);
+    return _mm_testz_si128(error, error) != 0;
+}
+
 char32* utf32Extract(const char32* string, u32 count, MemoryStack* stack)
 {
     char32* newStr = mmStackPush(stack, sizeof(char32) * (count + 1));
@@ -39,76 +463,40 @@ bool utf32OneOf(char32 c, const char32* chars)
     return false;
 }
 
+// NOTE: Valid input is sized exactly, invalid input decodes to at most one codepoint per byte.
 char32* utf8toUtf32Str(const char* utf8str, MemoryStack* stack)
 {
-    uptr numCodepoints = utf8len(utf8str) + 1;
-    char32* utf32str = mmStackPush(stack, sizeof(char32) * numCodepoints);
-    char32* utf32ptr = utf32str;
-    while (true)
-    {
-        utf8str = utf8codepoint(utf8str, utf32ptr);
-        if (*utf32ptr == 0)
-        {
-            break;
-        }
+    u32 size = asciiStringLength(utf8str);
+    u32 capacity = utf8Validate(utf8str, size) ? utf8CodepointsCount(utf8str, size) : size;
 
-        utf32ptr++;
-    }
+    char32* utf32str = mmStackPush(stack, sizeof(char32) * (capacity + 1));
+    u32 count = utf8ToUtf32(utf8str, size, utf32str);
+    Assert(count <= capacity);
+    utf32str[count] = 0;
 
     return utf32str;
 }
 
 char* utf32toUtf8Str(const char32* utf32str, MemoryStack* stack)
 {
-    uptr bufferSize = 1;
-    const char32* at = utf32str;
-    while (*at != 0)
-    {
-        bufferSize += utf8codepointsize(*at);
-        at++;
-    }
-
-    char* utf8Str = mmStackPush(stack, bufferSize);
-    char* ptr = utf8Str;
-
-    at = utf32str;
-    while (true)
-    {
-        ptr = utf8catcodepoint(ptr, *at, (uptr)bufferSize - ((uptr)ptr - (uptr)utf8Str));
-        Assert(ptr != NULL);
-
-        if (*at == 0)
-        {
-            break;
-        }
-
-        at++;
-    }
-
-    return utf8Str;
+    return utf32toUtf8StrCounted(utf32str, utf32StringLength(utf32str), stack);
 }
 
-#if false // bugy
 char* utf32toUtf8StrCounted(const char32* utf32str, u32 count, MemoryStack* stack)
 {
-    uptr bufferSize = 0;
+    uptr bufferSize = 1;
     for (u32 i = 0; i < count; i++)
     {
-        bufferSize += utf8codepointsize(utf32str[i]);
+        bufferSize += utf8EncodedSize(utf32str[i]);
     }
 
     char* utf8Str = mmStackPush(stack, bufferSize);
-    char* ptr = utf8Str;
-
-    for (u32 i = 0; i < count; i++)
-    {
-        ptr = utf8catcodepoint(ptr, utf32str[i], (uptr)bufferSize - ((uptr)ptr - (uptr)utf8Str));
-        Assert(ptr != NULL);
-    }
+    u32 size = utf32ToUtf8(utf32str, count, utf8Str);
+    Assert(size + 1 == bufferSize);
+    utf8Str[size] = 0;
 
     return utf8Str;
 }
-#endif
 
 bool utf8PrettySize(char* buffer, u32 bufferSize, uptr bytes)
 {
@@ -1,7 +1,7 @@
 #pragma once
 
-#include "Core/Common.h"
-#include "Memory.h"
+#include "core/Common.h"
+#include "core/Memory.h"
 
 // UTF-32
 u32 utf32StringLength(const char32* string);
@@ -13,9 +13,19 @@ bool utf8PrettySize(char* buffer, u32 bufferSize, uptr bytes);
 char* utf8NullTreminate(const char* str, u32 count, MemoryStack* stack);
 char* utf8CopyString(const char* str, MemoryStack* stack);
 
+u32 utf8AsciiPrefixLength(const char* data, u32 size);
+u32 utf8DecodeCodepoint(const char* data, u32 size, char32* outCodepoint);
+u32 utf8EncodeCodepoint(char32 codepoint, char* out);
+u32 utf8EncodedSize(char32 codepoint);
+u32 utf8CodepointsCount(const char* data, u32 size);
+bool utf8Validate(const char* data, u32 size);
+
 u32 asciiStringLength(const char* string);
+bool asciiStringEquals(const char* a, const char* b);
 
 // Conversion
+u32 utf8ToUtf32(const char* data, u32 size, char32* out);
+u32 utf32ToUtf8(const char32* data, u32 count, char* out);
 char32* utf8toUtf32Str(const char* utf8str, MemoryStack* stack);
 char* utf32toUtf8Str(const char32* utf32str, MemoryStack* stack);
 char* utf32toUtf8StrCounted(const char32* utf32str, u32 count, MemoryStack* stack);
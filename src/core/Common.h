@@ -8,20 +8,38 @@
 #include <memory.h>
 #include <uchar.h>
 
-#define _ThreadLocal __declspec(thread)
-
 #define __Concat(x,y) x##y
 #define Concat(x,y) __Concat(x,y)
 
 #if defined(_MSC_VER)
 
+#include <intrin.h>
+
 #define COMPILER_MSVC
 #define BreakDebug() __debugbreak()
+#define _ThreadLocal __declspec(thread)
+// NOTE: Returns the value before the addition.
+#define AtomicFetchAddUptr(dest, value) ((uptr)_InterlockedExchangeAdd64((volatile long long*)(dest), (long long)(value)))
+// NOTE: Undefined for 0.
+static __forceinline unsigned int CountTrailingZeros32(unsigned int value) { unsigned long index; _BitScanForward(&index, value); return (unsigned int)index; }
 
 #elif defined(__clang__)
 
 #define COMPILER_CLANG
 #define BreakDebug() __builtin_debugtrap()
+#define _ThreadLocal __declspec(thread)
+#define AtomicFetchAddUptr(dest, value) __atomic_fetch_add((dest), (value), __ATOMIC_RELAXED)
+#define CountTrailingZeros32(value) ((unsigned int)__builtin_ctz(value))
+
+#elif defined(__GNUC__)
+
+#define COMPILER_GCC
+#define BreakDebug() __builtin_trap()
+#define _ThreadLocal __thread
+#define AtomicFetchAddUptr(dest, value) __atomic_fetch_add((dest), (value), __ATOMIC_RELAXED)
+#define CountTrailingZeros32(value) ((unsigned int)__builtin_ctz(value))
+// NOTE: Calling convention annotations are meaningless on x64 SysV.
+#define __cdecl
 
 #else
 #error Unsupported compiler
@@ -4,6 +4,7 @@
 #include "Array.h"
 //#include "../Intrinsics.h"
 #include "CoreUtilities.h"
+#include "CoreJobs.h"
 
 #include <errno.h>
 
@@ -390,9 +391,21 @@ void CoreInit(CoreContext *context, const char *windowName, GameUpdateAndRenderF
     context->state.coreAPI.HeapFree = coreHeapFree;
 
     context->state.coreAPI.AllocatePages = PlatformAllocatePages;
+    context->state.coreAPI.ReservePages = PlatformReservePages;
+    context->state.coreAPI.CommitPages = PlatformCommitPages;
+    context->state.coreAPI.DecommitPages = PlatformDecommitPages;
 
     context->state.coreAPI.SetParameter = CoreSetParameter;
     context->state.coreAPI.WriteLog = CoreWriteLog;
+    context->state.coreAPI.GetTimestamp = CoreGetTimeStamp;
+
+    CoreInitJobs(0);
+    context->state.coreAPI.GetJobThreadsCount = CoreGetJobThreadsCount;
+    context->state.coreAPI.CreateJob = CoreCreateJob;
+    context->state.coreAPI.RunJob = CoreRunJob;
+    context->state.coreAPI.WaitForJob = CoreWaitForJob;
+    context->state.coreAPI.GetScratchStack = CoreGetScratchStack;
+    context->state.coreAPI.ParallelFor = CoreParallelFor;
 
     DisplayParams displayParams{};
     displayParams.width = 1920;
@@ -486,6 +499,8 @@ void CoreMainLoopRender(CoreContext *context, f32 lag)
     // If framerate lower than 15 fps just clamping delta time
     auto deltaTime = (f32)Clamp(frameTime, 0.0, 0.066);
 
+    CoreResetJobsFrame();
+
     context->state.frameCount++;
     context->state.renderDeltaTime = deltaTime;
     context->state.renderLag = lag;
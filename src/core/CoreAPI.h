@@ -6,13 +6,15 @@
 // (including OpenGL calls) and other necessary stuff such as current input state.
 
 #include "Common.h"
+#include "Memory.h"
 #include "../renderer/RendererAPI.h"
 #include "../ImGui/ImGuiApi.h"
 
 #if defined(PLATFORM_WINDOWS)
 #define GAME_CODE_ENTRY __declspec(dllexport)
 #elif defined(PLATFORM_LINUX)
-#define GAME_CODE_ENTRY
+#define GAME_CODE_ENTRY __attribute__((visibility("default")))
+#else
 #error Unsupported OS
 #endif
 
@@ -55,14 +57,16 @@ typedef struct
 
 inline CoreParameterData CreateCoreParameter(CoreParameter p)
 {
-    CoreParameterData data = {0};
+    CoreParameterData data;
+    memset(&data, 0, sizeof(data));
     data.param = p;
     return data;
 }
 
 inline CoreParameterData CreateCoreParameter_VSync(VSyncMode mode)
 {
-    CoreParameterData data = {0};
+    CoreParameterData data;
+    memset(&data, 0, sizeof(data));
     data.param = CoreParameter_VSync;
     data.vsync = mode;
     return data;
@@ -70,7 +74,8 @@ inline CoreParameterData CreateCoreParameter_VSync(VSyncMode mode)
 
 inline CoreParameterData CreateCoreParameter_DisplayMode(DisplayMode mode)
 {
-    CoreParameterData data = {0};
+    CoreParameterData data;
+    memset(&data, 0, sizeof(data));
     data.param = CoreParameter_DisplayMode;
     data.displayMode = mode;
     return data;
@@ -78,7 +83,8 @@ inline CoreParameterData CreateCoreParameter_DisplayMode(DisplayMode mode)
 
 inline CoreParameterData CreateCoreParameter_DisplayParams(DisplayParams params)
 {
-    CoreParameterData data = {0};
+    CoreParameterData data;
+    memset(&data, 0, sizeof(data));
     data.param = CoreParameter_DisplayParams;
     data.displayParams = params;
     return data;
@@ -100,6 +106,12 @@ typedef struct
     uptr pageSize;
 } PagesAllocationResult;
 
+// NOTE: threadIndex is in [0, GetJobThreadsCount()), the main thread is 0.
+typedef void(CoreParallelForFn)(void* data, u32 index, u32 threadIndex);
+typedef void(CoreJobFn)(void* data, u32 threadIndex);
+
+typedef struct CoreJob* CoreJobHandle;
+
 typedef struct
 {
     FileHandle(*OpenFile)(const char* filename, OpenFileMode mode);
@@ -114,12 +126,65 @@ typedef struct
     void(*HeapFree)(struct MemoryHeap* heap, void* ptr);
 
     PagesAllocationResult(*AllocatePages)(uptr desiredSize);
+    // NOTE: Reserved pages are not accessible until committed. Commit and decommit take page aligned ranges.
+    PagesAllocationResult(*ReservePages)(uptr desiredSize);
+    b32(*CommitPages)(void* memory, uptr size);
+    void(*DecommitPages)(void* memory, uptr size);
 
     void(*SetParameter)(const CoreParameterData* param);
 
     void(*WriteLog)(CoreLogLevel logLevel, const char* tags, u32 tagsCount, const char* format, va_list vlist);
+
+    // NOTE: Seconds from an arbitrary point, monotonic.
+    f64(*GetTimestamp)();
+
+    // NOTE: Jobs may only be created and waited on from the main thread and from inside other jobs.
+    // A job is not finished until all of its children are, fn may be NULL for a job which only groups children.
+    // Handles are valid until the end of the frame. CreateJob returns NULL once the calling thread has used
+    // all of its job slots for the frame, do the work inline then. RunJob and WaitForJob ignore NULL.
+    u32(*GetJobThreadsCount)();
+    CoreJobHandle(*CreateJob)(CoreJobFn* fn, void* data, CoreJobHandle parent);
+    void(*RunJob)(CoreJobHandle job);
+    // Runs other queued jobs on the calling thread until the job and its children are finished.
+    void(*WaitForJob)(CoreJobHandle job);
+    // Calls fn for every index in [0, count) on the worker pool, returns when all of them are done.
+    void(*ParallelFor)(u32 count, CoreParallelForFn* fn, void* data);
+
+    // NOTE: Every job thread owns two scratch stacks which the core rewinds at the start of each frame.
+    // Returns the one which is not conflict, so scratch memory can be used while building results
+    // in the other one. Pushes are not synchronized, the stack must not leave the calling thread.
+    MemoryStack*(*GetScratchStack)(MemoryStack* conflict);
 } CoreAPI;
 
+typedef enum
+{
+    FrameProfileStage_PathEmission,
+    FrameProfileStage_TextLayout,
+    FrameProfileStage_CommandRecording,
+    FrameProfileStage_Submit,
+
+    FrameProfileStage_Count
+} FrameProfileStage;
+
+// NOTE: Filled by game code during GameInvoke_Render when the platform layer provides it.
+// Times are in seconds, allocation counters are deltas over the frame.
+typedef struct
+{
+    f64 stageTimes[FrameProfileStage_Count];
+    // NOTE: Vertices generated this frame, retained geometry which was only resubmitted is counted separately.
+    u64 verticesCount;
+    u64 retainedVerticesCount;
+    u64 vertexBytesCount;
+    u64 indicesCount;
+    u64 indexBytesCount;
+    u64 segmentsCount;
+    u64 commandsCount;
+    u64 stackPushesCount;
+    u64 stackPushedBytes;
+    // NOTE: Pages committed by the growable frame buffers.
+    u64 committedBytes;
+} FrameProfile;
+
 typedef struct
 {
     u8 pressedNow;
@@ -155,11 +220,19 @@ typedef struct _CoreState
     CoreAPI coreAPI;
     RendererAPI* rendererAPI;
 
+    // NOTE: NULL when running headless.
     ImGuiContext* imguiContext;
     ImGuiApi* imgui;
 
     InputState input;
 
+    // NOTE: NULL unless the platform layer is benchmarking.
+    FrameProfile* frameProfile;
+
+    // NOTE: Command line of the platform executable, argv[0] included. Empty when there is none.
+    u32 commandLineArgsCount;
+    char** commandLineArgs;
+
     u64 tickCount;
     u64 frameCount;
     f32 updateAbsDeltaTime;
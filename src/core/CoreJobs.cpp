@@ -0,0 +1,389 @@
+#include "CoreJobs.h"
+#include "CoreUtilities.h"
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+// NOTE: Jobs are allocated linearly per thread and recycled at frame boundaries, so a handle never aliases
+// a newer job within a frame. A thread which runs out of slots gets NULL from CoreCreateJob, a full queue
+// runs the job inline. Queues have the same capacity.
+#define CoreJobsPerThread (4096)
+#define CoreScratchStackSize (Megabytes(32))
+
+struct CoreJob
+{
+    CoreJobFn* fn;
+    void* data;
+    CoreJob* parent;
+    std::atomic<u32> unfinishedJobs;
+};
+
+struct CoreJobQueue
+{
+    std::mutex mutex;
+    CoreJob* jobs[CoreJobsPerThread];
+    u32 top;
+    u32 bottom;
+};
+
+struct CoreJobWorker
+{
+    CoreJobQueue queue;
+    CoreJob* jobs;
+    u32 jobsAllocated;
+    MemoryStack scratchStacks[2];
+};
+
+struct CoreJobPool
+{
+    std::thread* threads;
+    CoreJobWorker* workers;
+    u32 threadsCount;
+
+    std::mutex mutex;
+    std::condition_variable wakeCondition;
+    std::atomic<u32> queuedJobs;
+    b32 shutdown;
+};
+
+static CoreJobPool GlobalJobPool;
+static thread_local u32 CoreJobThreadIndex = u32_Max;
+
+static inline CoreJobWorker* CoreGetJobWorkerInternal()
+{
+    Assert(CoreJobThreadIndex < GlobalJobPool.threadsCount);
+    return GlobalJobPool.workers + CoreJobThreadIndex;
+}
+
+// Owner end of the queue, newest job first.
+static CoreJob* CorePopJobInternal(CoreJobQueue* queue)
+{
+    std::lock_guard<std::mutex> lock(queue->mutex);
+    if (queue->bottom == queue->top)
+    {
+        return NULL;
+    }
+
+    queue->bottom--;
+    return queue->jobs[queue->bottom % CoreJobsPerThread];
+}
+
+// Thief end of the queue, oldest job first.
+static CoreJob* CoreStealJobInternal(CoreJobQueue* queue)
+{
+    std::lock_guard<std::mutex> lock(queue->mutex);
+    if (queue->bottom == queue->top)
+    {
+        return NULL;
+    }
+
+    CoreJob* job = queue->jobs[queue->top % CoreJobsPerThread];
+    queue->top++;
+    return job;
+}
+
+static CoreJob* CoreFindJobInternal(CoreJobPool* pool, u32 threadIndex)
+{
+    if (pool->queuedJobs.load(std::memory_order_acquire) == 0)
+    {
+        return NULL;
+    }
+
+    CoreJob* job = CorePopJobInternal(&pool->workers[threadIndex].queue);
+    for (u32 i = 1; job == NULL && i < pool->threadsCount; i++)
+    {
+        job = CoreStealJobInternal(&pool->workers[(threadIndex + i) % pool->threadsCount].queue);
+    }
+
+    if (job != NULL)
+    {
+        pool->queuedJobs.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    return job;
+}
+
+static void CoreFinishJobInternal(CoreJob* job)
+{
+    while (job != NULL && job->unfinishedJobs.fetch_sub(1, std::memory_order_acq_rel) == 1)
+    {
+        job = job->parent;
+    }
+}
+
+static void CoreExecuteJobInternal(CoreJob* job, u32 threadIndex)
+{
+    if (job->fn != NULL)
+    {
+        job->fn(job->data, threadIndex);
+    }
+
+    CoreFinishJobInternal(job);
+}
+
+static void CoreJobWorkerProc(CoreJobPool* pool, u32 threadIndex)
+{
+    CoreJobThreadIndex = threadIndex;
+    while (true)
+    {
+        CoreJob* job = CoreFindJobInternal(pool, threadIndex);
+        if (job != NULL)
+        {
+            CoreExecuteJobInternal(job, threadIndex);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(pool->mutex);
+        pool->wakeCondition.wait(lock, [&] { return pool->shutdown || pool->queuedJobs.load(std::memory_order_acquire) != 0; });
+        if (pool->shutdown)
+        {
+            return;
+        }
+    }
+}
+
+void CoreInitJobs(u32 threadsCount)
+{
+    CoreJobPool* pool = &GlobalJobPool;
+
+    threadsCount = threadsCount == 0 ? std::thread::hardware_concurrency() : threadsCount;
+    threadsCount = threadsCount == 0 ? 1 : threadsCount;
+
+    pool->threadsCount = threadsCount;
+    pool->workers = new CoreJobWorker[threadsCount];
+    for (u32 i = 0; i < threadsCount; i++)
+    {
+        CoreJobWorker* worker = pool->workers + i;
+        worker->queue.top = 0;
+        worker->queue.bottom = 0;
+        worker->jobs = new CoreJob[CoreJobsPerThread];
+        worker->jobsAllocated = 0;
+
+        // NOTE: Filled in by hand, Memory.c is compiled into the game library only.
+        for (u32 j = 0; j < ArrayCount(worker->scratchStacks); j++)
+        {
+            MemoryStack* stack = worker->scratchStacks + j;
+            *stack = {};
+            stack->memory = PlatformAllocatePages(CoreScratchStackSize).memory;
+            stack->memorySize = CoreScratchStackSize;
+            stack->free = CoreScratchStackSize;
+            stack->failStrategy = AllocationFailedStrategy_Crash;
+            stack->debugTag = j == 0 ? "Scratch Stack 0" : "Scratch Stack 1";
+        }
+    }
+
+    CoreJobThreadIndex = 0;
+    pool->threads = new std::thread[threadsCount > 1 ? threadsCount - 1 : 1];
+    for (u32 i = 1; i < threadsCount; i++)
+    {
+        pool->threads[i - 1] = std::thread(CoreJobWorkerProc, pool, i);
+    }
+}
+
+void CoreShutdownJobs()
+{
+    CoreJobPool* pool = &GlobalJobPool;
+    if (pool->threads == NULL)
+    {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(pool->mutex);
+        pool->shutdown = true;
+    }
+    pool->wakeCondition.notify_all();
+
+    for (u32 i = 1; i < pool->threadsCount; i++)
+    {
+        pool->threads[i - 1].join();
+    }
+
+    for (u32 i = 0; i < pool->threadsCount; i++)
+    {
+        delete[] pool->workers[i].jobs;
+    }
+
+    delete[] pool->threads;
+    delete[] pool->workers;
+    pool->threads = NULL;
+    pool->workers = NULL;
+    pool->threadsCount = 0;
+}
+
+u32 CoreGetJobThreadsCount()
+{
+    return GlobalJobPool.threadsCount > 0 ? GlobalJobPool.threadsCount : 1;
+}
+
+CoreJobHandle CoreCreateJob(CoreJobFn* fn, void* data, CoreJobHandle parent)
+{
+    CoreJobWorker* worker = CoreGetJobWorkerInternal();
+    if (worker->jobsAllocated == CoreJobsPerThread)
+    {
+        return NULL;
+    }
+
+    CoreJob* job = worker->jobs + worker->jobsAllocated++;
+
+    job->fn = fn;
+    job->data = data;
+    job->parent = parent;
+    job->unfinishedJobs.store(1, std::memory_order_relaxed);
+
+    if (parent != NULL)
+    {
+        parent->unfinishedJobs.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    return job;
+}
+
+void CoreRunJob(CoreJobHandle job)
+{
+    if (job == NULL)
+    {
+        return;
+    }
+
+    CoreJobPool* pool = &GlobalJobPool;
+    CoreJobQueue* queue = &CoreGetJobWorkerInternal()->queue;
+
+    b32 queued = false;
+    {
+        std::lock_guard<std::mutex> lock(queue->mutex);
+        if (queue->bottom - queue->top < CoreJobsPerThread)
+        {
+            queue->jobs[queue->bottom % CoreJobsPerThread] = job;
+            queue->bottom++;
+            queued = true;
+        }
+    }
+
+    if (!queued)
+    {
+        // NOTE: Never overwrite queued jobs, the calling thread does the work itself instead.
+        CoreExecuteJobInternal(job, CoreJobThreadIndex);
+        return;
+    }
+
+    pool->queuedJobs.fetch_add(1, std::memory_order_release);
+    if (pool->threadsCount > 1)
+    {
+        // NOTE: Taking the lock orders this with a worker which is about to go to sleep.
+        { std::lock_guard<std::mutex> lock(pool->mutex); }
+        pool->wakeCondition.notify_one();
+    }
+}
+
+void CoreWaitForJob(CoreJobHandle job)
+{
+    if (job == NULL)
+    {
+        return;
+    }
+
+    CoreJobPool* pool = &GlobalJobPool;
+    u32 threadIndex = CoreJobThreadIndex;
+    Assert(threadIndex < pool->threadsCount);
+
+    while (job->unfinishedJobs.load(std::memory_order_acquire) != 0)
+    {
+        CoreJob* other = CoreFindJobInternal(pool, threadIndex);
+        if (other != NULL)
+        {
+            CoreExecuteJobInternal(other, threadIndex);
+        }
+        else
+        {
+            std::this_thread::yield();
+        }
+    }
+}
+
+MemoryStack* CoreGetScratchStack(MemoryStack* conflict)
+{
+    CoreJobWorker* worker = CoreGetJobWorkerInternal();
+    return worker->scratchStacks + (worker->scratchStacks == conflict ? 1 : 0);
+}
+
+void CoreResetJobsFrame()
+{
+    CoreJobPool* pool = &GlobalJobPool;
+    for (u32 i = 0; i < pool->threadsCount; i++)
+    {
+        pool->workers[i].jobsAllocated = 0;
+        for (u32 j = 0; j < ArrayCount(pool->workers[i].scratchStacks); j++)
+        {
+            MemoryStack* stack = pool->workers[i].scratchStacks + j;
+            stack->top = 0;
+            stack->free = stack->memorySize;
+            stack->lastMark = NULL;
+        }
+    }
+}
+
+struct CoreParallelForData
+{
+    CoreParallelForFn* fn;
+    void* data;
+    u32 count;
+    std::atomic<u32> nextIndex;
+};
+
+static void CoreParallelForJob(void* data, u32 threadIndex)
+{
+    CoreParallelForData* parallelFor = (CoreParallelForData*)data;
+    while (true)
+    {
+        u32 index = parallelFor->nextIndex.fetch_add(1, std::memory_order_relaxed);
+        if (index >= parallelFor->count)
+        {
+            break;
+        }
+
+        parallelFor->fn(parallelFor->data, index, threadIndex);
+    }
+}
+
+// NOTE: Indices are handed out one at a time from a shared counter, so uneven items balance themselves.
+// The calling thread works on them too and helps with other jobs until the stragglers are done.
+void CoreParallelFor(u32 count, CoreParallelForFn* fn, void* data)
+{
+    if (count == 0)
+    {
+        return;
+    }
+
+    CoreParallelForData parallelFor;
+    parallelFor.fn = fn;
+    parallelFor.data = data;
+    parallelFor.count = count;
+    parallelFor.nextIndex.store(0, std::memory_order_relaxed);
+
+    CoreJobHandle root = CoreCreateJob(NULL, NULL, NULL);
+    if (root == NULL)
+    {
+        CoreParallelForJob(&parallelFor, CoreJobThreadIndex);
+        return;
+    }
+
+    u32 threadsCount = CoreGetJobThreadsCount();
+    u32 helpers = (count < threadsCount ? count : threadsCount) - 1;
+    for (u32 i = 0; i < helpers; i++)
+    {
+        CoreJobHandle helper = CoreCreateJob(CoreParallelForJob, &parallelFor, root);
+        if (helper == NULL)
+        {
+            break;
+        }
+
+        CoreRunJob(helper);
+    }
+
+    CoreParallelForJob(&parallelFor, CoreJobThreadIndex);
+    CoreFinishJobInternal(root);
+    CoreWaitForJob(root);
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#include "Common.h"
+#include "CoreAPI.h"
+
+// NOTE: Work stealing job system shared by the platform layer and game code through CoreAPI.
+// Every thread owns a job queue, it takes its own newest jobs first and steals the oldest ones of
+// other threads when it runs out. The thread which calls CoreInitJobs becomes job thread 0.
+void CoreInitJobs(u32 threadsCount);
+void CoreShutdownJobs();
+
+u32 CoreGetJobThreadsCount();
+CoreJobHandle CoreCreateJob(CoreJobFn* fn, void* data, CoreJobHandle parent);
+void CoreRunJob(CoreJobHandle job);
+void CoreWaitForJob(CoreJobHandle job);
+void CoreParallelFor(u32 count, CoreParallelForFn* fn, void* data);
+
+MemoryStack* CoreGetScratchStack(MemoryStack* conflict);
+// NOTE: Called at frame boundaries, while no jobs are running. Recycles job slots and resets scratch stacks.
+void CoreResetJobsFrame();
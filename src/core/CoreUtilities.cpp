@@ -1,7 +1,5 @@
 #include "CoreUtilities.h"
 
-#include "../../ext/SDL2/include/SDL.h"
-
 // TODO:
 // TODO: On windows we definetly want our custom file io system sice SDL is doing all sorts
 // TODO: of crazines and memory allocation hell in its implementation
@@ -9,6 +7,7 @@
 
 #if defined(PLATFORM_WINDOWS)
 
+#include "../../ext/SDL2/include/SDL.h"
 #include <windows.h>
 
 #define WIN32_PAGE_SIZE Kilobytes(4) // [https://devblogs.microsoft.com/oldnewthing/20210510-00/?p=105200]
@@ -39,7 +38,34 @@ PagesAllocationResult PlatformAllocatePages(uptr desiredSize)
     // TODO: Disable pages protection in release build.
     return PlatformAllocatePagesInternal(desiredSize, true);
 }
-#endif
+
+PagesAllocationResult PlatformReservePages(uptr desiredSize)
+{
+    uptr numPages = desiredSize / WIN32_PAGE_SIZE + ((desiredSize % WIN32_PAGE_SIZE) == 0 ? 0 : 1);
+
+    PagesAllocationResult result {};
+    void* memory = VirtualAlloc(0, WIN32_PAGE_SIZE * numPages, MEM_RESERVE, PAGE_NOACCESS);
+    if (memory == NULL)
+    {
+        return result;
+    }
+
+    result.memory = memory;
+    result.actualSize = numPages * WIN32_PAGE_SIZE;
+    result.pageSize = WIN32_PAGE_SIZE;
+
+    return result;
+}
+
+b32 PlatformCommitPages(void* memory, uptr size)
+{
+    return VirtualAlloc(memory, size, MEM_COMMIT, PAGE_READWRITE) != NULL;
+}
+
+void PlatformDecommitPages(void* memory, uptr size)
+{
+    VirtualFree(memory, size, MEM_DECOMMIT);
+}
 
 FileHandle PlatformOpenFile(const char* filename, OpenFileMode mode)
 {
@@ -101,3 +127,143 @@ b32 PlatformCloseFile(FileHandle handle)
 
     return result;
 }
+
+#elif defined(PLATFORM_LINUX)
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+
+PagesAllocationResult PlatformAllocatePagesInternal(uptr desiredSize, bool overflowProtection)
+{
+    uptr pageSize = (uptr)sysconf(_SC_PAGESIZE);
+    uptr numPages = desiredSize / pageSize + ((desiredSize % pageSize) == 0 ? 0 : 1);
+    uptr guardPages = overflowProtection ? 2 : 0;
+
+    PagesAllocationResult result {};
+
+    // NOTE: Linux commits anonymous pages on first touch, so MAP_NORESERVE gives
+    // the same reserve-now-pay-later behaviour as the big AllocatePages calls expect.
+    void* memory = mmap(0, pageSize * (numPages + guardPages), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (memory == MAP_FAILED)
+    {
+        return result;
+    }
+
+    char* base = (char*)memory;
+    if (overflowProtection)
+    {
+        mprotect(base, pageSize, PROT_NONE);
+        mprotect(base + pageSize * (numPages + 1), pageSize, PROT_NONE);
+        base += pageSize;
+    }
+
+    result.memory = base;
+    result.actualSize = numPages * pageSize;
+    result.pageSize = pageSize;
+
+    return result;
+}
+
+PagesAllocationResult PlatformAllocatePages(uptr desiredSize)
+{
+    return PlatformAllocatePagesInternal(desiredSize, true);
+}
+
+PagesAllocationResult PlatformReservePages(uptr desiredSize)
+{
+    uptr pageSize = (uptr)sysconf(_SC_PAGESIZE);
+    uptr numPages = desiredSize / pageSize + ((desiredSize % pageSize) == 0 ? 0 : 1);
+
+    PagesAllocationResult result {};
+    void* memory = mmap(0, pageSize * numPages, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (memory == MAP_FAILED)
+    {
+        return result;
+    }
+
+    result.memory = memory;
+    result.actualSize = numPages * pageSize;
+    result.pageSize = pageSize;
+
+    return result;
+}
+
+b32 PlatformCommitPages(void* memory, uptr size)
+{
+    return mprotect(memory, size, PROT_READ | PROT_WRITE) == 0;
+}
+
+// NOTE: MADV_DONTNEED drops the pages right away, they read back as zeroes if committed again.
+void PlatformDecommitPages(void* memory, uptr size)
+{
+    madvise(memory, size, MADV_DONTNEED);
+    mprotect(memory, size, PROT_NONE);
+}
+
+// NOTE: File handles are fd + 1 so that 0 still means "failed to open".
+FileHandle PlatformOpenFile(const char* filename, OpenFileMode mode)
+{
+    int flags = 0;
+    switch (mode)
+    {
+    case OpenFileMode_Write: { flags = O_WRONLY | O_CREAT | O_TRUNC; } break;
+    case OpenFileMode_Read: { flags = O_RDONLY; } break;
+        InvalidDefault();
+    }
+
+    int fd = open(filename, flags, 0644);
+    if (fd < 0)
+    {
+        return 0;
+    }
+
+    return (FileHandle)(fd + 1);
+}
+
+i64 PlatformGetFileSize(FileHandle handle)
+{
+    i64 result = -1;
+
+    struct stat info;
+    if (fstat((int)(handle - 1), &info) == 0)
+    {
+        result = (i64)info.st_size;
+    }
+
+    return result;
+}
+
+i64 PlatformReadFile(FileHandle handle, void* buffer, i64 bufferSize)
+{
+    Assert(bufferSize > 0);
+
+    int fd = (int)(handle - 1);
+    i64 totalRead = 0;
+    while (totalRead < bufferSize)
+    {
+        ssize_t read = pread(fd, (char*)buffer + totalRead, (size_t)(bufferSize - totalRead), (off_t)totalRead);
+        if (read <= 0)
+        {
+            if (read < 0 && errno == EINTR)
+            {
+                continue;
+            }
+
+            return -1;
+        }
+
+        totalRead += read;
+    }
+
+    return totalRead;
+}
+
+b32 PlatformCloseFile(FileHandle handle)
+{
+    return close((int)(handle - 1)) == 0;
+}
+
+#endif
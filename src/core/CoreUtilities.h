@@ -4,6 +4,9 @@
 #include "CoreAPI.h"
 
 PagesAllocationResult PlatformAllocatePages(uptr desiredSize);
+PagesAllocationResult PlatformReservePages(uptr desiredSize);
+b32 PlatformCommitPages(void* memory, uptr size);
+void PlatformDecommitPages(void* memory, uptr size);
 
 FileHandle PlatformOpenFile(const char* filename, OpenFileMode mode);
 i64 PlatformGetFileSize(FileHandle handle);
@@ -0,0 +1,684 @@
+#include "Common.h"
+#include "CoreAPI.h"
+#include "CoreUtilities.h"
+#include "CoreJobs.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <time.h>
+#include <stdio.h>
+#include <dlfcn.h>
+#include <sys/resource.h>
+
+// NOTE: Headless Linux platform layer. There is no window, no input and no ImGui.
+// Frames are generated as fast as possible and submitted either to the null renderer,
+// which only validates commands, or to the software renderer which produces
+// reference images that can be dumped and compared against golden images.
+// With --benchmark the game fills a FrameProfile every frame and per-stage timings,
+// throughput and allocation counts are reported at exit.
+
+#define LogPrint(fmt, ...) printf(fmt, ##__VA_ARGS__)
+#define Assert(expr, ...) assert(expr)
+#define Debug_Assert(expr, ...) assert(expr)
+// NOTE: Defined always
+#define Panic(expr, ...) assert(expr)
+
+struct MemoryHeap
+{
+    u64 allocationsCount;
+};
+
+enum LinuxRendererBackend
+{
+    LinuxRendererBackend_Null,
+    LinuxRendererBackend_Software
+};
+
+struct BenchmarkFrame
+{
+    FrameProfile profile;
+    f64 frameTime;
+    u64 heapAllocationsCount;
+};
+
+struct LinuxCoreContext
+{
+    b32 running;
+
+    f64 lastRenderTime;
+    u64 framesToRun;
+    // NOTE: Feed 1/60s render deltas instead of measured ones so frames are reproducible.
+    b32 fixedTime;
+
+    CoreState state;
+
+    LinuxRendererBackend rendererBackend;
+    RendererAPI* renderer;
+
+    GameUpdateAndRenderFn* gameUpdateAndRenderProc;
+
+    b32 benchmark;
+    u32 benchmarkWarmupFrames;
+    u32 benchmarkFramesCount;
+    BenchmarkFrame* benchmarkFrames;
+    FrameProfile frameProfile;
+};
+
+extern RendererAPI* InitializeRenderer_Null(CoreState* coreContext, DisplayParams desiredDisplayParams, DisplayParams* actualDisplayParams, b32 validateCommands);
+extern RenderFrameStats NullRendererGetTotalStats();
+extern RendererAPI* InitializeRenderer_Software(CoreState* coreContext, DisplayParams desiredDisplayParams, DisplayParams* actualDisplayParams);
+extern RenderFrameStats SoftwareRendererGetTotalStats();
+extern u32* SoftwareRendererGetFramebuffer(u32* width, u32* height);
+
+static LinuxCoreContext* _GlobalCoreContext;
+// NOTE: Counted across all heaps, renderer allocations included.
+static u64 GlobalHeapAllocationsCount;
+
+f64 LinuxGetTimestamp()
+{
+    timespec time {};
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return (f64)time.tv_sec + (f64)time.tv_nsec * 1.0e-9;
+}
+
+MemoryHeap* CreateHeap()
+{
+    MemoryHeap* heap = (MemoryHeap*)calloc(1, sizeof(MemoryHeap));
+    return heap;
+}
+
+void DestroyHeap(MemoryHeap* heap)
+{
+    free(heap);
+}
+
+void* coreHeapAlloc(MemoryHeap* heap, uptr size, b32 zero)
+{
+    heap->allocationsCount++;
+    GlobalHeapAllocationsCount++;
+    return zero ? calloc(1, size) : malloc(size);
+}
+
+void* coreHeapRealloc(MemoryHeap* heap, void* p, uptr size, b32 zero)
+{
+    // TODO: zero is not supported since there is no way to get the old block size.
+    Assert(!zero);
+    heap->allocationsCount++;
+    GlobalHeapAllocationsCount++;
+    return realloc(p, size);
+}
+
+void coreHeapFree(MemoryHeap* heap, void* ptr)
+{
+    free(ptr);
+}
+
+void CoreSetParameter(const CoreParameterData* param)
+{
+    auto context = _GlobalCoreContext;
+    switch (param->param)
+    {
+    case CoreParameter_VSync: {
+        context->renderer->SetVsyncMode(param->vsync);
+        context->state.vsyncMode = param->vsync;
+    }
+    break;
+
+    case CoreParameter_DisplayMode: {
+        context->state.currentDisplayMode = param->displayMode;
+    }
+    break;
+
+    case CoreParameter_DisplayParams: {
+        context->state.currentDisplayParams = context->renderer->SetDisplayParams(param->displayParams);
+    }
+    break;
+
+    case CoreParameter_FpsLockMode: {
+        // NOTE: Headless runs are never frame locked.
+    }
+    break;
+
+    default: {
+    }
+    break;
+    }
+}
+
+void CoreWriteLog(CoreLogLevel logLevel, const char* tags, u32 tagsCount, const char* format, va_list vlist)
+{
+    if (tags != NULL)
+    {
+        printf("[%s] ", tags);
+    }
+    vprintf(format, vlist);
+}
+
+void CoreInit(LinuxCoreContext* context, GameUpdateAndRenderFn* gameUpdateAndRenderProc, DisplayParams displayParams, b32 validateCommands, u32 jobThreadsCount)
+{
+    Assert(gameUpdateAndRenderProc);
+    context->gameUpdateAndRenderProc = gameUpdateAndRenderProc;
+
+    _GlobalCoreContext = context;
+    context->running = true;
+
+    context->state.coreAPI.OpenFile = PlatformOpenFile;
+    context->state.coreAPI.GetFileSize = PlatformGetFileSize;
+    context->state.coreAPI.ReadFile = PlatformReadFile;
+    context->state.coreAPI.CloseFile = PlatformCloseFile;
+
+    context->state.coreAPI.CreateHeap = CreateHeap;
+    context->state.coreAPI.DestroyHeap = DestroyHeap;
+    context->state.coreAPI.HeapAlloc = coreHeapAlloc;
+    context->state.coreAPI.HeapRealloc = coreHeapRealloc;
+    context->state.coreAPI.HeapFree = coreHeapFree;
+
+    context->state.coreAPI.AllocatePages = PlatformAllocatePages;
+    context->state.coreAPI.ReservePages = PlatformReservePages;
+    context->state.coreAPI.CommitPages = PlatformCommitPages;
+    context->state.coreAPI.DecommitPages = PlatformDecommitPages;
+
+    context->state.coreAPI.SetParameter = CoreSetParameter;
+    context->state.coreAPI.WriteLog = CoreWriteLog;
+    context->state.coreAPI.GetTimestamp = LinuxGetTimestamp;
+
+    CoreInitJobs(jobThreadsCount);
+    context->state.coreAPI.GetJobThreadsCount = CoreGetJobThreadsCount;
+    context->state.coreAPI.CreateJob = CoreCreateJob;
+    context->state.coreAPI.RunJob = CoreRunJob;
+    context->state.coreAPI.WaitForJob = CoreWaitForJob;
+    context->state.coreAPI.GetScratchStack = CoreGetScratchStack;
+    context->state.coreAPI.ParallelFor = CoreParallelFor;
+
+    DisplayParams actualParams {};
+    if (context->rendererBackend == LinuxRendererBackend_Software)
+    {
+        context->renderer = InitializeRenderer_Software(&context->state, displayParams, &actualParams);
+    }
+    else
+    {
+        context->renderer = InitializeRenderer_Null(&context->state, displayParams, &actualParams, validateCommands);
+    }
+    Assert(context->renderer);
+
+    context->state.rendererAPI = context->renderer;
+    context->state.currentDisplayMode = DisplayMode_Window;
+    context->state.currentDisplayParams = actualParams;
+
+    context->renderer->SetVsyncMode(VSyncMode_Disabled);
+    context->state.vsyncMode = VSyncMode_Disabled;
+
+    context->state.availableDisplayConfigs = &context->state.currentDisplayParams;
+    context->state.availableDisplayConfigsCount = 1;
+
+    // NOTE: No ImGui in headless mode. Game code checks for NULL.
+    context->state.imgui = NULL;
+    context->state.imguiContext = NULL;
+
+    if (context->benchmark)
+    {
+        context->state.frameProfile = &context->frameProfile;
+        context->benchmarkFrames = (BenchmarkFrame*)calloc(context->framesToRun, sizeof(BenchmarkFrame));
+    }
+
+    gameUpdateAndRenderProc(&context->state, GameInvoke_Init);
+
+    context->lastRenderTime = LinuxGetTimestamp();
+}
+
+void CoreMainLoopUpdate(LinuxCoreContext* context, f32 deltaTime)
+{
+    context->state.tickCount++;
+    context->state.updateDeltaTime = deltaTime;
+    context->state.updateAbsDeltaTime = deltaTime;
+
+    context->gameUpdateAndRenderProc(&context->state, GameInvoke_Update);
+}
+
+void CoreMainLoopRender(LinuxCoreContext* context)
+{
+    f64 timestamp = LinuxGetTimestamp();
+    f64 frameTime = timestamp - context->lastRenderTime;
+    context->lastRenderTime = timestamp;
+
+    CoreResetJobsFrame();
+
+    context->state.frameCount++;
+    // NOTE: Not clamped like in the windowed core, the game shows real numbers.
+    context->state.renderDeltaTime = (f32)(frameTime > 0.0 && !context->fixedTime ? frameTime : 1.0 / 60.0);
+    context->state.renderLag = 0.0f;
+
+    context->renderer->SetViewport(MakeVector2(0.0f, 0.0f), MakeVector2((f32)context->state.currentDisplayParams.width, (f32)context->state.currentDisplayParams.height));
+
+    memset(&context->frameProfile, 0, sizeof(context->frameProfile));
+    u64 heapAllocationsCount = GlobalHeapAllocationsCount;
+    f64 renderBeginTime = LinuxGetTimestamp();
+
+    context->gameUpdateAndRenderProc(&context->state, GameInvoke_Render);
+    context->renderer->SwapScreenBuffers();
+
+    if (context->benchmark && context->state.frameCount > context->benchmarkWarmupFrames)
+    {
+        BenchmarkFrame* frame = context->benchmarkFrames + context->benchmarkFramesCount++;
+        frame->profile = context->frameProfile;
+        frame->frameTime = LinuxGetTimestamp() - renderBeginTime;
+        frame->heapAllocationsCount = GlobalHeapAllocationsCount - heapAllocationsCount;
+    }
+}
+
+static int CompareF64(const void* a, const void* b)
+{
+    f64 x = *(const f64*)a;
+    f64 y = *(const f64*)b;
+    return x < y ? -1 : (x > y ? 1 : 0);
+}
+
+static void BenchmarkPrintRow(const char* name, f64* samples, u32 count)
+{
+    f64 sum = 0.0;
+    for (u32 i = 0; i < count; i++)
+    {
+        sum += samples[i];
+    }
+
+    qsort(samples, count, sizeof(f64), CompareF64);
+    LogPrint("  %-20s %10.3f %10.3f %10.3f %10.3f\n", name, sum / count * 1000.0, samples[0] * 1000.0, samples[count / 2] * 1000.0, samples[count - 1] * 1000.0);
+}
+
+static void BenchmarkReport(LinuxCoreContext* context, const char* csvPath)
+{
+    u32 count = context->benchmarkFramesCount;
+    if (count == 0)
+    {
+        LogPrint("Benchmark: no frames measured, increase --frames or decrease --warmup\n");
+        return;
+    }
+
+    static const char* stageNames[FrameProfileStage_Count] = { "Path emission", "Text layout", "Command recording", "Submit" };
+
+    f64* samples = (f64*)malloc(sizeof(f64) * count);
+
+    LogPrint("Benchmark: %u frames measured after %u warmup frames\n", count, context->benchmarkWarmupFrames);
+    LogPrint("  %-20s %10s %10s %10s %10s\n", "Stage (ms)", "avg", "min", "median", "max");
+    for (u32 stage = 0; stage < FrameProfileStage_Count; stage++)
+    {
+        for (u32 i = 0; i < count; i++)
+        {
+            samples[i] = context->benchmarkFrames[i].profile.stageTimes[stage];
+        }
+        BenchmarkPrintRow(stageNames[stage], samples, count);
+    }
+
+    for (u32 i = 0; i < count; i++)
+    {
+        samples[i] = context->benchmarkFrames[i].frameTime;
+    }
+    BenchmarkPrintRow("Frame", samples, count);
+
+    f64 generationTime = 0.0;
+    u64 verticesCount = 0;
+    u64 retainedVerticesCount = 0;
+    u64 vertexBytesCount = 0;
+    u64 indicesCount = 0;
+    u64 indexBytesCount = 0;
+    u64 segmentsCount = 0;
+    u64 commandsCount = 0;
+    u64 heapAllocationsCount = 0;
+    u64 stackPushesCount = 0;
+    u64 stackPushedBytes = 0;
+    u64 committedBytes = 0;
+    for (u32 i = 0; i < count; i++)
+    {
+        BenchmarkFrame* frame = context->benchmarkFrames + i;
+        generationTime += frame->profile.stageTimes[FrameProfileStage_PathEmission] + frame->profile.stageTimes[FrameProfileStage_TextLayout] + frame->profile.stageTimes[FrameProfileStage_CommandRecording];
+        verticesCount += frame->profile.verticesCount;
+        retainedVerticesCount += frame->profile.retainedVerticesCount;
+        vertexBytesCount += frame->profile.vertexBytesCount;
+        indicesCount += frame->profile.indicesCount;
+        indexBytesCount += frame->profile.indexBytesCount;
+        segmentsCount += frame->profile.segmentsCount;
+        commandsCount += frame->profile.commandsCount;
+        heapAllocationsCount += frame->heapAllocationsCount;
+        stackPushesCount += frame->profile.stackPushesCount;
+        stackPushedBytes += frame->profile.stackPushedBytes;
+        committedBytes = frame->profile.committedBytes > committedBytes ? frame->profile.committedBytes : committedBytes;
+    }
+
+    LogPrint("  Per frame: %llu generated vertices, %llu retained vertices, %llu indices, %llu line segments, %llu commands\n", (unsigned long long)(verticesCount / count), (unsigned long long)(retainedVerticesCount / count), (unsigned long long)(indicesCount / count), (unsigned long long)(segmentsCount / count), (unsigned long long)(commandsCount / count));
+    LogPrint("  Geometry per frame: %.2f MB vertices, %.2f MB indices\n", (f64)vertexBytesCount / count / (1024.0 * 1024.0), (f64)indexBytesCount / count / (1024.0 * 1024.0));
+    LogPrint("  Generation throughput: %.2f M vertices/s (emission + layout + recording)\n", generationTime > 0.0 ? verticesCount / generationTime * 1.0e-6 : 0.0);
+    LogPrint("  Allocations per frame: %.1f heap, %.1f stack pushes (%llu bytes)\n", (f64)heapAllocationsCount / count, (f64)stackPushesCount / count, (unsigned long long)(stackPushedBytes / count));
+
+    struct rusage usage {};
+    getrusage(RUSAGE_SELF, &usage);
+    LogPrint("  Memory: %.2f MB committed by frame buffers (peak), %.2f MB peak resident\n", (f64)committedBytes / (1024.0 * 1024.0), (f64)usage.ru_maxrss / 1024.0);
+
+    free(samples);
+
+    if (csvPath != NULL)
+    {
+        FILE* csv = fopen(csvPath, "w");
+        if (csv == NULL)
+        {
+            LogPrint("Failed to write %s\n", csvPath);
+            return;
+        }
+
+        fprintf(csv, "frame,path_emission_ms,text_layout_ms,command_recording_ms,submit_ms,frame_ms,vertices,retained_vertices,vertex_bytes,indices,index_bytes,segments,commands,heap_allocations,stack_pushes,stack_bytes,committed_bytes\n");
+        for (u32 i = 0; i < count; i++)
+        {
+            BenchmarkFrame* frame = context->benchmarkFrames + i;
+            fprintf(csv, "%u", i);
+            for (u32 stage = 0; stage < FrameProfileStage_Count; stage++)
+            {
+                fprintf(csv, ",%.4f", frame->profile.stageTimes[stage] * 1000.0);
+            }
+            fprintf(csv, ",%.4f,%llu,%llu,%llu,%llu,%llu,%llu,%llu,%llu,%llu,%llu,%llu\n", frame->frameTime * 1000.0, (unsigned long long)frame->profile.verticesCount, (unsigned long long)frame->profile.retainedVerticesCount, (unsigned long long)frame->profile.vertexBytesCount, (unsigned long long)frame->profile.indicesCount, (unsigned long long)frame->profile.indexBytesCount, (unsigned long long)frame->profile.segmentsCount, (unsigned long long)frame->profile.commandsCount, (unsigned long long)frame->heapAllocationsCount, (unsigned long long)frame->profile.stackPushesCount, (unsigned long long)frame->profile.stackPushedBytes, (unsigned long long)frame->profile.committedBytes);
+        }
+
+        fclose(csv);
+        LogPrint("Per frame samples written to %s\n", csvPath);
+    }
+}
+
+static u32 ParseU32Argument(int argc, char** argv, const char* name, u32 defaultValue)
+{
+    for (int i = 1; i < argc - 1; i++)
+    {
+        if (strcmp(argv[i], name) == 0)
+        {
+            return (u32)strtoul(argv[i + 1], NULL, 10);
+        }
+    }
+
+    return defaultValue;
+}
+
+static const char* ParseStringArgument(int argc, char** argv, const char* name, const char* defaultValue)
+{
+    for (int i = 1; i < argc - 1; i++)
+    {
+        if (strcmp(argv[i], name) == 0)
+        {
+            return argv[i + 1];
+        }
+    }
+
+    return defaultValue;
+}
+
+static b32 HasArgument(int argc, char** argv, const char* name)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], name) == 0)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+// NOTE: Uncompressed 32 bit TGA, top-left origin. Pixels are RGBA8 in memory, BGRA8 in file.
+static b32 WriteTGA(const char* path, const u32* pixels, u32 width, u32 height)
+{
+    FILE* file = fopen(path, "wb");
+    if (file == NULL)
+    {
+        return false;
+    }
+
+    byte header[18] = {};
+    header[2] = 2;
+    header[12] = (byte)(width & 0xff);
+    header[13] = (byte)(width >> 8);
+    header[14] = (byte)(height & 0xff);
+    header[15] = (byte)(height >> 8);
+    header[16] = 32;
+    header[17] = 0x28;
+    b32 result = fwrite(header, sizeof(header), 1, file) == 1;
+
+    u32* row = (u32*)malloc(sizeof(u32) * width);
+    for (u32 y = 0; y < height && result; y++)
+    {
+        for (u32 x = 0; x < width; x++)
+        {
+            u32 c = pixels[y * width + x];
+            row[x] = (c & 0xff00ff00) | ((c & 0xff) << 16) | ((c >> 16) & 0xff);
+        }
+        result = fwrite(row, sizeof(u32) * width, 1, file) == 1;
+    }
+
+    free(row);
+    fclose(file);
+    return result;
+}
+
+static u32* ReadTGA(const char* path, u32* width, u32* height)
+{
+    FILE* file = fopen(path, "rb");
+    if (file == NULL)
+    {
+        return NULL;
+    }
+
+    byte header[18];
+    if (fread(header, sizeof(header), 1, file) != 1 || header[2] != 2 || header[16] != 32)
+    {
+        LogPrint("%s: only uncompressed 32 bit TGA files are supported\n", path);
+        fclose(file);
+        return NULL;
+    }
+
+    *width = header[12] | (header[13] << 8);
+    *height = header[14] | (header[15] << 8);
+    b32 topLeft = (header[17] & 0x20) != 0;
+    fseek(file, header[0], SEEK_CUR);
+
+    u32* pixels = (u32*)malloc(sizeof(u32) * *width * *height);
+    for (u32 i = 0; i < *height; i++)
+    {
+        u32 y = topLeft ? i : *height - 1 - i;
+        u32* row = pixels + y * *width;
+        if (fread(row, sizeof(u32) * *width, 1, file) != 1)
+        {
+            free(pixels);
+            fclose(file);
+            return NULL;
+        }
+
+        for (u32 x = 0; x < *width; x++)
+        {
+            u32 c = row[x];
+            row[x] = (c & 0xff00ff00) | ((c & 0xff) << 16) | ((c >> 16) & 0xff);
+        }
+    }
+
+    fclose(file);
+    return pixels;
+}
+
+// NOTE: Returns the number of pixels with any channel differing by more than tolerance.
+static u64 CompareWithGolden(const char* path, const u32* pixels, u32 width, u32 height, u32 tolerance)
+{
+    u32 goldenWidth = 0;
+    u32 goldenHeight = 0;
+    u32* golden = ReadTGA(path, &goldenWidth, &goldenHeight);
+    if (golden == NULL)
+    {
+        LogPrint("Failed to read golden image %s\n", path);
+        return (u64)width * height;
+    }
+
+    if (goldenWidth != width || goldenHeight != height)
+    {
+        LogPrint("Golden image size mismatch: %ux%u, expected %ux%u\n", goldenWidth, goldenHeight, width, height);
+        free(golden);
+        return (u64)width * height;
+    }
+
+    u64 mismatchedCount = 0;
+    u32 maxDifference = 0;
+    u32 firstX = 0;
+    u32 firstY = 0;
+    for (u32 i = 0; i < width * height; i++)
+    {
+        u32 difference = 0;
+        for (u32 shift = 0; shift < 32; shift += 8)
+        {
+            i32 a = (pixels[i] >> shift) & 0xff;
+            i32 b = (golden[i] >> shift) & 0xff;
+            u32 d = (u32)(a > b ? a - b : b - a);
+            difference = d > difference ? d : difference;
+        }
+
+        if (difference > tolerance)
+        {
+            if (mismatchedCount == 0)
+            {
+                firstX = i % width;
+                firstY = i / width;
+            }
+            mismatchedCount++;
+        }
+        maxDifference = difference > maxDifference ? difference : maxDifference;
+    }
+
+    LogPrint("Golden image %s: %llu pixels differ (tolerance %u), max channel difference %u", path, (unsigned long long)mismatchedCount, tolerance, maxDifference);
+    if (mismatchedCount > 0)
+    {
+        LogPrint(", first at (%u, %u)", firstX, firstY);
+    }
+    LogPrint("\n");
+
+    free(golden);
+    return mismatchedCount;
+}
+
+int main(int argc, char** argv)
+{
+    LinuxCoreContext context {};
+
+    if (HasArgument(argc, argv, "--help"))
+    {
+        LogPrint("Usage: %s [--frames N] [--width W] [--height H] [--no-validate] [--renderer null|software] [--job-threads N] [--dump-frame out.tga] [--golden golden.tga] [--tolerance N] [--fixed-time] [--benchmark] [--warmup N] [--benchmark-csv out.csv] [--path-mode joined|quads|segments] [--vertex-format compact|full] [--batch-merge on|off] [--sort-commands on|off] [--decommit-unused on|off] [--retain-geometry on|off] [--memory-report on|off] [--string-benchmark on|off] [--kerning on|off] [--text-benchmark on|off]\n", argv[0]);
+        return 0;
+    }
+
+    const char* rendererName = ParseStringArgument(argc, argv, "--renderer", "null");
+    if (strcmp(rendererName, "software") == 0)
+    {
+        context.rendererBackend = LinuxRendererBackend_Software;
+    }
+    else if (strcmp(rendererName, "null") != 0)
+    {
+        LogPrint("Unknown renderer %s\n", rendererName);
+        return 1;
+    }
+
+    const char* dumpFramePath = ParseStringArgument(argc, argv, "--dump-frame", NULL);
+    const char* goldenPath = ParseStringArgument(argc, argv, "--golden", NULL);
+    if ((dumpFramePath != NULL || goldenPath != NULL) && context.rendererBackend != LinuxRendererBackend_Software)
+    {
+        LogPrint("--dump-frame and --golden require --renderer software\n");
+        return 1;
+    }
+
+    context.framesToRun = ParseU32Argument(argc, argv, "--frames", 100);
+
+    DisplayParams displayParams {};
+    displayParams.width = ParseU32Argument(argc, argv, "--width", 1920);
+    displayParams.height = ParseU32Argument(argc, argv, "--height", 1080);
+
+    b32 validateCommands = !HasArgument(argc, argv, "--no-validate");
+    // NOTE: --threads used to size the software renderer's own pool, it now sizes the shared job pool.
+    u32 jobThreadsCount = ParseU32Argument(argc, argv, "--job-threads", ParseU32Argument(argc, argv, "--threads", 0));
+    u32 goldenTolerance = ParseU32Argument(argc, argv, "--tolerance", 2);
+    context.fixedTime = HasArgument(argc, argv, "--fixed-time");
+
+    // NOTE: Benchmark runs always use fixed time so every frame does identical work.
+    context.benchmark = HasArgument(argc, argv, "--benchmark");
+    context.benchmarkWarmupFrames = ParseU32Argument(argc, argv, "--warmup", 10);
+    context.fixedTime |= context.benchmark;
+    const char* benchmarkCsvPath = ParseStringArgument(argc, argv, "--benchmark-csv", NULL);
+
+    LogPrint("Summer Game (Linux, headless)\n");
+
+    void* gameLibrary = dlopen("./Game.so", RTLD_NOW | RTLD_LOCAL);
+    if (gameLibrary == NULL)
+    {
+        LogPrint("Failed to load game library: %s\n", dlerror());
+        return 1;
+    }
+
+    GameUpdateAndRenderFn* gameUpdateAndRenderProc = (GameUpdateAndRenderFn*)dlsym(gameLibrary, "GameUpdateAndRender");
+    Assert(gameUpdateAndRenderProc, "Failed to load game library.\n");
+
+    context.state.commandLineArgsCount = (u32)argc;
+    context.state.commandLineArgs = argv;
+
+    CoreInit(&context, gameUpdateAndRenderProc, displayParams, validateCommands, jobThreadsCount);
+
+    const f32 updateDelay = 1.0f / 60.0f;
+    f64 beginTime = LinuxGetTimestamp();
+
+    while (context.running)
+    {
+        CoreMainLoopUpdate(&context, updateDelay);
+        CoreMainLoopRender(&context);
+
+        if (context.state.frameCount >= context.framesToRun)
+        {
+            context.running = false;
+        }
+    }
+
+    f64 totalTime = LinuxGetTimestamp() - beginTime;
+    RenderFrameStats stats = context.rendererBackend == LinuxRendererBackend_Software ? SoftwareRendererGetTotalStats() : NullRendererGetTotalStats();
+    u64 frames = context.state.frameCount > 0 ? context.state.frameCount : 1;
+
+    LogPrint("Frames: %llu, total: %.3fs, average frame: %.3fms\n", (unsigned long long)context.state.frameCount, totalTime, totalTime * 1000.0 / frames);
+    LogPrint("Per frame: %u commands, %u draws, %u materials, %llu vertices, %llu indices, %llu line segments\n", stats.commandsCount / (u32)frames, stats.drawCount / (u32)frames, stats.setMaterialCount / (u32)frames, (unsigned long long)(stats.verticesCount / frames), (unsigned long long)(stats.indicesCount / frames), (unsigned long long)(stats.segmentsCount / frames));
+    LogPrint("Validation errors: %u%s\n", stats.validationErrorsCount, validateCommands ? "" : " (validation disabled)");
+
+    if (context.benchmark)
+    {
+        BenchmarkReport(&context, benchmarkCsvPath);
+    }
+
+    int exitCode = stats.validationErrorsCount == 0 ? 0 : 2;
+
+    if (context.rendererBackend == LinuxRendererBackend_Software)
+    {
+        u32 width = 0;
+        u32 height = 0;
+        u32* framebuffer = SoftwareRendererGetFramebuffer(&width, &height);
+
+        if (dumpFramePath != NULL)
+        {
+            if (WriteTGA(dumpFramePath, framebuffer, width, height))
+            {
+                LogPrint("Last frame written to %s\n", dumpFramePath);
+            }
+            else
+            {
+                LogPrint("Failed to write %s\n", dumpFramePath);
+                exitCode = 1;
+            }
+        }
+
+        if (goldenPath != NULL && CompareWithGolden(goldenPath, framebuffer, width, height, goldenTolerance) > 0)
+        {
+            exitCode = 3;
+        }
+    }
+
+    CoreShutdownJobs();
+
+    return exitCode;
+}
+
+#include "CoreUtilities.cpp"
+#include "CoreJobs.cpp"
@@ -36,6 +36,68 @@ uptr mmAlignAdressDown(uptr address, uptr alignment)
     return result;
 }
 
+VirtualMemoryRange mmCreateVirtualRange(void* memory, uptr reservedSize, uptr commitGranularity, MemoryCommitFn* commit, MemoryDecommitFn* decommit, AllocationFailStrategy failStrategy, const char* debugTag)
+{
+    Assert(mmIsPowerOfTwo(commitGranularity));
+
+    VirtualMemoryRange range = {0};
+    range.failStrategy = failStrategy;
+    range.memory = (byte*)memory;
+    range.reservedSize = reservedSize;
+    range.commitGranularity = commitGranularity;
+    range.commit = commit;
+    range.decommit = decommit;
+    range.debugTag = debugTag;
+    return range;
+}
+
+static bool mmHandleCommitFailedInternal(VirtualMemoryRange* range)
+{
+    if (range->failStrategy == AllocationFailedStrategy_Crash)
+    {
+        Assert(false);
+    }
+
+    return false;
+}
+
+// NOTE: Makes sure the first size bytes are committed.
+bool mmCommitVirtualRange(VirtualMemoryRange* range, uptr size)
+{
+    if (size <= range->committedSize)
+    {
+        return true;
+    }
+
+    if (size > range->reservedSize)
+    {
+        return mmHandleCommitFailedInternal(range);
+    }
+
+    uptr newCommittedSize = mmAlignAdressUp(size, range->commitGranularity);
+    newCommittedSize = newCommittedSize < range->reservedSize ? newCommittedSize : range->reservedSize;
+    if (!range->commit(range->memory + range->committedSize, newCommittedSize - range->committedSize))
+    {
+        return mmHandleCommitFailedInternal(range);
+    }
+
+    range->committedSize = newCommittedSize;
+    return true;
+}
+
+// NOTE: Returns pages past keepSize to the system, the range commits them again when it grows back.
+void mmDecommitVirtualRange(VirtualMemoryRange* range, uptr keepSize)
+{
+    uptr newCommittedSize = mmAlignAdressUp(keepSize, range->commitGranularity);
+    if (newCommittedSize >= range->committedSize || range->decommit == NULL)
+    {
+        return;
+    }
+
+    range->decommit(range->memory + newCommittedSize, range->committedSize - newCommittedSize);
+    range->committedSize = newCommittedSize;
+}
+
 MemoryStack mmCreateStack(void* memory, uptr memorySize, bool reveresed, AllocationFailStrategy failStrategy, const char* debugTag)
 {
     MemoryStack stack = {0};
@@ -57,6 +119,19 @@ MemoryStack mmCreateStack(void* memory, uptr memorySize, bool reveresed, Allocat
     return stack;
 }
 
+MemoryStack mmCreateGrowableStack(VirtualMemoryRange* pages, AllocationFailStrategy failStrategy, const char* debugTag)
+{
+    MemoryStack stack = mmCreateStack(pages->memory, pages->reservedSize, false, failStrategy, debugTag);
+    stack.pages = pages;
+    return stack;
+}
+
+void mmStackDecommitUnused(MemoryStack* stack)
+{
+    Assert(stack->pages != NULL);
+    mmDecommitVirtualRange(stack->pages, stack->top);
+}
+
 void* mmHandleAllocationFailed(MemoryStack* stack, uptr size)
 {
     if (stack->failStrategy == AllocationFailedStrategy_Crash)
@@ -81,6 +156,11 @@ void* mmStackPushAlignedFwd(MemoryStack* stack, uptr size, uptr alignment)
         return mmHandleAllocationFailed(stack, size);
     }
 
+    if (stack->pages != NULL && !mmCommitVirtualRange(stack->pages, newTop - (uptr)stack->memory))
+    {
+        return mmHandleAllocationFailed(stack, size);
+    }
+
     stack->free -= pushSize;
     stack->top = newTop - (uptr)stack->memory;
 
@@ -115,14 +195,21 @@ void* mmStackPushAlignedRev(MemoryStack* stack, uptr size, uptr alignment)
 
 void* mmStackPushAligned(MemoryStack* stack, uptr size, uptr alignment)
 {
+    stack->pushesCount++;
+    stack->pushedBytes += size;
+
+    void* result;
     if (!stack->reversed)
     {
-        return mmStackPushAlignedFwd(stack, size, alignment);
+        result = mmStackPushAlignedFwd(stack, size, alignment);
     }
     else
     {
-        return mmStackPushAlignedRev(stack, size, alignment);
+        result = mmStackPushAlignedRev(stack, size, alignment);
     }
+
+    stack->peakTop = stack->top > stack->peakTop ? stack->top : stack->peakTop;
+    return result;
 }
 
 void* mmStackPush(MemoryStack* stack, uptr size)
@@ -228,3 +315,343 @@ void mmStackEnsureAt(MemoryStack* stack, MemoryStackMark* mark)
         Assert(((uptr)stack->memory - stack->top) == (mark == NULL ? (uptr)stack->memory : (uptr)mark));
     }
 }
+
+MemoryStackScope mmBeginStackScope(MemoryStack* stack)
+{
+    MemoryStackScope scope;
+    scope.stack = stack;
+    scope.top = stack->top;
+    scope.lastMark = stack->lastMark;
+    return scope;
+}
+
+void mmEndStackScope(MemoryStackScope scope)
+{
+    MemoryStack* stack = scope.stack;
+    Assert(stack->top >= scope.top);
+
+    stack->top = scope.top;
+    stack->free = stack->memorySize - scope.top;
+    stack->lastMark = scope.lastMark;
+}
+
+ConcurrentMemoryStack mmCreateConcurrentStack(void* memory, uptr memorySize, AllocationFailStrategy failStrategy, const char* debugTag)
+{
+    ConcurrentMemoryStack stack = {0};
+    stack.failStrategy = failStrategy;
+    stack.memory = memory;
+    stack.memorySize = memorySize;
+    stack.debugTag = debugTag;
+    return stack;
+}
+
+void* mmConcurrentStackPushAligned(ConcurrentMemoryStack* stack, uptr size, uptr alignment)
+{
+    Assert(alignment > 0);
+    Assert(mmIsPowerOfTwo(alignment));
+
+    // NOTE: Reserving the worst case padding up front keeps the push to a single atomic add.
+    uptr pushSize = size + alignment - 1;
+    uptr top = AtomicFetchAddUptr(&stack->top, pushSize);
+
+    if (top + pushSize > stack->memorySize || top + pushSize < top)
+    {
+        if (stack->failStrategy == AllocationFailedStrategy_Crash)
+        {
+            Assert(false);
+        }
+
+        return NULL;
+    }
+
+    return (void*)mmAlignAdressUp((uptr)stack->memory + top, alignment);
+}
+
+void* mmConcurrentStackPush(ConcurrentMemoryStack* stack, uptr size)
+{
+    return mmConcurrentStackPushAligned(stack, size, 16);
+}
+
+MemoryStack mmConcurrentStackPushChunk(ConcurrentMemoryStack* stack, uptr size, const char* debugTag)
+{
+    void* memory = mmConcurrentStackPushAligned(stack, size, 64);
+    if (memory == NULL)
+    {
+        MemoryStack empty = mmCreateStack(NULL, 0, false, stack->failStrategy, debugTag);
+        return empty;
+    }
+
+    AtomicFetchAddUptr(&stack->pushesCount, 1);
+    AtomicFetchAddUptr(&stack->pushedBytes, size);
+    return mmCreateStack(memory, size, false, stack->failStrategy, debugTag);
+}
+
+void mmConcurrentStackReset(ConcurrentMemoryStack* stack)
+{
+    stack->top = 0;
+}
+
+// NOTE: Blocks are at least pointer sized and aligned so a free block can hold the free list link.
+MemoryPool mmCreatePool(MemoryStack* slabStack, uptr blockSize, uptr blockAlignment, u32 blocksPerSlab, AllocationFailStrategy failStrategy, const char* debugTag)
+{
+    Assert(blocksPerSlab > 0);
+    Assert(mmIsPowerOfTwo(blockAlignment));
+
+    MemoryPool pool = {0};
+    pool.failStrategy = failStrategy;
+    pool.slabStack = slabStack;
+    pool.blockAlignment = blockAlignment > sizeof(MemoryPoolBlock) ? blockAlignment : sizeof(MemoryPoolBlock);
+    pool.blockSize = mmAlignAdressUp(blockSize > sizeof(MemoryPoolBlock) ? blockSize : sizeof(MemoryPoolBlock), pool.blockAlignment);
+    pool.blocksPerSlab = blocksPerSlab;
+    pool.debugTag = debugTag;
+    return pool;
+}
+
+void* mmPoolAlloc(MemoryPool* pool)
+{
+    void* block;
+    if (pool->freeList != NULL)
+    {
+        block = pool->freeList;
+        pool->freeList = pool->freeList->next;
+    }
+    else
+    {
+        if (pool->slabBlocksLeft == 0)
+        {
+            // NOTE: The slab stack decides what happens when it runs out, the pool only passes NULL on.
+            byte* slab = (byte*)mmStackPushAligned(pool->slabStack, pool->blockSize * pool->blocksPerSlab, pool->blockAlignment);
+            if (slab == NULL)
+            {
+                if (pool->failStrategy == AllocationFailedStrategy_Crash)
+                {
+                    Assert(false);
+                }
+
+                return NULL;
+            }
+
+            pool->slabCursor = slab;
+            pool->slabBlocksLeft = pool->blocksPerSlab;
+            pool->slabsCount++;
+        }
+
+        block = pool->slabCursor;
+        pool->slabCursor += pool->blockSize;
+        pool->slabBlocksLeft--;
+    }
+
+    pool->allocationsCount++;
+    pool->usedBlocksCount++;
+    pool->peakUsedBlocksCount = pool->usedBlocksCount > pool->peakUsedBlocksCount ? pool->usedBlocksCount : pool->peakUsedBlocksCount;
+    return block;
+}
+
+void mmPoolFree(MemoryPool* pool, void* block)
+{
+    if (block == NULL)
+    {
+        return;
+    }
+
+    Assert(pool->usedBlocksCount > 0);
+    MemoryPoolBlock* freeBlock = (MemoryPoolBlock*)block;
+    freeBlock->next = pool->freeList;
+    pool->freeList = freeBlock;
+    pool->usedBlocksCount--;
+}
+
+// NOTE: Forgets every block and slab without touching them, rewind the slab stack afterwards to get the memory back.
+void mmPoolReset(MemoryPool* pool)
+{
+    pool->freeList = NULL;
+    pool->slabCursor = NULL;
+    pool->slabBlocksLeft = 0;
+    pool->slabsCount = 0;
+    pool->usedBlocksCount = 0;
+}
+
+static bool mmTagsEqualInternal(const char* a, const char* b)
+{
+    while (*a != 0 && *a == *b)
+    {
+        a++;
+        b++;
+    }
+
+    return *a == *b;
+}
+
+static u32 mmTrackerFindTagInternal(MemoryTracker* tracker, const char* debugTag)
+{
+    debugTag = debugTag != NULL ? debugTag : "Untagged";
+    for (u32 i = 0; i < tracker->tagsCount; i++)
+    {
+        if (mmTagsEqualInternal(tracker->tags[i].debugTag, debugTag))
+        {
+            return i;
+        }
+    }
+
+    // NOTE: The last slot is left for an "Untracked" tag which collects every tag past the limit.
+    if (tracker->tagsCount >= MemoryTrackerMaxTags - 1 && !mmTagsEqualInternal(debugTag, "Untracked"))
+    {
+        Log_Error("Memory Tracker", "Out of tags, \"%s\" is counted as \"Untracked\"\n", debugTag);
+        return mmTrackerFindTagInternal(tracker, "Untracked");
+    }
+
+    MemoryTagStats* tag = tracker->tags + tracker->tagsCount;
+    mmSet(tag, 0, sizeof(MemoryTagStats));
+    tag->debugTag = debugTag;
+    return tracker->tagsCount++;
+}
+
+static void mmTrackObjectInternal(MemoryTracker* tracker, MemoryTrackedKind kind, void* object, const char* debugTag, bool frameScoped)
+{
+    if (tracker->objectsCount == MemoryTrackerMaxObjects)
+    {
+        Log_Error("Memory Tracker", "Out of tracked objects, \"%s\" is not tracked\n", debugTag != NULL ? debugTag : "Untagged");
+        return;
+    }
+
+    MemoryTrackedObject* tracked = tracker->objects + tracker->objectsCount++;
+    mmSet(tracked, 0, sizeof(MemoryTrackedObject));
+    tracked->kind = kind;
+    tracked->object = object;
+    tracked->frameScoped = frameScoped;
+    tracked->tagIndex = mmTrackerFindTagInternal(tracker, debugTag);
+    tracker->tags[tracked->tagIndex].objectsCount++;
+}
+
+void mmTrackStack(MemoryTracker* tracker, MemoryStack* stack, bool frameScoped)
+{
+    mmTrackObjectInternal(tracker, MemoryTrackedKind_Stack, stack, stack->debugTag, frameScoped);
+}
+
+void mmTrackConcurrentStack(MemoryTracker* tracker, ConcurrentMemoryStack* stack)
+{
+    mmTrackObjectInternal(tracker, MemoryTrackedKind_ConcurrentStack, stack, stack->debugTag, false);
+}
+
+void mmTrackPool(MemoryTracker* tracker, MemoryPool* pool)
+{
+    mmTrackObjectInternal(tracker, MemoryTrackedKind_Pool, pool, pool->debugTag, false);
+}
+
+// NOTE: Takes the tag separately, ranges which are rebuilt every frame lose their own debugTag until then.
+void mmTrackVirtualRange(MemoryTracker* tracker, VirtualMemoryRange* range, const char* debugTag)
+{
+    mmTrackObjectInternal(tracker, MemoryTrackedKind_VirtualRange, range, debugTag, false);
+}
+
+void mmTrackerBeginFrame(MemoryTracker* tracker)
+{
+    for (u32 i = 0; i < tracker->objectsCount; i++)
+    {
+        MemoryTrackedObject* tracked = tracker->objects + i;
+        if (tracked->kind == MemoryTrackedKind_Stack)
+        {
+            MemoryStack* stack = (MemoryStack*)tracked->object;
+            stack->peakTop = stack->top;
+            tracked->frameStartTop = stack->top;
+            tracked->frameStartPushesCount = stack->pushesCount;
+            tracked->frameStartPushedBytes = stack->pushedBytes;
+        }
+        else if (tracked->kind == MemoryTrackedKind_Pool)
+        {
+            MemoryPool* pool = (MemoryPool*)tracked->object;
+            pool->peakUsedBlocksCount = pool->usedBlocksCount;
+            tracked->frameStartPushesCount = pool->allocationsCount;
+        }
+        else if (tracked->kind == MemoryTrackedKind_ConcurrentStack)
+        {
+            ConcurrentMemoryStack* stack = (ConcurrentMemoryStack*)tracked->object;
+            tracked->frameStartPushesCount = stack->pushesCount;
+            tracked->frameStartPushedBytes = stack->pushedBytes;
+        }
+    }
+}
+
+// NOTE: Ranges only grow during a frame, so their state at the end is also their peak.
+void mmTrackerEndFrame(MemoryTracker* tracker)
+{
+    for (u32 i = 0; i < tracker->tagsCount; i++)
+    {
+        MemoryTagStats* tag = tracker->tags + i;
+        tag->capacity = 0;
+        tag->used = 0;
+        tag->framePeak = 0;
+        tag->framePushesCount = 0;
+        tag->framePushedBytes = 0;
+        tag->frameLeakedBytes = 0;
+    }
+
+    for (u32 i = 0; i < tracker->objectsCount; i++)
+    {
+        MemoryTrackedObject* tracked = tracker->objects + i;
+        MemoryTagStats* tag = tracker->tags + tracked->tagIndex;
+        switch (tracked->kind)
+        {
+            case MemoryTrackedKind_Stack:
+            {
+                MemoryStack* stack = (MemoryStack*)tracked->object;
+                tag->capacity += stack->memorySize;
+                tag->used += stack->top;
+                tag->framePeak += stack->peakTop;
+                tag->framePushesCount += stack->pushesCount - tracked->frameStartPushesCount;
+                tag->framePushedBytes += stack->pushedBytes - tracked->frameStartPushedBytes;
+                if (tracked->frameScoped && stack->top > tracked->frameStartTop)
+                {
+                    tag->frameLeakedBytes += stack->top - tracked->frameStartTop;
+                }
+            } break;
+            case MemoryTrackedKind_ConcurrentStack:
+            {
+                // NOTE: Reserving a chunk does not touch its memory, chunks are reported through what lives in them.
+                ConcurrentMemoryStack* stack = (ConcurrentMemoryStack*)tracked->object;
+                tag->capacity += stack->memorySize;
+                tag->framePushesCount += stack->pushesCount - tracked->frameStartPushesCount;
+                tag->framePushedBytes += stack->pushedBytes - tracked->frameStartPushedBytes;
+            } break;
+            case MemoryTrackedKind_Pool:
+            {
+                MemoryPool* pool = (MemoryPool*)tracked->object;
+                tag->capacity += pool->blockSize * pool->blocksPerSlab * pool->slabsCount;
+                tag->used += pool->blockSize * pool->usedBlocksCount;
+                tag->framePeak += pool->blockSize * pool->peakUsedBlocksCount;
+                tag->framePushesCount += pool->allocationsCount - tracked->frameStartPushesCount;
+                tag->framePushedBytes += pool->blockSize * (pool->allocationsCount - tracked->frameStartPushesCount);
+            } break;
+            case MemoryTrackedKind_VirtualRange:
+            {
+                VirtualMemoryRange* range = (VirtualMemoryRange*)tracked->object;
+                tag->capacity += range->reservedSize;
+                tag->used += range->committedSize;
+                tag->framePeak += range->committedSize;
+            } break;
+            default: { Assert(false); } break;
+        }
+    }
+
+    tracker->peaksChanged = false;
+    tracker->leaksChanged = false;
+    for (u32 i = 0; i < tracker->tagsCount; i++)
+    {
+        MemoryTagStats* tag = tracker->tags + i;
+        if (tag->framePeak > tag->peak)
+        {
+            tag->peak = tag->framePeak;
+            tracker->peaksChanged = true;
+        }
+
+        tag->pushesCount += tag->framePushesCount;
+        tag->pushedBytes += tag->framePushedBytes;
+        if (tag->frameLeakedBytes != 0)
+        {
+            tracker->leaksChanged |= tag->leakingFramesCount == 0;
+            tag->leakingFramesCount++;
+        }
+    }
+
+    tracker->framesCount++;
+}
@@ -11,6 +11,24 @@ typedef struct _MemoryStackMark
     struct _MemoryStackMark* prev;
 } MemoryStackMark;
 
+typedef b32(MemoryCommitFn)(void* memory, uptr size);
+typedef void(MemoryDecommitFn)(void* memory, uptr size);
+
+// NOTE: Reserved address space which is committed in commitGranularity steps as usage grows, only
+// [memory, memory + committedSize) may be touched. Commit and decommit usually come from CoreAPI.
+// A commit past reservedSize or one the system refuses is handled according to failStrategy.
+typedef struct _VirtualMemoryRange
+{
+    AllocationFailStrategy failStrategy;
+    byte* memory;
+    uptr reservedSize;
+    uptr committedSize;
+    uptr commitGranularity;
+    MemoryCommitFn* commit;
+    MemoryDecommitFn* decommit;
+    const char* debugTag;
+} VirtualMemoryRange;
+
 typedef struct
 {
     bool reversed;
@@ -21,19 +39,160 @@ typedef struct
     uptr free;
     MemoryStackMark* lastMark;
     const char* debugTag;
+    // NOTE: Set for growable stacks, pushes commit the pages they reach.
+    VirtualMemoryRange* pages;
+    // NOTE: Never reset by the stack, used for profiling. A MemoryTracker moves peakTop down to top every frame.
+    u64 pushesCount;
+    u64 pushedBytes;
+    uptr peakTop;
 } MemoryStack;
 
+// NOTE: Saved top of a stack, ending the scope rewinds everything pushed after it began.
+// Unlike marks it does not push anything, so scopes cost nothing on scratch stacks.
+typedef struct
+{
+    MemoryStack* stack;
+    uptr top;
+    MemoryStackMark* lastMark;
+} MemoryStackScope;
+
+// NOTE: Forward stack which can be pushed from several threads at once, a push is a single atomic add.
+// Threads which allocate a lot take a chunk with mmConcurrentStackPushChunk and push into it without atomics.
+// Resetting is not thread safe, nobody may push while the stack is being reset.
+typedef struct
+{
+    AllocationFailStrategy failStrategy;
+    void* memory;
+    uptr memorySize;
+    volatile uptr top;
+    const char* debugTag;
+    // NOTE: Never reset by the stack, used for profiling. Only chunks are counted, plain pushes stay a single atomic add.
+    volatile uptr pushesCount;
+    volatile uptr pushedBytes;
+} ConcurrentMemoryStack;
+
+typedef struct _MemoryPoolBlock
+{
+    struct _MemoryPoolBlock* next;
+} MemoryPoolBlock;
+
+// NOTE: Fixed size blocks for objects which are created and destroyed one by one. Blocks come from slabs of
+// blocksPerSlab contiguous blocks pushed from slabStack, alloc and free are O(1) and never touch the OS heap.
+// Freed blocks are reused newest first, a new slab is only pushed once the free list is empty and is handed out
+// in order without threading a free list through it.
+// The pool only gives memory back to slabStack through mmPoolReset followed by rewinding the stack.
+typedef struct
+{
+    AllocationFailStrategy failStrategy;
+    MemoryStack* slabStack;
+    uptr blockSize;
+    uptr blockAlignment;
+    u32 blocksPerSlab;
+    MemoryPoolBlock* freeList;
+    byte* slabCursor;
+    u32 slabBlocksLeft;
+    const char* debugTag;
+    // NOTE: Used for profiling, a MemoryTracker moves peakUsedBlocksCount down to usedBlocksCount every frame.
+    u32 slabsCount;
+    u32 usedBlocksCount;
+    u32 peakUsedBlocksCount;
+    u64 allocationsCount;
+} MemoryPool;
+
+#define MemoryTrackerMaxObjects (128)
+#define MemoryTrackerMaxTags (32)
+
+typedef enum
+{
+    MemoryTrackedKind_Stack,
+    MemoryTrackedKind_ConcurrentStack,
+    MemoryTrackedKind_Pool,
+    MemoryTrackedKind_VirtualRange
+} MemoryTrackedKind;
+
+typedef struct
+{
+    MemoryTrackedKind kind;
+    void* object;
+    u32 tagIndex;
+    // NOTE: Frame scoped stacks have to end every frame at the top they started it with, growth is reported as a leak.
+    b32 frameScoped;
+    uptr frameStartTop;
+    u64 frameStartPushesCount;
+    u64 frameStartPushedBytes;
+} MemoryTrackedObject;
+
+// NOTE: Usage of all tracked objects sharing a debug tag. Stacks measure their top, pools their used blocks and
+// virtual ranges their committed size. Concurrent stacks only add capacity and pushes, the memory in their chunks
+// is measured by whatever is tracked inside them.
+typedef struct
+{
+    const char* debugTag;
+    u32 objectsCount;
+    uptr capacity;
+    uptr used;
+    uptr framePeak;
+    uptr peak;
+    u64 framePushesCount;
+    u64 framePushedBytes;
+    u64 pushesCount;
+    u64 pushedBytes;
+    uptr frameLeakedBytes;
+    u64 leakingFramesCount;
+} MemoryTagStats;
+
+// NOTE: Samples registered stacks and ranges between mmTrackerBeginFrame and mmTrackerEndFrame, nothing is added to the push path
+// except the peak compare. Objects have to stay at the same address while they are tracked.
+// Objects past MemoryTrackerMaxObjects are not tracked and tags past MemoryTrackerMaxTags are folded into "Untracked", both log an error.
+typedef struct
+{
+    MemoryTrackedObject objects[MemoryTrackerMaxObjects];
+    u32 objectsCount;
+    MemoryTagStats tags[MemoryTrackerMaxTags];
+    u32 tagsCount;
+    u64 framesCount;
+    // NOTE: Set by mmTrackerEndFrame when a tag reached a new high-water mark or started leaking.
+    b32 peaksChanged;
+    b32 leaksChanged;
+} MemoryTracker;
+
 bool mmIsPowerOfTwo(uptr n);
 uptr mmAlignAdressUp(uptr address, uptr alignment);
 uptr mmAlignAdressDown(uptr address, uptr alignment);
 
+VirtualMemoryRange mmCreateVirtualRange(void* memory, uptr reservedSize, uptr commitGranularity, MemoryCommitFn* commit, MemoryDecommitFn* decommit, AllocationFailStrategy failStrategy, const char* debugTag);
+bool mmCommitVirtualRange(VirtualMemoryRange* range, uptr size);
+void mmDecommitVirtualRange(VirtualMemoryRange* range, uptr keepSize);
+
 MemoryStack mmCreateStack(void* memory, uptr memorySize, bool reveresed, AllocationFailStrategy failStrategy, const char* debugTag);
+MemoryStack mmCreateGrowableStack(VirtualMemoryRange* pages, AllocationFailStrategy failStrategy, const char* debugTag);
+void mmStackDecommitUnused(MemoryStack* stack);
 void* mmStackPushAligned(MemoryStack* stack, uptr size, uptr alignment);
 void* mmStackPush(MemoryStack* stack, uptr size);
 MemoryStackMark* mmStackSetMark(MemoryStack* stack);
 bool mmStackRewindTo(MemoryStack* stack, MemoryStackMark* mark);
 bool mmStackRewind(MemoryStack* stack);
 void mmStackEnsureAt(MemoryStack* stack, MemoryStackMark* mark);
+MemoryStackScope mmBeginStackScope(MemoryStack* stack);
+void mmEndStackScope(MemoryStackScope scope);
+
+ConcurrentMemoryStack mmCreateConcurrentStack(void* memory, uptr memorySize, AllocationFailStrategy failStrategy, const char* debugTag);
+void* mmConcurrentStackPushAligned(ConcurrentMemoryStack* stack, uptr size, uptr alignment);
+void* mmConcurrentStackPush(ConcurrentMemoryStack* stack, uptr size);
+MemoryStack mmConcurrentStackPushChunk(ConcurrentMemoryStack* stack, uptr size, const char* debugTag);
+void mmConcurrentStackReset(ConcurrentMemoryStack* stack);
+
+MemoryPool mmCreatePool(MemoryStack* slabStack, uptr blockSize, uptr blockAlignment, u32 blocksPerSlab, AllocationFailStrategy failStrategy, const char* debugTag);
+void* mmPoolAlloc(MemoryPool* pool);
+void mmPoolFree(MemoryPool* pool, void* block);
+void mmPoolReset(MemoryPool* pool);
+
+void mmTrackStack(MemoryTracker* tracker, MemoryStack* stack, bool frameScoped);
+void mmTrackConcurrentStack(MemoryTracker* tracker, ConcurrentMemoryStack* stack);
+void mmTrackPool(MemoryTracker* tracker, MemoryPool* pool);
+void mmTrackVirtualRange(MemoryTracker* tracker, VirtualMemoryRange* range, const char* debugTag);
+void mmTrackerBeginFrame(MemoryTracker* tracker);
+void mmTrackerEndFrame(MemoryTracker* tracker);
 
 #define mmCopy(dest, src, size) memcpy(dest, src, size)
 #define mmSet(dest, value, size) memset(dest, value, size)
@@ -94,8 +94,11 @@ int WINAPI wWinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, PWSTR pCmdLine
             WaitForTargetFps(currentTimeStep, context.state.targetFramerate);
         }
     }
+
+    CoreShutdownJobs();
     return 0;
 }
 
 #include "Core.cpp"
 #include "CoreUtilities.cpp"
+#include "CoreJobs.cpp"
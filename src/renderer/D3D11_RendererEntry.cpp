@@ -38,14 +38,18 @@ typedef struct
 
     RenderTargetData screenRenderTarget;
 
-    ID3D11VertexShader* quadVertexShader;
+    ID3D11VertexShader* quadVertexShaders[RenderVertexFormat_Count];
     ID3D11PixelShader* quadPixelShader;
-    ID3D11InputLayout* quadShaderVertLayout;
+    ID3D11InputLayout* quadShaderVertLayouts[RenderVertexFormat_Count];
     ID3D11Buffer* quadCbuffer;
 
-    ID3D11VertexShader* sdfVertexShader;
+    ID3D11VertexShader* lineVertexShader;
+    ID3D11PixelShader* linePixelShader;
+    ID3D11InputLayout* lineShaderInstanceLayout;
+
+    ID3D11VertexShader* sdfVertexShaders[RenderVertexFormat_Count];
     ID3D11PixelShader* sdfPixelShader;
-    ID3D11InputLayout* sdfShaderVertLayout;
+    ID3D11InputLayout* sdfShaderVertLayouts[RenderVertexFormat_Count];
     ID3D11Buffer* sdfCbuffer;
     ID3D11BlendState* sdfBlendState;
 
@@ -273,6 +277,74 @@ void PrintShaderLog(ID3DBlob* logBlob)
     }
 }
 
+static const D3D11_INPUT_ELEMENT_DESC VertexLayoutPositionUvColor[] =
+{
+    {"POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0},
+    {"TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0},
+    {"COLOR", 0, DXGI_FORMAT_R8G8B8A8_UNORM, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0},
+};
+
+static const D3D11_INPUT_ELEMENT_DESC VertexLayoutPosition2DColor[] =
+{
+    {"POSITION", 0, DXGI_FORMAT_R32G32_FLOAT, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0},
+    {"COLOR", 0, DXGI_FORMAT_R8G8B8A8_UNORM, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0},
+};
+
+static const D3D11_INPUT_ELEMENT_DESC VertexLayoutPosition2DUv16Color[] =
+{
+    {"POSITION", 0, DXGI_FORMAT_R32G32_FLOAT, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0},
+    {"TEXCOORD", 0, DXGI_FORMAT_R16G16_UNORM, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0},
+    {"COLOR", 0, DXGI_FORMAT_R8G8B8A8_UNORM, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0},
+};
+
+struct VertexFormatShaderDesc
+{
+    const char* entryPoint;
+    const D3D11_INPUT_ELEMENT_DESC* layout;
+    u32 layoutCount;
+};
+
+// NOTE: Indexed by RenderVertexFormat. Every shader used for mesh drawing has an entry point per vertex format.
+static const VertexFormatShaderDesc VertexFormatShaders[RenderVertexFormat_Count] =
+{
+    { "Vertex", VertexLayoutPositionUvColor, ArrayCount(VertexLayoutPositionUvColor) },
+    { "Vertex2D", VertexLayoutPosition2DColor, ArrayCount(VertexLayoutPosition2DColor) },
+    { "Vertex2DUv16", VertexLayoutPosition2DUv16Color, ArrayCount(VertexLayoutPosition2DUv16Color) },
+};
+
+ID3D11PixelShader* CreateVertexFormatShadersFromFile(RendererContext* renderer, LPCWSTR filename, ID3D11VertexShader** vertexShaders, ID3D11InputLayout** layouts)
+{
+    ID3D11PixelShader* pixelShader = NULL;
+
+    for (u32 format = 0; format < RenderVertexFormat_Count; format++)
+    {
+        const VertexFormatShaderDesc* desc = VertexFormatShaders + format;
+
+        CompiledShader shader = CreateShaderFromFile(renderer, filename, desc->entryPoint, "Pixel");
+        PrintShaderLog(shader.vertexCompilationLog);
+        PrintShaderLog(shader.pixelCompilationLog);
+
+        if (shader.vertexShader == NULL || shader.pixelShader == NULL)
+        {
+            Assert(false);
+        }
+
+        vertexShaders[format] = shader.vertexShader;
+        Win32Call(renderer->device->CreateInputLayout(desc->layout, desc->layoutCount, shader.vertexShaderBinary->GetBufferPointer(), shader.vertexShaderBinary->GetBufferSize(), layouts + format));
+
+        if (pixelShader == NULL)
+        {
+            pixelShader = shader.pixelShader;
+        }
+        else
+        {
+            shader.pixelShader->Release();
+        }
+    }
+
+    return pixelShader;
+}
+
 void ReleaseRenderTarget(RenderTargetData* rt)
 {
     if (rt->colorTexture != NULL)
@@ -450,29 +522,20 @@ DisplayParams CreateContextD3D11(HWND hwnd, DisplayParams intialDisplayParams)
 
     renderer->screenRenderTarget = CreateScreenRT(renderer, displayMode.Width, displayMode.Height);
 
-    CompiledShader quadShader = CreateShaderFromFile(renderer, L"../../assets/shaders/d3d11/Quad.hlsl", "Vertex", "Pixel");
-    PrintShaderLog(quadShader.vertexCompilationLog);
-    PrintShaderLog(quadShader.pixelCompilationLog);
+    renderer->quadPixelShader = CreateVertexFormatShadersFromFile(renderer, L"../../assets/shaders/d3d11/Quad.hlsl", renderer->quadVertexShaders, renderer->quadShaderVertLayouts);
+    renderer->sdfPixelShader = CreateVertexFormatShadersFromFile(renderer, L"../../assets/shaders/d3d11/TextSDF.hlsl", renderer->sdfVertexShaders, renderer->sdfShaderVertLayouts);
 
-    if (quadShader.vertexShader == NULL || quadShader.pixelShader == NULL)
-    {
-        Assert(false);
-    }
-
-    renderer->quadVertexShader = quadShader.vertexShader;
-    renderer->quadPixelShader = quadShader.pixelShader;
-
-    CompiledShader sdfShader = CreateShaderFromFile(renderer, L"../../assets/shaders/d3d11/TextSDF.hlsl", "Vertex", "Pixel");
-    PrintShaderLog(sdfShader.vertexCompilationLog);
-    PrintShaderLog(sdfShader.pixelCompilationLog);
+    CompiledShader lineShader = CreateShaderFromFile(renderer, L"../../assets/shaders/d3d11/Line.hlsl", "Vertex", "Pixel");
+    PrintShaderLog(lineShader.vertexCompilationLog);
+    PrintShaderLog(lineShader.pixelCompilationLog);
 
-    if (sdfShader.vertexShader == NULL || sdfShader.pixelShader == NULL)
+    if (lineShader.vertexShader == NULL || lineShader.pixelShader == NULL)
     {
         Assert(false);
     }
 
-    renderer->sdfVertexShader = sdfShader.vertexShader;
-    renderer->sdfPixelShader = sdfShader.pixelShader;
+    renderer->lineVertexShader = lineShader.vertexShader;
+    renderer->linePixelShader = lineShader.pixelShader;
 
     CompiledShader blitShader = CreateShaderFromFile(renderer, L"../../assets/shaders/d3d11/Blit.hlsl", "Vertex", "Pixel");
     PrintShaderLog(blitShader.vertexCompilationLog);
@@ -487,16 +550,14 @@ DisplayParams CreateContextD3D11(HWND hwnd, DisplayParams intialDisplayParams)
     renderer->blitPixelShader = blitShader.pixelShader;
 
 
-    D3D11_INPUT_ELEMENT_DESC layoutDesc[] =
-        {
-            {"POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0},
-            {"TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0},
-            {"COLOR", 0, DXGI_FORMAT_R8G8B8A8_UNORM, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0},
-        };
-
-    Win32Call(renderer->device->CreateInputLayout(layoutDesc, ArrayCount(layoutDesc), quadShader.vertexShaderBinary->GetBufferPointer(), quadShader.vertexShaderBinary->GetBufferSize(), &(renderer->quadShaderVertLayout)));
+    D3D11_INPUT_ELEMENT_DESC lineLayoutDesc[] =
+    {
+        {"SEGMENT", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, 0, D3D11_INPUT_PER_INSTANCE_DATA, 1},
+        {"THICKNESS", 0, DXGI_FORMAT_R32_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_INSTANCE_DATA, 1},
+        {"COLOR", 0, DXGI_FORMAT_R8G8B8A8_UNORM, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_INSTANCE_DATA, 1},
+    };
 
-    Win32Call(renderer->device->CreateInputLayout(layoutDesc, ArrayCount(layoutDesc), sdfShader.vertexShaderBinary->GetBufferPointer(), sdfShader.vertexShaderBinary->GetBufferSize(), &(renderer->sdfShaderVertLayout)));
+    Win32Call(renderer->device->CreateInputLayout(lineLayoutDesc, ArrayCount(lineLayoutDesc), lineShader.vertexShaderBinary->GetBufferPointer(), lineShader.vertexShaderBinary->GetBufferSize(), &(renderer->lineShaderInstanceLayout)));
 
     D3D11_INPUT_ELEMENT_DESC blitLayoutDesc[] =
     {
@@ -873,9 +934,12 @@ void ExecuteCommand_DrawMeshImmediate(RenderCommandEntry* entry)
 {
     RendererContext* renderer = GetRendererContext();
 
+    RenderVertexFormat vertexFormat = entry->drawMeshImmediate.vertexFormat;
+    UINT vertexStride = GetVertexFormatStride(vertexFormat);
+
     D3D11_BUFFER_DESC vertBufferDesc = {0};
     vertBufferDesc.Usage = D3D11_USAGE_IMMUTABLE;
-    vertBufferDesc.ByteWidth = entry->drawMeshImmediate.vertexCount * sizeof(RenderVertex);
+    vertBufferDesc.ByteWidth = entry->drawMeshImmediate.vertexCount * vertexStride;
     vertBufferDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
     vertBufferDesc.CPUAccessFlags = 0;
     vertBufferDesc.MiscFlags = 0;
@@ -890,7 +954,7 @@ void ExecuteCommand_DrawMeshImmediate(RenderCommandEntry* entry)
 
     D3D11_BUFFER_DESC indexBufferDesc = {0};
     indexBufferDesc.Usage = D3D11_USAGE_IMMUTABLE;
-    indexBufferDesc.ByteWidth = entry->drawMeshImmediate.indexCount * sizeof(u32);
+    indexBufferDesc.ByteWidth = entry->drawMeshImmediate.indexCount * GetIndexFormatSize(entry->drawMeshImmediate.indexFormat);
     indexBufferDesc.BindFlags = D3D11_BIND_INDEX_BUFFER;
     indexBufferDesc.CPUAccessFlags = 0;
     indexBufferDesc.MiscFlags = 0;
@@ -902,6 +966,7 @@ void ExecuteCommand_DrawMeshImmediate(RenderCommandEntry* entry)
 
     ID3D11Buffer* indexBuffer;
     Win32Call(renderer->device->CreateBuffer(&indexBufferDesc, &indexDataDesc, &indexBuffer));
+    DXGI_FORMAT indexFormat = entry->drawMeshImmediate.indexFormat == RenderIndexFormat_U16 ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT;
     
     if (renderer->lastMaterialCommand->setMaterial.type == RenderMaterialType_Texture)
     {
@@ -912,16 +977,15 @@ void ExecuteCommand_DrawMeshImmediate(RenderCommandEntry* entry)
         renderer->deviceContext->Unmap(renderer->quadCbuffer, 0);
 
         UINT offset = 0;
-        UINT stride = sizeof(RenderVertex);
 
         renderer->deviceContext->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-        renderer->deviceContext->IASetInputLayout(renderer->quadShaderVertLayout);
-        renderer->deviceContext->IASetVertexBuffers(0, 1, &vertexBuffer, &stride, &offset);
-        renderer->deviceContext->IASetIndexBuffer(indexBuffer, DXGI_FORMAT_R32_UINT, 0);
+        renderer->deviceContext->IASetInputLayout(renderer->quadShaderVertLayouts[vertexFormat]);
+        renderer->deviceContext->IASetVertexBuffers(0, 1, &vertexBuffer, &vertexStride, &offset);
+        renderer->deviceContext->IASetIndexBuffer(indexBuffer, indexFormat, 0);
 
         renderer->deviceContext->RSSetState(renderer->rasterizerState);
 
-        renderer->deviceContext->VSSetShader(renderer->quadVertexShader, nullptr, 0);
+        renderer->deviceContext->VSSetShader(renderer->quadVertexShaders[vertexFormat], nullptr, 0);
         renderer->deviceContext->VSSetConstantBuffers(0, 1, &renderer->quadCbuffer);
 
         renderer->deviceContext->PSSetShader(renderer->quadPixelShader, nullptr, 0);
@@ -945,16 +1009,15 @@ void ExecuteCommand_DrawMeshImmediate(RenderCommandEntry* entry)
         renderer->deviceContext->Unmap(renderer->sdfCbuffer, 0);
 
         UINT offset = 0;
-        UINT stride = sizeof(RenderVertex);
 
         renderer->deviceContext->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-        renderer->deviceContext->IASetInputLayout(renderer->sdfShaderVertLayout);
-        renderer->deviceContext->IASetVertexBuffers(0, 1, &vertexBuffer, &stride, &offset);
-        renderer->deviceContext->IASetIndexBuffer(indexBuffer, DXGI_FORMAT_R32_UINT, 0);
+        renderer->deviceContext->IASetInputLayout(renderer->sdfShaderVertLayouts[vertexFormat]);
+        renderer->deviceContext->IASetVertexBuffers(0, 1, &vertexBuffer, &vertexStride, &offset);
+        renderer->deviceContext->IASetIndexBuffer(indexBuffer, indexFormat, 0);
 
         renderer->deviceContext->RSSetState(renderer->rasterizerState);
 
-        renderer->deviceContext->VSSetShader(renderer->sdfVertexShader, nullptr, 0);
+        renderer->deviceContext->VSSetShader(renderer->sdfVertexShaders[vertexFormat], nullptr, 0);
         renderer->deviceContext->VSSetConstantBuffers(0, 1, &renderer->sdfCbuffer);
 
         renderer->deviceContext->PSSetShader(renderer->sdfPixelShader, nullptr, 0);
@@ -980,6 +1043,69 @@ void ExecuteCommand_DrawMeshImmediate(RenderCommandEntry* entry)
     indexBuffer->Release();
 }
 
+// NOTE: Segments are uploaded as-is and expanded to quads in Line.hlsl, one instance per segment.
+void ExecuteCommand_DrawLineSegments(RenderCommandEntry* entry)
+{
+    RendererContext* renderer = GetRendererContext();
+
+    if (entry->drawLineSegments.segmentCount == 0)
+    {
+        return;
+    }
+
+    // NOTE: Line shader only knows how to sample a texture.
+    Assert(renderer->lastMaterialCommand->setMaterial.type == RenderMaterialType_Texture);
+
+    D3D11_BUFFER_DESC instanceBufferDesc = {0};
+    instanceBufferDesc.Usage = D3D11_USAGE_IMMUTABLE;
+    instanceBufferDesc.ByteWidth = entry->drawLineSegments.segmentCount * sizeof(RenderLineSegment);
+    instanceBufferDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+    instanceBufferDesc.CPUAccessFlags = 0;
+    instanceBufferDesc.MiscFlags = 0;
+
+    D3D11_SUBRESOURCE_DATA instanceDataDesc = {};
+    instanceDataDesc.pSysMem = entry->drawLineSegments.segments;
+    instanceDataDesc.SysMemPitch = 0;
+    instanceDataDesc.SysMemSlicePitch = 0;
+
+    ID3D11Buffer* instanceBuffer;
+    Win32Call(renderer->device->CreateBuffer(&instanceBufferDesc, &instanceDataDesc, &instanceBuffer));
+
+    D3D11_MAPPED_SUBRESOURCE mapping;
+    renderer->deviceContext->Map(renderer->quadCbuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mapping);
+    QuadConstantBufferLayout* constants = (QuadConstantBufferLayout*)mapping.pData;
+    constants->transform = *entry->drawLineSegments.transform;
+    renderer->deviceContext->Unmap(renderer->quadCbuffer, 0);
+
+    UINT offset = 0;
+    UINT stride = sizeof(RenderLineSegment);
+
+    renderer->deviceContext->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+    renderer->deviceContext->IASetInputLayout(renderer->lineShaderInstanceLayout);
+    renderer->deviceContext->IASetVertexBuffers(0, 1, &instanceBuffer, &stride, &offset);
+    renderer->deviceContext->IASetIndexBuffer(NULL, DXGI_FORMAT_UNKNOWN, 0);
+
+    renderer->deviceContext->RSSetState(renderer->rasterizerState);
+
+    renderer->deviceContext->VSSetShader(renderer->lineVertexShader, nullptr, 0);
+    renderer->deviceContext->VSSetConstantBuffers(0, 1, &renderer->quadCbuffer);
+
+    renderer->deviceContext->PSSetShader(renderer->linePixelShader, nullptr, 0);
+
+    ID3D11ShaderResourceView* textureSRV = (ID3D11ShaderResourceView*)renderer->lastMaterialCommand->setMaterial.textureId.data1;
+    ID3D11SamplerState* samplerState = (ID3D11SamplerState*)renderer->lastMaterialCommand->setMaterial.sampler.data0;
+
+    renderer->deviceContext->PSSetShaderResources(0, 1, &textureSRV);
+    renderer->deviceContext->PSSetSamplers(0, 1, &samplerState);
+
+    renderer->deviceContext->OMSetDepthStencilState(renderer->depthStencilState, 0);
+    renderer->deviceContext->OMSetBlendState(nullptr, nullptr, 0xffffffff);
+
+    renderer->deviceContext->DrawInstanced(6, entry->drawLineSegments.segmentCount, 0, 0);
+
+    instanceBuffer->Release();
+}
+
 void ExecuteCommand_SetMaterial(RenderCommandEntry* entry)
 {
     RendererContext* renderer = GetRendererContext();
@@ -996,6 +1122,7 @@ void ExecuteCommandBuffer(RenderCommandBuffer* buffer)
         case RenderCommand_Clear: { ExecuteCommand_Clear(entry); } break;
         case RenderCommand_DrawMeshImmediate: { ExecuteCommand_DrawMeshImmediate(entry); } break;
         case RenderCommand_SetMaterial: { ExecuteCommand_SetMaterial(entry); } break;
+        case RenderCommand_DrawLineSegments: { ExecuteCommand_DrawLineSegments(entry); } break;
         default: { Log_Error("Unknown render command!\n"); } break; // TODO: provide name via refelction.
         }
     }
@@ -0,0 +1,389 @@
+#include "RendererAPI.h"
+#include "../Logging.h"
+#include "../core/CoreAPI.h"
+
+#include <stdarg.h>
+
+// NOTE: Renderer backend which does not talk to any GPU. It walks the command buffer,
+// validates it and gathers statistics. Used for headless runs where we only care about
+// the cost of generating frames.
+
+#define NULL_RENDERER_MAX_TEXTURES 1024
+#define NULL_RENDERER_MAX_REPORTED_ERRORS 16
+
+typedef struct
+{
+    b32 used;
+    u32 width;
+    u32 height;
+    TextureFormat format;
+} NullTexture;
+
+typedef struct
+{
+    CoreState* core;
+    DisplayParams displayParams;
+    VSyncMode vsyncMode;
+    Vector2 viewportMin;
+    Vector2 viewportDimensions;
+
+    b32 validateCommands;
+    u32 reportedErrorsCount;
+
+    u32 samplersCount;
+    NullTexture textures[NULL_RENDERER_MAX_TEXTURES];
+
+    RenderCommandEntry* lastMaterialCommand;
+
+    RenderFrameStats frameStats;
+    RenderFrameStats totalStats;
+} RendererContext;
+
+static int Initialized = 0;
+static RendererAPI GlobalApi;
+static RendererContext GlobalRendererContext;
+
+static RendererContext* GetRendererContext()
+{
+    return &GlobalRendererContext;
+}
+
+static void _WriteLog(CoreLogLevel logLevel, const char* tags, u32 tagsCount, const char* format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    RendererContext* context = GetRendererContext();
+    context->core->coreAPI.WriteLog(logLevel, tags, tagsCount, format, args);
+    va_end(args);
+}
+
+#define Log_Error(format, ...) _WriteLog(CoreLogLevel_Error, "NullRenderer", 0, format, ##__VA_ARGS__)
+#define Log_Info(format, ...) _WriteLog(CoreLogLevel_Info, "NullRenderer", 0, format, ##__VA_ARGS__)
+#define Assert(x) assert(x) // TODO: Core assert
+
+static void ReportValidationError(RendererContext* renderer, u32 commandIndex, const char* message)
+{
+    renderer->frameStats.validationErrorsCount++;
+
+    if (renderer->reportedErrorsCount < NULL_RENDERER_MAX_REPORTED_ERRORS)
+    {
+        Log_Error("Command %lu: %s\n", commandIndex, message);
+        renderer->reportedErrorsCount++;
+    }
+}
+
+static NullTexture* GetTexture(RendererContext* renderer, TextureDescriptor id)
+{
+    if (id.data0 == 0 || id.data0 > NULL_RENDERER_MAX_TEXTURES)
+    {
+        return NULL;
+    }
+
+    NullTexture* texture = renderer->textures + (id.data0 - 1);
+    return texture->used ? texture : NULL;
+}
+
+static DisplayParams SetDisplayParams(DisplayParams displayParams)
+{
+    RendererContext* renderer = GetRendererContext();
+    renderer->displayParams = displayParams;
+    return displayParams;
+}
+
+static void SetVsyncMode(VSyncMode mode)
+{
+    RendererContext* renderer = GetRendererContext();
+    renderer->vsyncMode = mode;
+}
+
+static void SwapScreenBuffers()
+{
+}
+
+static void SetViewport(Vector2 min, Vector2 dimensions)
+{
+    RendererContext* renderer = GetRendererContext();
+    renderer->viewportMin = min;
+    renderer->viewportDimensions = dimensions;
+}
+
+static SamplerDescriptor CreateSampler(TextureSamplerSettings sampler)
+{
+    RendererContext* renderer = GetRendererContext();
+
+    SamplerDescriptor result = {};
+    result.data0 = ++renderer->samplersCount;
+    return result;
+}
+
+static Texture2D LoadTexture2D(u32 width, u32 height, TextureFormat format, void* data, uptr dataSize)
+{
+    RendererContext* renderer = GetRendererContext();
+
+    Texture2D result = {};
+
+    for (u32 i = 0; i < NULL_RENDERER_MAX_TEXTURES; i++)
+    {
+        NullTexture* texture = renderer->textures + i;
+        if (!texture->used)
+        {
+            texture->used = true;
+            texture->width = width;
+            texture->height = height;
+            texture->format = format;
+
+            result.id.data0 = i + 1;
+            result.width = width;
+            result.height = height;
+            result.format = format;
+            break;
+        }
+    }
+
+    if (result.id.data0 == 0)
+    {
+        Log_Error("Out of texture slots\n");
+    }
+
+    return result;
+}
+
+static void UnloadTexture2D(TextureDescriptor id)
+{
+    RendererContext* renderer = GetRendererContext();
+
+    NullTexture* texture = GetTexture(renderer, id);
+    if (texture != NULL)
+    {
+        texture->used = false;
+    }
+}
+
+static void BeginFrame()
+{
+    RendererContext* renderer = GetRendererContext();
+    renderer->frameStats = {};
+    renderer->lastMaterialCommand = NULL;
+}
+
+static void EndFrame()
+{
+    RendererContext* renderer = GetRendererContext();
+
+    renderer->frameStats.framesCount = 1;
+
+    RenderFrameStats* total = &renderer->totalStats;
+    RenderFrameStats* frame = &renderer->frameStats;
+    total->framesCount += frame->framesCount;
+    total->commandsCount += frame->commandsCount;
+    total->clearCount += frame->clearCount;
+    total->setMaterialCount += frame->setMaterialCount;
+    total->drawCount += frame->drawCount;
+    total->verticesCount += frame->verticesCount;
+    total->vertexBytesCount += frame->vertexBytesCount;
+    total->indicesCount += frame->indicesCount;
+    total->indexBytesCount += frame->indexBytesCount;
+    total->segmentsCount += frame->segmentsCount;
+    total->validationErrorsCount += frame->validationErrorsCount;
+}
+
+static void ExecuteCommand_Clear(RendererContext* renderer, RenderCommandEntry* entry, u32 commandIndex)
+{
+    renderer->frameStats.clearCount++;
+
+    if (renderer->validateCommands)
+    {
+        if ((entry->clear.flags & (RenderClearFlags_Color | RenderClearFlags_Depth)) == 0)
+        {
+            ReportValidationError(renderer, commandIndex, "Clear command without any flags");
+        }
+    }
+}
+
+static void ExecuteCommand_SetMaterial(RendererContext* renderer, RenderCommandEntry* entry, u32 commandIndex)
+{
+    renderer->frameStats.setMaterialCount++;
+    renderer->lastMaterialCommand = entry;
+
+    if (renderer->validateCommands)
+    {
+        if (entry->setMaterial.type != RenderMaterialType_Texture && entry->setMaterial.type != RenderMaterialType_TextSDF)
+        {
+            ReportValidationError(renderer, commandIndex, "Unknown material type");
+        }
+
+        if (GetTexture(renderer, entry->setMaterial.textureId) == NULL)
+        {
+            ReportValidationError(renderer, commandIndex, "Material references a texture which is not loaded");
+        }
+
+        if (entry->setMaterial.sampler.data0 == 0 || entry->setMaterial.sampler.data0 > renderer->samplersCount)
+        {
+            ReportValidationError(renderer, commandIndex, "Material references an invalid sampler");
+        }
+    }
+}
+
+static void ExecuteCommand_DrawMeshImmediate(RendererContext* renderer, RenderCommandEntry* entry, u32 commandIndex)
+{
+    u32 vertexCount = entry->drawMeshImmediate.vertexCount;
+    u32 indexCount = entry->drawMeshImmediate.indexCount;
+
+    renderer->frameStats.drawCount++;
+    renderer->frameStats.verticesCount += vertexCount;
+    renderer->frameStats.vertexBytesCount += (u64)vertexCount * GetVertexFormatStride(entry->drawMeshImmediate.vertexFormat);
+    renderer->frameStats.indicesCount += indexCount;
+    renderer->frameStats.indexBytesCount += (u64)indexCount * GetIndexFormatSize(entry->drawMeshImmediate.indexFormat);
+
+    if (renderer->validateCommands)
+    {
+        if (renderer->lastMaterialCommand == NULL)
+        {
+            ReportValidationError(renderer, commandIndex, "Draw command issued before any material was set");
+        }
+
+        if (entry->drawMeshImmediate.transform == NULL)
+        {
+            ReportValidationError(renderer, commandIndex, "Draw command without transform");
+        }
+
+        if ((u32)entry->drawMeshImmediate.vertexFormat >= RenderVertexFormat_Count)
+        {
+            ReportValidationError(renderer, commandIndex, "Unknown vertex format");
+            return;
+        }
+
+        if (entry->drawMeshImmediate.vertexFormat == RenderVertexFormat_Position2DColor && renderer->lastMaterialCommand != NULL && renderer->lastMaterialCommand->setMaterial.type == RenderMaterialType_TextSDF)
+        {
+            ReportValidationError(renderer, commandIndex, "Text SDF material requires a vertex format with uv");
+        }
+
+        if ((indexCount % 3) != 0)
+        {
+            ReportValidationError(renderer, commandIndex, "Index count is not a multiple of 3");
+        }
+
+        if ((vertexCount > 0 && entry->drawMeshImmediate.vertices == NULL) || (indexCount > 0 && entry->drawMeshImmediate.indices == NULL))
+        {
+            ReportValidationError(renderer, commandIndex, "Draw command has no vertex or index data");
+            return;
+        }
+
+        if (entry->drawMeshImmediate.indexFormat == RenderIndexFormat_U16 && vertexCount > 0x10000)
+        {
+            ReportValidationError(renderer, commandIndex, "Vertex count exceeds the range of 16 bit indices");
+        }
+
+        for (u32 i = 0; i < indexCount; i++)
+        {
+            if (GetRenderIndex(entry->drawMeshImmediate.indices, entry->drawMeshImmediate.indexFormat, i) >= vertexCount)
+            {
+                ReportValidationError(renderer, commandIndex, "Index is out of vertex buffer bounds");
+                break;
+            }
+        }
+    }
+}
+
+static void ExecuteCommand_DrawLineSegments(RendererContext* renderer, RenderCommandEntry* entry, u32 commandIndex)
+{
+    u32 segmentCount = entry->drawLineSegments.segmentCount;
+
+    renderer->frameStats.drawCount++;
+    renderer->frameStats.segmentsCount += segmentCount;
+
+    if (renderer->validateCommands)
+    {
+        if (renderer->lastMaterialCommand == NULL)
+        {
+            ReportValidationError(renderer, commandIndex, "Draw command issued before any material was set");
+        }
+        else if (renderer->lastMaterialCommand->setMaterial.type != RenderMaterialType_Texture)
+        {
+            ReportValidationError(renderer, commandIndex, "Line segments require a texture material");
+        }
+
+        if (entry->drawLineSegments.transform == NULL)
+        {
+            ReportValidationError(renderer, commandIndex, "Draw command without transform");
+        }
+
+        if (segmentCount > 0 && entry->drawLineSegments.segments == NULL)
+        {
+            ReportValidationError(renderer, commandIndex, "Draw command has no segment data");
+            return;
+        }
+
+        RenderLineSegment* segments = entry->drawLineSegments.segments;
+        for (u32 i = 0; i < segmentCount; i++)
+        {
+            // NOTE: Negated compare also catches NaN.
+            if (!(segments[i].thickness >= 0.0f))
+            {
+                ReportValidationError(renderer, commandIndex, "Line segment has invalid thickness");
+                break;
+            }
+        }
+    }
+}
+
+static void ExecuteCommandBuffer(RenderCommandBuffer* buffer)
+{
+    RendererContext* renderer = GetRendererContext();
+
+    renderer->frameStats.commandsCount += buffer->renderCommandsCount;
+
+    for (u32 i = 0; i < buffer->renderCommandsCount; i++)
+    {
+        RenderCommandEntry* entry = buffer->commands + i;
+        switch(entry->command)
+        {
+        case RenderCommand_Clear: { ExecuteCommand_Clear(renderer, entry, i); } break;
+        case RenderCommand_DrawMeshImmediate: { ExecuteCommand_DrawMeshImmediate(renderer, entry, i); } break;
+        case RenderCommand_SetMaterial: { ExecuteCommand_SetMaterial(renderer, entry, i); } break;
+        case RenderCommand_DrawLineSegments: { ExecuteCommand_DrawLineSegments(renderer, entry, i); } break;
+        default: { ReportValidationError(renderer, i, "Unknown render command"); } break;
+        }
+    }
+}
+
+static void InitializeApi(RendererAPI* api)
+{
+    api->SetDisplayParams = SetDisplayParams;
+    api->SetVsyncMode = SetVsyncMode;
+    api->SwapScreenBuffers = SwapScreenBuffers;
+    api->SetViewport = SetViewport;
+    api->ExecuteCommandBuffer = ExecuteCommandBuffer;
+    api->LoadTexture2D = LoadTexture2D;
+    api->CreateSampler = CreateSampler;
+    api->UnloadTexture2D = UnloadTexture2D;
+    api->BeginFrame = BeginFrame;
+    api->EndFrame = EndFrame;
+}
+
+RendererAPI* InitializeRenderer_Null(CoreState* coreContext, DisplayParams desiredDisplayParams, DisplayParams* actualDisplayParams, b32 validateCommands)
+{
+    if (Initialized == 0)
+    {
+        RendererContext* context = GetRendererContext();
+        context->core = coreContext;
+        context->displayParams = desiredDisplayParams;
+        context->validateCommands = validateCommands;
+        InitializeApi(&GlobalApi);
+        Initialized = 1;
+    }
+
+    RendererContext* renderer = GetRendererContext();
+    *actualDisplayParams = renderer->displayParams;
+    return &GlobalApi;
+}
+
+RenderFrameStats NullRendererGetFrameStats()
+{
+    return GetRendererContext()->frameStats;
+}
+
+RenderFrameStats NullRendererGetTotalStats()
+{
+    return GetRendererContext()->totalStats;
+}
@@ -28,7 +28,8 @@ typedef enum
 {
     RenderCommand_Clear,
     RenderCommand_DrawMeshImmediate,
-    RenderCommand_SetMaterial
+    RenderCommand_SetMaterial,
+    RenderCommand_DrawLineSegments
 } RenderCommand;
 
 typedef enum
@@ -37,6 +38,18 @@ typedef enum
     RenderClearFlags_Depth = 0x2
 } RenderClearFlags;
 
+typedef enum
+{
+    // RenderVertex
+    RenderVertexFormat_PositionUvColor,
+    // RenderVertex2D, for untextured geometry such as paths. z is 0.5, uv is 0.
+    RenderVertexFormat_Position2DColor,
+    // RenderVertex2DUv16, for glyphs and images. uv is unorm16, z is 0.5.
+    RenderVertexFormat_Position2DUv16Color,
+
+    RenderVertexFormat_Count
+} RenderVertexFormat;
+
 typedef struct
 {
     Vector3 position;
@@ -44,6 +57,56 @@ typedef struct
     u32 vertexColor;
 } RenderVertex;
 
+typedef struct
+{
+    Vector2 position;
+    u32 vertexColor;
+} RenderVertex2D;
+
+typedef struct
+{
+    Vector2 position;
+    u16 uv[2];
+    u32 vertexColor;
+} RenderVertex2DUv16;
+
+inline u32 GetVertexFormatStride(RenderVertexFormat format)
+{
+    switch (format)
+    {
+    case RenderVertexFormat_PositionUvColor: return sizeof(RenderVertex);
+    case RenderVertexFormat_Position2DColor: return sizeof(RenderVertex2D);
+    case RenderVertexFormat_Position2DUv16Color: return sizeof(RenderVertex2DUv16);
+    default: return 0;
+    }
+}
+
+typedef enum
+{
+    RenderIndexFormat_U32,
+    RenderIndexFormat_U16
+} RenderIndexFormat;
+
+inline u32 GetIndexFormatSize(RenderIndexFormat format)
+{
+    return format == RenderIndexFormat_U16 ? sizeof(u16) : sizeof(u32);
+}
+
+inline u32 GetRenderIndex(void* indices, RenderIndexFormat format, u32 i)
+{
+    return format == RenderIndexFormat_U16 ? ((u16*)indices)[i] : ((u32*)indices)[i];
+}
+
+// NOTE: Backends expand every segment to a quad with corners p1 + n, p2 + n, p2 - n, p1 - n,
+// where n = {dy, -dx} * thickness / 2 for the normalized direction d = p2 - p1.
+typedef struct
+{
+    Vector2 p1;
+    Vector2 p2;
+    f32 thickness;
+    u32 color;
+} RenderLineSegment;
+
 typedef enum
 {
     TextureFormat_R8,
@@ -91,17 +154,28 @@ typedef enum
 typedef struct
 {
     RenderCommand command;
+    // NOTE: Only meaningful for draw commands, used to reorder them before submission. Backends ignore it.
+    u64 sortKey;
     union
     {
         struct
         {
             u32 vertexCount;
             u32 indexCount;
-            RenderVertex* vertices;
-            u32* indices;
+            RenderVertexFormat vertexFormat;
+            RenderIndexFormat indexFormat;
+            void* vertices;
+            void* indices;
             Matrix4x4* transform; // TODO: Store it in appropriate place.
         } drawMeshImmediate;
 
+        struct
+        {
+            u32 segmentCount;
+            RenderLineSegment* segments;
+            Matrix4x4* transform;
+        } drawLineSegments;
+
         struct
         {
             Vector4 color;
@@ -124,6 +198,15 @@ typedef struct
 {
     u32 renderCommandsCount;
     RenderCommandEntry* commands;
+    // NOTE: Recording state, backends ignore it. When mergeCommands is set the rcmd* functions drop
+    // SetMaterial commands equal to the active material and append draws to the previous one when possible.
+    b32 mergeCommands;
+    u32 activeMaterialIndex;
+    // Layer and depth which go into the sort keys of recorded draws.
+    u32 sortLayer;
+    f32 sortDepth;
+    // NOTE: Optional, commands live in reserved address space which is committed as the buffer grows.
+    struct _VirtualMemoryRange* commandPages;
 } RenderCommandBuffer;
 
 typedef struct metaprogram_visible attribute(RendererAPI)
@@ -144,5 +227,27 @@ typedef struct metaprogram_visible attribute(RendererAPI)
 #define OPENGL_RENDERER_INITIALIZE_PROC_NAME "InitializeRenderer_OpenGL"
 typedef RendererAPI*(InitializeRendererOpenGLProc)(void* coreState, void* procLoaderProc);
 
+typedef struct
+{
+    u32 framesCount;
+    u32 commandsCount;
+    u32 clearCount;
+    u32 setMaterialCount;
+    u32 drawCount;
+    u64 verticesCount;
+    u64 vertexBytesCount;
+    u64 indicesCount;
+    u64 indexBytesCount;
+    u64 segmentsCount;
+    u32 validationErrorsCount;
+} RenderFrameStats;
+
 #define D3D11_RENDERER_INITIALIZE_PROC_NAME "InitializeRenderer_D3D11"
 typedef RendererAPI*(InitializeRendererD3D11Proc)(void* coreState, uptr hwnd, DisplayParams desiredDisplayParams, DisplayParams* actualDisplayParams, struct ID3D11Device** device, struct ID3D11DeviceContext** deviceContext);
+
+#define NULL_RENDERER_INITIALIZE_PROC_NAME "InitializeRenderer_Null"
+typedef RendererAPI*(InitializeRendererNullProc)(void* coreState, DisplayParams desiredDisplayParams, DisplayParams* actualDisplayParams, b32 validateCommands);
+
+#define SOFTWARE_RENDERER_INITIALIZE_PROC_NAME "InitializeRenderer_Software"
+// NOTE: Rasterizes on the core job threads, CoreInitJobs must run first.
+typedef RendererAPI*(InitializeRendererSoftwareProc)(void* coreState, DisplayParams desiredDisplayParams, DisplayParams* actualDisplayParams);
@@ -0,0 +1,1191 @@
+#include "RendererAPI.h"
+#include "../Logging.h"
+#include "../core/CoreAPI.h"
+
+#include <stdarg.h>
+#include <string.h>
+
+
+// NOTE: CPU reference renderer. Executes the command buffer into an sRGB RGBA8
+// framebuffer, mimicking what the D3D11 backend and its shaders do:
+//  * Triangles are set up and binned to screen tiles in parallel, then every tile
+//    is rasterized by one worker in submission order, so output is deterministic
+//    regardless of the number of threads.
+//  * Textures are decoded to RGBA8 (DXT1/DXT5 included) or kept as R8 on load.
+//  * Shading follows Quad.hlsl and TextSDF.hlsl, blending happens in linear space.
+// Depth is ignored since all D3D11 pipelines use D3D11_COMPARISON_ALWAYS.
+// Attributes are interpolated affinely which is exact for orthographic transforms.
+
+#define SW_TILE_SIZE 64
+#define SW_SUBPIXEL_BITS 8
+#define SW_SUBPIXEL_ONE (1 << SW_SUBPIXEL_BITS)
+#define SW_CHUNK_TRIANGLES 8192
+#define SW_MAX_BATCH_TRIANGLES (4 * 1024 * 1024)
+#define SW_MAX_BATCH_CHUNKS (SW_MAX_BATCH_TRIANGLES / SW_CHUNK_TRIANGLES)
+#define SW_MAX_BIN_ENTRIES (128 * 1024 * 1024)
+#define SW_MAX_TEXTURES 1024
+#define SW_MAX_SAMPLERS 64
+
+typedef struct
+{
+    b32 used;
+    u32 width;
+    u32 height;
+    TextureFormat format;
+    // R8 for TextureFormat_R8, sRGB RGBA8 for everything else.
+    b32 singleChannel;
+    byte* texels;
+} SwTexture;
+
+typedef struct
+{
+    RenderMaterialType type;
+    SwTexture* texture;
+    TextureFiltering filtering;
+    Vector4 color;
+    Vector4 sdfParams;
+} SwMaterial;
+
+typedef struct
+{
+    RenderCommandEntry* entry;
+    u32 materialIndex;
+    u32 firstTriangle;
+} SwDraw;
+
+typedef struct
+{
+    // Subpixel screen coordinates, vertices ordered so that the area is positive.
+    i32 x[3];
+    i32 y[3];
+    f32 u[3];
+    f32 v[3];
+    u32 color[3];
+    // Inclusive pixel bounds clipped to the framebuffer. minX > maxX means culled.
+    i32 minX;
+    i32 minY;
+    i32 maxX;
+    i32 maxY;
+    u32 material;
+} SwTriangle;
+
+typedef struct
+{
+    CoreState* core;
+    MemoryHeap* heap;
+
+    DisplayParams displayParams;
+    Vector2 viewportMin;
+    Vector2 viewportDimensions;
+
+    u32* framebuffer;
+    u32 tilesX;
+    u32 tilesY;
+
+    u32 samplersCount;
+    TextureFiltering samplers[SW_MAX_SAMPLERS];
+    SwTexture textures[SW_MAX_TEXTURES];
+
+    u32 materialsCount;
+    u32 materialsCapacity;
+    SwMaterial* materials;
+
+    u32 drawsCount;
+    u32 drawsCapacity;
+    SwDraw* draws;
+
+    SwTriangle* triangles;
+    u32* binEntries;
+    // [chunk * tilesCount + tile]
+    u32* chunkTileCounts;
+    u32* chunkTileOffsets;
+
+    f32 srgbToLinear[256];
+    byte linearToSrgb[4096];
+
+    RenderFrameStats frameStats;
+    RenderFrameStats totalStats;
+} RendererContext;
+
+static int Initialized = 0;
+static RendererAPI GlobalApi;
+static RendererContext GlobalRendererContext;
+
+static RendererContext* GetRendererContext()
+{
+    return &GlobalRendererContext;
+}
+
+static void _WriteLog(CoreLogLevel logLevel, const char* tags, u32 tagsCount, const char* format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    RendererContext* context = GetRendererContext();
+    context->core->coreAPI.WriteLog(logLevel, tags, tagsCount, format, args);
+    va_end(args);
+}
+
+#define Log_Error(format, ...) _WriteLog(CoreLogLevel_Error, "SoftwareRenderer", 0, format, ##__VA_ARGS__)
+#define Log_Info(format, ...) _WriteLog(CoreLogLevel_Info, "SoftwareRenderer", 0, format, ##__VA_ARGS__)
+#define Assert(x) assert(x) // TODO: Core assert
+
+// NOTE: Chunks, tiles and rows run on the core job threads, the calling thread works on them too.
+static void SwParallelFor(RendererContext* renderer, u32 count, CoreParallelForFn* task, void* data)
+{
+    renderer->core->coreAPI.ParallelFor(count, task, data);
+}
+
+//
+// Color helpers
+//
+
+static inline f32 SwUnorm8(u32 v)
+{
+    return (f32)v * (1.0f / 255.0f);
+}
+
+static inline byte SwEncodeSrgb(RendererContext* renderer, f32 linear)
+{
+    linear = linear < 0.0f ? 0.0f : (linear > 1.0f ? 1.0f : linear);
+    return renderer->linearToSrgb[(u32)(linear * 4095.0f + 0.5f)];
+}
+
+static inline byte SwEncodeUnorm(f32 v)
+{
+    v = v < 0.0f ? 0.0f : (v > 1.0f ? 1.0f : v);
+    return (byte)(v * 255.0f + 0.5f);
+}
+
+static void SwInitColorTables(RendererContext* renderer)
+{
+    for (u32 i = 0; i < 256; i++)
+    {
+        f32 c = i / 255.0f;
+        renderer->srgbToLinear[i] = c <= 0.04045f ? c / 12.92f : powf((c + 0.055f) / 1.055f, 2.4f);
+    }
+
+    for (u32 i = 0; i < 4096; i++)
+    {
+        f32 l = i / 4095.0f;
+        f32 c = l <= 0.0031308f ? l * 12.92f : 1.055f * powf(l, 1.0f / 2.4f) - 0.055f;
+        renderer->linearToSrgb[i] = (byte)(c * 255.0f + 0.5f);
+    }
+}
+
+//
+// Texture decoding
+//
+
+static u32 SwUnpack565(u16 c)
+{
+    u32 r = (c >> 11) & 0x1f;
+    u32 g = (c >> 5) & 0x3f;
+    u32 b = c & 0x1f;
+    r = (r << 3) | (r >> 2);
+    g = (g << 2) | (g >> 4);
+    b = (b << 3) | (b >> 2);
+    return r | (g << 8) | (b << 16) | 0xff000000;
+}
+
+static u32 SwMixColor(u32 a, u32 b, u32 wa, u32 wb, u32 d)
+{
+    u32 result = 0xff000000;
+    for (u32 shift = 0; shift < 24; shift += 8)
+    {
+        u32 ca = (a >> shift) & 0xff;
+        u32 cb = (b >> shift) & 0xff;
+        result |= ((ca * wa + cb * wb) / d) << shift;
+    }
+    return result;
+}
+
+static void SwDecodeColorBlock(const byte* block, u32* out, b32 allowTransparent)
+{
+    u16 c0 = (u16)(block[0] | (block[1] << 8));
+    u16 c1 = (u16)(block[2] | (block[3] << 8));
+    u32 palette[4];
+    palette[0] = SwUnpack565(c0);
+    palette[1] = SwUnpack565(c1);
+
+    if (c0 > c1 || !allowTransparent)
+    {
+        palette[2] = SwMixColor(palette[0], palette[1], 2, 1, 3);
+        palette[3] = SwMixColor(palette[0], palette[1], 1, 2, 3);
+    }
+    else
+    {
+        palette[2] = SwMixColor(palette[0], palette[1], 1, 1, 2);
+        palette[3] = 0;
+    }
+
+    u32 bits = block[4] | (block[5] << 8) | (block[6] << 16) | ((u32)block[7] << 24);
+    for (u32 i = 0; i < 16; i++)
+    {
+        out[i] = palette[(bits >> (i * 2)) & 3];
+    }
+}
+
+static void SwDecodeAlphaBlock(const byte* block, u32* out)
+{
+    u32 a0 = block[0];
+    u32 a1 = block[1];
+    u32 palette[8];
+    palette[0] = a0;
+    palette[1] = a1;
+    if (a0 > a1)
+    {
+        for (u32 i = 1; i < 7; i++) palette[i + 1] = ((7 - i) * a0 + i * a1) / 7;
+    }
+    else
+    {
+        for (u32 i = 1; i < 5; i++) palette[i + 1] = ((5 - i) * a0 + i * a1) / 5;
+        palette[6] = 0;
+        palette[7] = 255;
+    }
+
+    u64 bits = 0;
+    for (u32 i = 0; i < 6; i++)
+    {
+        bits |= (u64)block[2 + i] << (8 * i);
+    }
+
+    for (u32 i = 0; i < 16; i++)
+    {
+        u32 alpha = palette[(bits >> (i * 3)) & 7];
+        out[i] = (out[i] & 0x00ffffff) | (alpha << 24);
+    }
+}
+
+static void SwDecodeDXT(const byte* data, u32 width, u32 height, b32 hasAlpha, u32* texels)
+{
+    u32 blockSize = hasAlpha ? 16 : 8;
+    u32 blocksX = width / 4;
+    u32 blocksY = height / 4;
+    for (u32 by = 0; by < blocksY; by++)
+    {
+        for (u32 bx = 0; bx < blocksX; bx++)
+        {
+            const byte* block = data + (by * blocksX + bx) * blockSize;
+            u32 decoded[16];
+            if (hasAlpha)
+            {
+                SwDecodeColorBlock(block + 8, decoded, false);
+                SwDecodeAlphaBlock(block, decoded);
+            }
+            else
+            {
+                SwDecodeColorBlock(block, decoded, true);
+            }
+
+            for (u32 y = 0; y < 4; y++)
+            {
+                memcpy(texels + (by * 4 + y) * width + bx * 4, decoded + y * 4, sizeof(u32) * 4);
+            }
+        }
+    }
+}
+
+//
+// Sampling
+//
+
+static inline Vector4 SwFetch(RendererContext* renderer, SwTexture* texture, i32 x, i32 y)
+{
+    // Wrap addressing like the D3D11 samplers.
+    x %= (i32)texture->width;
+    y %= (i32)texture->height;
+    if (x < 0) x += texture->width;
+    if (y < 0) y += texture->height;
+
+    if (texture->singleChannel)
+    {
+        return MakeVector4(SwUnorm8(texture->texels[y * texture->width + x]), 0.0f, 0.0f, 1.0f);
+    }
+
+    u32 texel = ((u32*)texture->texels)[y * texture->width + x];
+    return MakeVector4(renderer->srgbToLinear[texel & 0xff], renderer->srgbToLinear[(texel >> 8) & 0xff], renderer->srgbToLinear[(texel >> 16) & 0xff], SwUnorm8(texel >> 24));
+}
+
+static inline Vector4 SwSample(RendererContext* renderer, SwTexture* texture, TextureFiltering filtering, f32 u, f32 v)
+{
+    f32 x = u * texture->width;
+    f32 y = v * texture->height;
+
+    if (filtering == TextureFiltering_Point)
+    {
+        return SwFetch(renderer, texture, (i32)fFloor(x), (i32)fFloor(y));
+    }
+
+    x -= 0.5f;
+    y -= 0.5f;
+    f32 x0f = fFloor(x);
+    f32 y0f = fFloor(y);
+    f32 tx = x - x0f;
+    f32 ty = y - y0f;
+    i32 x0 = (i32)x0f;
+    i32 y0 = (i32)y0f;
+
+    Vector4 s00 = SwFetch(renderer, texture, x0, y0);
+    Vector4 s10 = SwFetch(renderer, texture, x0 + 1, y0);
+    Vector4 s01 = SwFetch(renderer, texture, x0, y0 + 1);
+    Vector4 s11 = SwFetch(renderer, texture, x0 + 1, y0 + 1);
+
+    Vector4 result;
+    for (u32 i = 0; i < 4; i++)
+    {
+        f32 top = s00.data[i] + (s10.data[i] - s00.data[i]) * tx;
+        f32 bottom = s01.data[i] + (s11.data[i] - s01.data[i]) * tx;
+        result.data[i] = top + (bottom - top) * ty;
+    }
+    return result;
+}
+
+//
+// RendererAPI
+//
+
+static void SwResizeFramebuffer(RendererContext* renderer, DisplayParams params)
+{
+    CoreAPI* core = &renderer->core->coreAPI;
+
+    if (renderer->framebuffer != NULL)
+    {
+        core->HeapFree(renderer->heap, renderer->framebuffer);
+        core->HeapFree(renderer->heap, renderer->chunkTileCounts);
+        core->HeapFree(renderer->heap, renderer->chunkTileOffsets);
+    }
+
+    renderer->displayParams = params;
+    renderer->framebuffer = (u32*)core->HeapAlloc(renderer->heap, sizeof(u32) * params.width * params.height, true);
+    renderer->tilesX = (params.width + SW_TILE_SIZE - 1) / SW_TILE_SIZE;
+    renderer->tilesY = (params.height + SW_TILE_SIZE - 1) / SW_TILE_SIZE;
+
+    uptr tileTableSize = sizeof(u32) * SW_MAX_BATCH_CHUNKS * renderer->tilesX * renderer->tilesY;
+    renderer->chunkTileCounts = (u32*)core->HeapAlloc(renderer->heap, tileTableSize, false);
+    renderer->chunkTileOffsets = (u32*)core->HeapAlloc(renderer->heap, tileTableSize, false);
+
+    renderer->viewportMin = MakeVector2(0.0f, 0.0f);
+    renderer->viewportDimensions = MakeVector2((f32)params.width, (f32)params.height);
+}
+
+static DisplayParams SetDisplayParams(DisplayParams displayParams)
+{
+    RendererContext* renderer = GetRendererContext();
+    SwResizeFramebuffer(renderer, displayParams);
+    return displayParams;
+}
+
+static void SetVsyncMode(VSyncMode mode)
+{
+}
+
+static void SwapScreenBuffers()
+{
+}
+
+static void SetViewport(Vector2 min, Vector2 dimensions)
+{
+    RendererContext* renderer = GetRendererContext();
+    renderer->viewportMin = min;
+    renderer->viewportDimensions = dimensions;
+}
+
+static SamplerDescriptor CreateSampler(TextureSamplerSettings sampler)
+{
+    RendererContext* renderer = GetRendererContext();
+
+    SamplerDescriptor result = {};
+    if (renderer->samplersCount < SW_MAX_SAMPLERS)
+    {
+        renderer->samplers[renderer->samplersCount] = sampler.filtering;
+        result.data0 = ++renderer->samplersCount;
+    }
+    return result;
+}
+
+static SwTexture* GetTexture(RendererContext* renderer, TextureDescriptor id)
+{
+    if (id.data0 == 0 || id.data0 > SW_MAX_TEXTURES)
+    {
+        return NULL;
+    }
+
+    SwTexture* texture = renderer->textures + (id.data0 - 1);
+    return texture->used ? texture : NULL;
+}
+
+static Texture2D LoadTexture2D(u32 width, u32 height, TextureFormat format, void* data, uptr dataSize)
+{
+    RendererContext* renderer = GetRendererContext();
+    CoreAPI* core = &renderer->core->coreAPI;
+
+    Texture2D result = {};
+
+    u32 slot = SW_MAX_TEXTURES;
+    for (u32 i = 0; i < SW_MAX_TEXTURES; i++)
+    {
+        if (!renderer->textures[i].used)
+        {
+            slot = i;
+            break;
+        }
+    }
+
+    if (slot == SW_MAX_TEXTURES)
+    {
+        Log_Error("Out of texture slots\n");
+        return result;
+    }
+
+    SwTexture* texture = renderer->textures + slot;
+    texture->width = width;
+    texture->height = height;
+    texture->format = format;
+    texture->singleChannel = format == TextureFormat_R8;
+
+    uptr texelsSize = (uptr)width * height * (texture->singleChannel ? 1 : 4);
+    texture->texels = (byte*)core->HeapAlloc(renderer->heap, texelsSize, false);
+
+    switch (format)
+    {
+    case TextureFormat_R8:
+    case TextureFormat_SRGB24_A8: { memcpy(texture->texels, data, texelsSize); } break;
+    case TextureFormat_sRGB_DXT1: { SwDecodeDXT((byte*)data, width, height, false, (u32*)texture->texels); } break;
+    case TextureFormat_sRGBA_DXT5: { SwDecodeDXT((byte*)data, width, height, true, (u32*)texture->texels); } break;
+    InvalidDefault();
+    }
+
+    texture->used = true;
+
+    result.id.data0 = slot + 1;
+    result.width = width;
+    result.height = height;
+    result.format = format;
+    return result;
+}
+
+static void UnloadTexture2D(TextureDescriptor id)
+{
+    RendererContext* renderer = GetRendererContext();
+
+    SwTexture* texture = GetTexture(renderer, id);
+    if (texture != NULL)
+    {
+        renderer->core->coreAPI.HeapFree(renderer->heap, texture->texels);
+        texture->texels = NULL;
+        texture->used = false;
+    }
+}
+
+static void BeginFrame()
+{
+    RendererContext* renderer = GetRendererContext();
+    renderer->frameStats = {};
+}
+
+static void EndFrame()
+{
+    RendererContext* renderer = GetRendererContext();
+
+    renderer->frameStats.framesCount = 1;
+
+    RenderFrameStats* total = &renderer->totalStats;
+    RenderFrameStats* frame = &renderer->frameStats;
+    total->framesCount += frame->framesCount;
+    total->commandsCount += frame->commandsCount;
+    total->clearCount += frame->clearCount;
+    total->setMaterialCount += frame->setMaterialCount;
+    total->drawCount += frame->drawCount;
+    total->verticesCount += frame->verticesCount;
+    total->vertexBytesCount += frame->vertexBytesCount;
+    total->indicesCount += frame->indicesCount;
+    total->indexBytesCount += frame->indexBytesCount;
+    total->segmentsCount += frame->segmentsCount;
+    total->validationErrorsCount += frame->validationErrorsCount;
+}
+
+//
+// Triangle setup and binning
+//
+
+typedef struct
+{
+    RendererContext* renderer;
+    u32 firstTriangle;
+    u32 trianglesCount;
+    u32 chunksCount;
+    u32 tilesCount;
+} SwBatch;
+
+static u32 SwFindDraw(RendererContext* renderer, u32 triangle)
+{
+    u32 lo = 0;
+    u32 hi = renderer->drawsCount;
+    while (hi - lo > 1)
+    {
+        u32 mid = (lo + hi) / 2;
+        if (renderer->draws[mid].firstTriangle <= triangle)
+        {
+            lo = mid;
+        }
+        else
+        {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+static u32 SwGetTrianglesCount(RenderCommandEntry* entry)
+{
+    if (entry->command == RenderCommand_DrawLineSegments)
+    {
+        return entry->drawLineSegments.segmentCount * 2;
+    }
+
+    return entry->drawMeshImmediate.indexCount / 3;
+}
+
+// NOTE: CPU reference for segment expansion. Same operations as the quad writer in
+// gfxEmitPathGeometry, so both ways of drawing a path produce identical images.
+static void SwExpandSegmentTriangle(RenderLineSegment* segment, u32 localTriangle, RenderVertex* vertices)
+{
+    static const u32 corners[2][3] = { { 0, 1, 2 }, { 2, 3, 0 } };
+
+    Vector2 p1 = segment->p1;
+    Vector2 p2 = segment->p2;
+    Vector2 d = v2Normalize(MakeVector2(p2.x - p1.x, p2.y - p1.y));
+    f32 halfThickness = segment->thickness * 0.5f;
+    f32 dx = d.x * halfThickness;
+    f32 dy = d.y * halfThickness;
+
+    Vector2 quad[4];
+    quad[0] = MakeVector2(p1.x + dy, p1.y - dx);
+    quad[1] = MakeVector2(p2.x + dy, p2.y - dx);
+    quad[2] = MakeVector2(p2.x - dy, p2.y + dx);
+    quad[3] = MakeVector2(p1.x - dy, p1.y + dx);
+
+    for (u32 i = 0; i < 3; i++)
+    {
+        Vector2 p = quad[corners[localTriangle & 1][i]];
+        vertices[i].position = MakeVector3(p.x, p.y, 0.5f);
+        vertices[i].uv = MakeVector2(0.0f, 0.0f);
+        vertices[i].vertexColor = segment->color;
+    }
+}
+
+static inline RenderVertex SwFetchVertex(void* vertices, RenderVertexFormat format, u32 index)
+{
+    RenderVertex result;
+    switch (format)
+    {
+    case RenderVertexFormat_Position2DColor:
+    {
+        RenderVertex2D* vertex = (RenderVertex2D*)vertices + index;
+        result.position = MakeVector3(vertex->position.x, vertex->position.y, 0.5f);
+        result.uv = MakeVector2(0.0f, 0.0f);
+        result.vertexColor = vertex->vertexColor;
+    } break;
+    case RenderVertexFormat_Position2DUv16Color:
+    {
+        // Same as DXGI_FORMAT_R16G16_UNORM.
+        RenderVertex2DUv16* vertex = (RenderVertex2DUv16*)vertices + index;
+        result.position = MakeVector3(vertex->position.x, vertex->position.y, 0.5f);
+        result.uv = MakeVector2(vertex->uv[0] / 65535.0f, vertex->uv[1] / 65535.0f);
+        result.vertexColor = vertex->vertexColor;
+    } break;
+    default:
+    {
+        result = ((RenderVertex*)vertices)[index];
+    } break;
+    }
+
+    return result;
+}
+
+static void SwSetupTriangle(RendererContext* renderer, SwDraw* draw, u32 localTriangle, SwTriangle* tri)
+{
+    RenderCommandEntry* entry = draw->entry;
+
+    Matrix4x4* m;
+    RenderVertex vertices[3];
+    if (entry->command == RenderCommand_DrawLineSegments)
+    {
+        m = entry->drawLineSegments.transform;
+        SwExpandSegmentTriangle(entry->drawLineSegments.segments + localTriangle / 2, localTriangle, vertices);
+    }
+    else
+    {
+        m = entry->drawMeshImmediate.transform;
+        u32 firstIndex = localTriangle * 3;
+        for (u32 i = 0; i < 3; i++)
+        {
+            vertices[i] = SwFetchVertex(entry->drawMeshImmediate.vertices, entry->drawMeshImmediate.vertexFormat, GetRenderIndex(entry->drawMeshImmediate.indices, entry->drawMeshImmediate.indexFormat, firstIndex + i));
+        }
+    }
+
+    f32 scaleX = renderer->viewportDimensions.x * 0.5f;
+    f32 scaleY = renderer->viewportDimensions.y * 0.5f;
+
+    for (u32 i = 0; i < 3; i++)
+    {
+        RenderVertex* vertex = vertices + i;
+        Vector3 p = vertex->position;
+
+        // row_major transform applied as mul(float4(p, 1), transform) in the shaders.
+        f32 cx = m->_11 * p.x + m->_12 * p.y + m->_13 * p.z + m->_14;
+        f32 cy = m->_21 * p.x + m->_22 * p.y + m->_23 * p.z + m->_24;
+        f32 cw = m->_41 * p.x + m->_42 * p.y + m->_43 * p.z + m->_44;
+        f32 invW = cw != 0.0f ? 1.0f / cw : 0.0f;
+
+        f32 sx = renderer->viewportMin.x + (cx * invW + 1.0f) * scaleX;
+        f32 sy = renderer->viewportMin.y + (1.0f - cy * invW) * scaleY;
+
+        tri->x[i] = (i32)(sx * SW_SUBPIXEL_ONE + 0.5f);
+        tri->y[i] = (i32)(sy * SW_SUBPIXEL_ONE + 0.5f);
+        tri->u[i] = vertex->uv.x;
+        tri->v[i] = vertex->uv.y;
+        tri->color[i] = vertex->vertexColor;
+    }
+
+    tri->material = draw->materialIndex;
+
+    i64 area = (i64)(tri->x[1] - tri->x[0]) * (tri->y[2] - tri->y[0]) - (i64)(tri->y[1] - tri->y[0]) * (tri->x[2] - tri->x[0]);
+    if (area == 0)
+    {
+        tri->minX = 1;
+        tri->maxX = 0;
+        return;
+    }
+
+    if (area < 0)
+    {
+        // No culling in the D3D11 backend, just flip the winding.
+        i32 x = tri->x[1]; tri->x[1] = tri->x[2]; tri->x[2] = x;
+        i32 y = tri->y[1]; tri->y[1] = tri->y[2]; tri->y[2] = y;
+        f32 u = tri->u[1]; tri->u[1] = tri->u[2]; tri->u[2] = u;
+        f32 v = tri->v[1]; tri->v[1] = tri->v[2]; tri->v[2] = v;
+        u32 c = tri->color[1]; tri->color[1] = tri->color[2]; tri->color[2] = c;
+    }
+
+    i32 minX = iMin(tri->x[0], iMin(tri->x[1], tri->x[2]));
+    i32 minY = iMin(tri->y[0], iMin(tri->y[1], tri->y[2]));
+    i32 maxX = iMax(tri->x[0], iMax(tri->x[1], tri->x[2]));
+    i32 maxY = iMax(tri->y[0], iMax(tri->y[1], tri->y[2]));
+
+    // Pixel centers are at +0.5, convert the bounds to the range of covered centers.
+    i32 half = SW_SUBPIXEL_ONE / 2;
+    tri->minX = iMax(0, (minX - half + SW_SUBPIXEL_ONE - 1) >> SW_SUBPIXEL_BITS);
+    tri->minY = iMax(0, (minY - half + SW_SUBPIXEL_ONE - 1) >> SW_SUBPIXEL_BITS);
+    tri->maxX = iMin((i32)renderer->displayParams.width - 1, (maxX - half) >> SW_SUBPIXEL_BITS);
+    tri->maxY = iMin((i32)renderer->displayParams.height - 1, (maxY - half) >> SW_SUBPIXEL_BITS);
+
+    if (tri->minY > tri->maxY)
+    {
+        tri->maxX = tri->minX - 1;
+    }
+}
+
+static void SwSetupChunkTask(void* data, u32 chunkIndex, u32 threadIndex)
+{
+    SwBatch* batch = (SwBatch*)data;
+    RendererContext* renderer = batch->renderer;
+
+    u32* tileCounts = renderer->chunkTileCounts + chunkIndex * batch->tilesCount;
+    memset(tileCounts, 0, sizeof(u32) * batch->tilesCount);
+
+    u32 begin = batch->firstTriangle + chunkIndex * SW_CHUNK_TRIANGLES;
+    u32 end = begin + SW_CHUNK_TRIANGLES;
+    end = end < batch->firstTriangle + batch->trianglesCount ? end : batch->firstTriangle + batch->trianglesCount;
+
+    u32 drawIndex = SwFindDraw(renderer, begin);
+    for (u32 t = begin; t < end; t++)
+    {
+        while (drawIndex + 1 < renderer->drawsCount && renderer->draws[drawIndex + 1].firstTriangle <= t)
+        {
+            drawIndex++;
+        }
+
+        SwDraw* draw = renderer->draws + drawIndex;
+        SwTriangle* tri = renderer->triangles + (t - batch->firstTriangle);
+        SwSetupTriangle(renderer, draw, t - draw->firstTriangle, tri);
+
+        if (tri->minX > tri->maxX)
+        {
+            continue;
+        }
+
+        u32 tx0 = tri->minX / SW_TILE_SIZE;
+        u32 tx1 = tri->maxX / SW_TILE_SIZE;
+        u32 ty0 = tri->minY / SW_TILE_SIZE;
+        u32 ty1 = tri->maxY / SW_TILE_SIZE;
+        for (u32 ty = ty0; ty <= ty1; ty++)
+        {
+            for (u32 tx = tx0; tx <= tx1; tx++)
+            {
+                tileCounts[ty * renderer->tilesX + tx]++;
+            }
+        }
+    }
+}
+
+static void SwBinChunkTask(void* data, u32 chunkIndex, u32 threadIndex)
+{
+    SwBatch* batch = (SwBatch*)data;
+    RendererContext* renderer = batch->renderer;
+
+    // NOTE: Offsets are consumed as write cursors.
+    u32* tileCursors = renderer->chunkTileOffsets + chunkIndex * batch->tilesCount;
+
+    u32 begin = chunkIndex * SW_CHUNK_TRIANGLES;
+    u32 end = begin + SW_CHUNK_TRIANGLES;
+    end = end < batch->trianglesCount ? end : batch->trianglesCount;
+
+    for (u32 t = begin; t < end; t++)
+    {
+        SwTriangle* tri = renderer->triangles + t;
+        if (tri->minX > tri->maxX)
+        {
+            continue;
+        }
+
+        u32 tx0 = tri->minX / SW_TILE_SIZE;
+        u32 tx1 = tri->maxX / SW_TILE_SIZE;
+        u32 ty0 = tri->minY / SW_TILE_SIZE;
+        u32 ty1 = tri->maxY / SW_TILE_SIZE;
+        for (u32 ty = ty0; ty <= ty1; ty++)
+        {
+            for (u32 tx = tx0; tx <= tx1; tx++)
+            {
+                renderer->binEntries[tileCursors[ty * renderer->tilesX + tx]++] = t;
+            }
+        }
+    }
+}
+
+//
+// Rasterization
+//
+
+static inline i64 SwEdgeBias(i32 ax, i32 ay, i32 bx, i32 by)
+{
+    // Top-left fill rule. With positive area in y-down space top edges go
+    // right (dy == 0, dx > 0) and left edges go up (dy < 0).
+    i32 dx = bx - ax;
+    i32 dy = by - ay;
+    b32 topLeft = (dy == 0 && dx > 0) || dy < 0;
+    return topLeft ? 0 : -1;
+}
+
+static inline u32 SwShadePixel(RendererContext* renderer, SwMaterial* material, Vector4 color, f32 u, f32 v, u32 dst)
+{
+    if (material->type == RenderMaterialType_TextSDF)
+    {
+        // TextSDF.hlsl
+        Vector4 params = material->sdfParams;
+        f32 sample = SwSample(renderer, material->texture, material->filtering, u, v).x * 255.0f;
+        f32 sdfDist = (sample - params.x) / params.y;
+        f32 pixDist = sdfDist * params.z;
+        f32 alpha = pixDist + 0.5f;
+        alpha = alpha < 0.0f ? 0.0f : (alpha > 1.0f ? 1.0f : alpha);
+        alpha *= color.w;
+
+        // SRC_ALPHA / INV_SRC_ALPHA for color, ONE / ZERO for alpha.
+        f32 dr = renderer->srgbToLinear[dst & 0xff];
+        f32 dg = renderer->srgbToLinear[(dst >> 8) & 0xff];
+        f32 db = renderer->srgbToLinear[(dst >> 16) & 0xff];
+        f32 r = color.x * alpha + dr * (1.0f - alpha);
+        f32 g = color.y * alpha + dg * (1.0f - alpha);
+        f32 b = color.z * alpha + db * (1.0f - alpha);
+        return SwEncodeSrgb(renderer, r) | (SwEncodeSrgb(renderer, g) << 8) | (SwEncodeSrgb(renderer, b) << 16) | ((u32)SwEncodeUnorm(alpha) << 24);
+    }
+    else
+    {
+        // Quad.hlsl
+        Vector4 sample = SwSample(renderer, material->texture, material->filtering, u, v);
+        f32 r = sample.x * color.x;
+        f32 g = sample.y * color.y;
+        f32 b = sample.z * color.z;
+        return SwEncodeSrgb(renderer, r) | (SwEncodeSrgb(renderer, g) << 8) | (SwEncodeSrgb(renderer, b) << 16) | 0xff000000;
+    }
+}
+
+static inline Vector4 SwUnpackVertexColor(u32 c)
+{
+    return MakeVector4(SwUnorm8(c & 0xff), SwUnorm8((c >> 8) & 0xff), SwUnorm8((c >> 16) & 0xff), SwUnorm8(c >> 24));
+}
+
+static void SwRasterizeTriangle(RendererContext* renderer, SwTriangle* tri, i32 clipMinX, i32 clipMinY, i32 clipMaxX, i32 clipMaxY)
+{
+    i32 minX = iMax(tri->minX, clipMinX);
+    i32 minY = iMax(tri->minY, clipMinY);
+    i32 maxX = iMin(tri->maxX, clipMaxX);
+    i32 maxY = iMin(tri->maxY, clipMaxY);
+    if (minX > maxX || minY > maxY)
+    {
+        return;
+    }
+
+    SwMaterial* material = renderer->materials + tri->material;
+    if (material->texture == NULL)
+    {
+        return;
+    }
+
+    i32 x0 = tri->x[0], y0 = tri->y[0];
+    i32 x1 = tri->x[1], y1 = tri->y[1];
+    i32 x2 = tri->x[2], y2 = tri->y[2];
+
+    // Edge functions E(p) = A * px + B * py + C, positive inside.
+    i64 a01 = -(i64)(y1 - y0), b01 = (i64)(x1 - x0);
+    i64 a12 = -(i64)(y2 - y1), b12 = (i64)(x2 - x1);
+    i64 a20 = -(i64)(y0 - y2), b20 = (i64)(x0 - x2);
+
+    i64 bias01 = SwEdgeBias(x0, y0, x1, y1);
+    i64 bias12 = SwEdgeBias(x1, y1, x2, y2);
+    i64 bias20 = SwEdgeBias(x2, y2, x0, y0);
+
+    i64 px = ((i64)minX << SW_SUBPIXEL_BITS) + SW_SUBPIXEL_ONE / 2;
+    i64 py = ((i64)minY << SW_SUBPIXEL_BITS) + SW_SUBPIXEL_ONE / 2;
+
+    i64 row01 = a01 * (px - x0) + b01 * (py - y0);
+    i64 row12 = a12 * (px - x1) + b12 * (py - y1);
+    i64 row20 = a20 * (px - x2) + b20 * (py - y2);
+
+    i64 stepX01 = a01 << SW_SUBPIXEL_BITS, stepY01 = b01 << SW_SUBPIXEL_BITS;
+    i64 stepX12 = a12 << SW_SUBPIXEL_BITS, stepY12 = b12 << SW_SUBPIXEL_BITS;
+    i64 stepX20 = a20 << SW_SUBPIXEL_BITS, stepY20 = b20 << SW_SUBPIXEL_BITS;
+
+    f32 invArea = 1.0f / (f32)(b01 * (y2 - y0) + a01 * (x2 - x0));
+
+    b32 constantColor = tri->color[0] == tri->color[1] && tri->color[0] == tri->color[2];
+    Vector4 c0 = SwUnpackVertexColor(tri->color[0]);
+    Vector4 c1 = SwUnpackVertexColor(tri->color[1]);
+    Vector4 c2 = SwUnpackVertexColor(tri->color[2]);
+
+    u32 width = renderer->displayParams.width;
+
+    for (i32 y = minY; y <= maxY; y++)
+    {
+        i64 e01 = row01;
+        i64 e12 = row12;
+        i64 e20 = row20;
+        u32* dst = renderer->framebuffer + (uptr)y * width;
+
+        for (i32 x = minX; x <= maxX; x++)
+        {
+            if ((e01 + bias01) >= 0 && (e12 + bias12) >= 0 && (e20 + bias20) >= 0)
+            {
+                // Barycentrics: weight of a vertex is the edge opposite to it.
+                f32 l1 = (f32)e20 * invArea;
+                f32 l2 = (f32)e01 * invArea;
+                f32 u = tri->u[0] + (tri->u[1] - tri->u[0]) * l1 + (tri->u[2] - tri->u[0]) * l2;
+                f32 v = tri->v[0] + (tri->v[1] - tri->v[0]) * l1 + (tri->v[2] - tri->v[0]) * l2;
+
+                Vector4 color = c0;
+                if (!constantColor)
+                {
+                    for (u32 i = 0; i < 4; i++)
+                    {
+                        color.data[i] = c0.data[i] + (c1.data[i] - c0.data[i]) * l1 + (c2.data[i] - c0.data[i]) * l2;
+                    }
+                }
+
+                dst[x] = SwShadePixel(renderer, material, color, u, v, dst[x]);
+            }
+
+            e01 += stepX01;
+            e12 += stepX12;
+            e20 += stepX20;
+        }
+
+        row01 += stepY01;
+        row12 += stepY12;
+        row20 += stepY20;
+    }
+}
+
+static void SwRasterizeTileTask(void* data, u32 tileIndex, u32 threadIndex)
+{
+    SwBatch* batch = (SwBatch*)data;
+    RendererContext* renderer = batch->renderer;
+
+    u32 tileX = tileIndex % renderer->tilesX;
+    u32 tileY = tileIndex / renderer->tilesX;
+    i32 clipMinX = tileX * SW_TILE_SIZE;
+    i32 clipMinY = tileY * SW_TILE_SIZE;
+    i32 clipMaxX = iMin(clipMinX + SW_TILE_SIZE, (i32)renderer->displayParams.width) - 1;
+    i32 clipMaxY = iMin(clipMinY + SW_TILE_SIZE, (i32)renderer->displayParams.height) - 1;
+
+    // Chunks are in submission order and so are entries inside of every chunk.
+    for (u32 chunk = 0; chunk < batch->chunksCount; chunk++)
+    {
+        u32 slot = chunk * batch->tilesCount + tileIndex;
+        u32 count = renderer->chunkTileCounts[slot];
+        u32 end = renderer->chunkTileOffsets[slot];
+        for (u32 i = end - count; i < end; i++)
+        {
+            SwRasterizeTriangle(renderer, renderer->triangles + renderer->binEntries[i], clipMinX, clipMinY, clipMaxX, clipMaxY);
+        }
+    }
+}
+
+static void SwRenderBatch(RendererContext* renderer, u32 firstTriangle, u32 trianglesCount)
+{
+    SwBatch batch = {};
+    batch.renderer = renderer;
+    batch.firstTriangle = firstTriangle;
+    batch.trianglesCount = trianglesCount;
+    batch.chunksCount = (trianglesCount + SW_CHUNK_TRIANGLES - 1) / SW_CHUNK_TRIANGLES;
+    batch.tilesCount = renderer->tilesX * renderer->tilesY;
+
+    SwParallelFor(renderer, batch.chunksCount, SwSetupChunkTask, &batch);
+
+    u64 totalEntries = 0;
+    for (u32 chunk = 0; chunk < batch.chunksCount; chunk++)
+    {
+        for (u32 tile = 0; tile < batch.tilesCount; tile++)
+        {
+            u32 slot = chunk * batch.tilesCount + tile;
+            renderer->chunkTileOffsets[slot] = (u32)totalEntries;
+            totalEntries += renderer->chunkTileCounts[slot];
+        }
+    }
+
+    if (totalEntries > SW_MAX_BIN_ENTRIES)
+    {
+        // Lots of huge triangles. Split the batch and try again.
+        Assert(trianglesCount > 1);
+        u32 half = trianglesCount / 2;
+        SwRenderBatch(renderer, firstTriangle, half);
+        SwRenderBatch(renderer, firstTriangle + half, trianglesCount - half);
+        return;
+    }
+
+    SwParallelFor(renderer, batch.chunksCount, SwBinChunkTask, &batch);
+    SwParallelFor(renderer, batch.tilesCount, SwRasterizeTileTask, &batch);
+}
+
+static void SwFlushDraws(RendererContext* renderer)
+{
+    if (renderer->drawsCount == 0)
+    {
+        return;
+    }
+
+    SwDraw* lastDraw = renderer->draws + renderer->drawsCount - 1;
+    u32 trianglesCount = lastDraw->firstTriangle + SwGetTrianglesCount(lastDraw->entry);
+
+    for (u32 first = 0; first < trianglesCount; first += SW_MAX_BATCH_TRIANGLES)
+    {
+        u32 count = trianglesCount - first;
+        count = count < SW_MAX_BATCH_TRIANGLES ? count : SW_MAX_BATCH_TRIANGLES;
+        SwRenderBatch(renderer, first, count);
+    }
+
+    renderer->drawsCount = 0;
+}
+
+typedef struct
+{
+    RendererContext* renderer;
+    u32 color;
+} SwClearData;
+
+static void SwClearTileRowTask(void* data, u32 row, u32 threadIndex)
+{
+    SwClearData* clear = (SwClearData*)data;
+    RendererContext* renderer = clear->renderer;
+    u32 width = renderer->displayParams.width;
+    u32 y0 = row * SW_TILE_SIZE;
+    u32 y1 = y0 + SW_TILE_SIZE < renderer->displayParams.height ? y0 + SW_TILE_SIZE : renderer->displayParams.height;
+    for (u32 y = y0; y < y1; y++)
+    {
+        u32* dst = renderer->framebuffer + (uptr)y * width;
+        for (u32 x = 0; x < width; x++)
+        {
+            dst[x] = clear->color;
+        }
+    }
+}
+
+static void ExecuteCommand_Clear(RendererContext* renderer, RenderCommandEntry* entry)
+{
+    renderer->frameStats.clearCount++;
+
+    // Everything issued before the clear must land first.
+    SwFlushDraws(renderer);
+
+    if (entry->clear.flags & RenderClearFlags_Color)
+    {
+        // Clear color is linear, render target is sRGB.
+        Vector4 c = entry->clear.color;
+        SwClearData data = {};
+        data.renderer = renderer;
+        data.color = SwEncodeSrgb(renderer, c.x) | (SwEncodeSrgb(renderer, c.y) << 8) | (SwEncodeSrgb(renderer, c.z) << 16) | ((u32)SwEncodeUnorm(c.w) << 24);
+        SwParallelFor(renderer, renderer->tilesY, SwClearTileRowTask, &data);
+    }
+}
+
+static void ExecuteCommand_SetMaterial(RendererContext* renderer, RenderCommandEntry* entry)
+{
+    renderer->frameStats.setMaterialCount++;
+
+    if (renderer->materialsCount == renderer->materialsCapacity)
+    {
+        u32 newCapacity = renderer->materialsCapacity * 2;
+        renderer->materials = (SwMaterial*)renderer->core->coreAPI.HeapRealloc(renderer->heap, renderer->materials, sizeof(SwMaterial) * newCapacity, false);
+        renderer->materialsCapacity = newCapacity;
+    }
+
+    SwMaterial* material = renderer->materials + renderer->materialsCount++;
+    material->type = entry->setMaterial.type;
+    material->texture = GetTexture(renderer, entry->setMaterial.textureId);
+    material->color = entry->setMaterial.color;
+    material->sdfParams = entry->setMaterial.sdfParams;
+
+    u64 sampler = entry->setMaterial.sampler.data0;
+    material->filtering = (sampler > 0 && sampler <= renderer->samplersCount) ? renderer->samplers[sampler - 1] : TextureFiltering_Point;
+
+    if (material->texture == NULL)
+    {
+        renderer->frameStats.validationErrorsCount++;
+    }
+}
+
+static void SwQueueDraw(RendererContext* renderer, RenderCommandEntry* entry)
+{
+    if (renderer->materialsCount == 0)
+    {
+        renderer->frameStats.validationErrorsCount++;
+        return;
+    }
+
+    u32 trianglesCount = SwGetTrianglesCount(entry);
+    if (trianglesCount == 0)
+    {
+        return;
+    }
+
+    if (renderer->drawsCount == renderer->drawsCapacity)
+    {
+        u32 newCapacity = renderer->drawsCapacity * 2;
+        renderer->draws = (SwDraw*)renderer->core->coreAPI.HeapRealloc(renderer->heap, renderer->draws, sizeof(SwDraw) * newCapacity, false);
+        renderer->drawsCapacity = newCapacity;
+    }
+
+    u32 firstTriangle = 0;
+    if (renderer->drawsCount > 0)
+    {
+        SwDraw* prev = renderer->draws + renderer->drawsCount - 1;
+        firstTriangle = prev->firstTriangle + SwGetTrianglesCount(prev->entry);
+    }
+
+    SwDraw* draw = renderer->draws + renderer->drawsCount++;
+    draw->entry = entry;
+    draw->materialIndex = renderer->materialsCount - 1;
+    draw->firstTriangle = firstTriangle;
+}
+
+static void ExecuteCommand_DrawMeshImmediate(RendererContext* renderer, RenderCommandEntry* entry)
+{
+    renderer->frameStats.drawCount++;
+    renderer->frameStats.verticesCount += entry->drawMeshImmediate.vertexCount;
+    renderer->frameStats.vertexBytesCount += (u64)entry->drawMeshImmediate.vertexCount * GetVertexFormatStride(entry->drawMeshImmediate.vertexFormat);
+    renderer->frameStats.indicesCount += entry->drawMeshImmediate.indexCount;
+    renderer->frameStats.indexBytesCount += (u64)entry->drawMeshImmediate.indexCount * GetIndexFormatSize(entry->drawMeshImmediate.indexFormat);
+
+    SwQueueDraw(renderer, entry);
+}
+
+static void ExecuteCommand_DrawLineSegments(RendererContext* renderer, RenderCommandEntry* entry)
+{
+    renderer->frameStats.drawCount++;
+    renderer->frameStats.segmentsCount += entry->drawLineSegments.segmentCount;
+
+    SwQueueDraw(renderer, entry);
+}
+
+static void ExecuteCommandBuffer(RenderCommandBuffer* buffer)
+{
+    RendererContext* renderer = GetRendererContext();
+
+    renderer->frameStats.commandsCount += buffer->renderCommandsCount;
+    renderer->materialsCount = 0;
+    renderer->drawsCount = 0;
+
+    for (u32 i = 0; i < buffer->renderCommandsCount; i++)
+    {
+        RenderCommandEntry* entry = buffer->commands + i;
+        switch(entry->command)
+        {
+        case RenderCommand_Clear: { ExecuteCommand_Clear(renderer, entry); } break;
+        case RenderCommand_DrawMeshImmediate: { ExecuteCommand_DrawMeshImmediate(renderer, entry); } break;
+        case RenderCommand_SetMaterial: { ExecuteCommand_SetMaterial(renderer, entry); } break;
+        case RenderCommand_DrawLineSegments: { ExecuteCommand_DrawLineSegments(renderer, entry); } break;
+        default: { Log_Error("Unknown render command!\n"); } break;
+        }
+    }
+
+    SwFlushDraws(renderer);
+}
+
+static void InitializeApi(RendererAPI* api)
+{
+    api->SetDisplayParams = SetDisplayParams;
+    api->SetVsyncMode = SetVsyncMode;
+    api->SwapScreenBuffers = SwapScreenBuffers;
+    api->SetViewport = SetViewport;
+    api->ExecuteCommandBuffer = ExecuteCommandBuffer;
+    api->LoadTexture2D = LoadTexture2D;
+    api->CreateSampler = CreateSampler;
+    api->UnloadTexture2D = UnloadTexture2D;
+    api->BeginFrame = BeginFrame;
+    api->EndFrame = EndFrame;
+}
+
+RendererAPI* InitializeRenderer_Software(CoreState* coreContext, DisplayParams desiredDisplayParams, DisplayParams* actualDisplayParams)
+{
+    if (Initialized == 0)
+    {
+        RendererContext* renderer = GetRendererContext();
+        renderer->core = coreContext;
+
+        CoreAPI* core = &coreContext->coreAPI;
+        renderer->heap = core->CreateHeap();
+
+        SwInitColorTables(renderer);
+        SwResizeFramebuffer(renderer, desiredDisplayParams);
+
+        renderer->materialsCapacity = 1024;
+        renderer->materials = (SwMaterial*)core->HeapAlloc(renderer->heap, sizeof(SwMaterial) * renderer->materialsCapacity, false);
+        renderer->drawsCapacity = 1024;
+        renderer->draws = (SwDraw*)core->HeapAlloc(renderer->heap, sizeof(SwDraw) * renderer->drawsCapacity, false);
+
+        // NOTE: Pages are committed on first touch, actual usage follows the scene.
+        renderer->triangles = (SwTriangle*)core->AllocatePages(sizeof(SwTriangle) * SW_MAX_BATCH_TRIANGLES).memory;
+        renderer->binEntries = (u32*)core->AllocatePages(sizeof(u32) * SW_MAX_BIN_ENTRIES).memory;
+
+        Log_Info("Rendering on %lu job threads, %lux%lu tiles\n", core->GetJobThreadsCount(), renderer->tilesX, renderer->tilesY);
+
+        InitializeApi(&GlobalApi);
+        Initialized = 1;
+    }
+
+    RendererContext* renderer = GetRendererContext();
+    *actualDisplayParams = renderer->displayParams;
+    return &GlobalApi;
+}
+
+RenderFrameStats SoftwareRendererGetTotalStats()
+{
+    return GetRendererContext()->totalStats;
+}
+
+u32* SoftwareRendererGetFramebuffer(u32* width, u32* height)
+{
+    RendererContext* renderer = GetRendererContext();
+    *width = renderer->displayParams.width;
+    *height = renderer->displayParams.height;
+    return renderer->framebuffer;
+}